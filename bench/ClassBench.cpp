@@ -0,0 +1,74 @@
+// Method dispatch microbenchmark: a hot loop of field reads, field writes and method invokes on every engine, with
+// call sites that see one class (monomorphic), three classes of different shapes (polymorphic) and more classes than
+// an inline cache holds (megamorphic).
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "lox.h"
+
+static const char *classes = R"(
+class Shape { init(size) { this.size = size; } area() { return this.size; } }
+class Square < Shape { area() { return this.size * this.size; } }
+class Circle < Shape { init(r) { this.r = r; super.init(r); } area() { return this.r * this.r * 3; } }
+class Tri < Shape { init(b, h) { this.h = h; this.b = b; super.init(b); } area() { return this.b * this.h / 2; } }
+class S1 < Square {} class S2 < Square {} class S3 < Square {} class S4 < Square {} class S5 < Square {}
+class Counter { init() { this.n = 0; } add(by) { this.n = this.n + by; return this; } }
+)";
+
+static const char *monomorphic = R"(
+var c = Counter();
+for (var i = 0; i < 1000000; i = i + 1) c.add(1);
+)";
+
+static const char *polymorphic = R"(
+var a = Square(2); var b = Circle(1); var c = Tri(2, 4);
+var total = 0;
+var k = 0;
+for (var i = 0; i < 300000; i = i + 1) {
+  var s = a;
+  if (k == 1) s = b; else if (k == 2) s = c;
+  k = k + 1; if (k == 3) k = 0;
+  total = total + s.area() + s.size;
+}
+)";
+
+static const char *megamorphic = R"(
+var a = S1(1); var b = S2(1); var c = S3(1); var d = S4(1); var e = S5(1);
+var total = 0;
+var k = 0;
+for (var i = 0; i < 300000; i = i + 1) {
+  var s = a;
+  if (k == 1) s = b; else if (k == 2) s = c; else if (k == 3) s = d; else if (k == 4) s = e;
+  k = k + 1; if (k == 5) k = 0;
+  total = total + s.area() + s.size;
+}
+)";
+
+template<typename F>
+static double best_of(int runs, F &&body) {
+    double best = 1e300;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main() {
+    const std::pair<const char *, Lox::Engine> engines[] = {{"tree",    Lox::Engine::TREE_WALKER},
+                                                            {"closure", Lox::Engine::CLOSURES},
+                                                            {"stack",   Lox::Engine::STACK},
+                                                            {"vm",      Lox::Engine::VM}};
+    for (auto [name, body]: {std::pair{"monomorphic", monomorphic}, std::pair{"polymorphic", polymorphic},
+                             std::pair{"megamorphic", megamorphic}}) {
+        std::string source = std::string(classes) + body;
+        std::cout << name << ":";
+        for (auto [engine_name, engine]: engines) {
+            Lox::set_engine(engine);
+            std::cout << " " << engine_name << " " << best_of(3, [&] { Lox::run(source, false); }) << " ms";
+        }
+        std::cout << "\n";
+    }
+}
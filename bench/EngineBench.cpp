@@ -0,0 +1,77 @@
+// Execution microbenchmark: the tree walking Interpreter against the same programs compiled to pre-bound callables
+// by the ClosureCompiler. Both run on an Interpreter's environments and heap, only the dispatch differs.
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "ClosureCompiler.h"
+#include "Optimizer.h"
+#include "Resolver.h"
+#include "parser.h"
+#include "scanner.h"
+
+static const char *fib = R"(
+fun fib(n) { if (n < 2) return n; return fib(n - 2) + fib(n - 1); }
+print fib(27);
+)";
+
+static const char *counters = R"(
+fun make_counter() {
+  var count = 0;
+  fun increment(by) { count = count + by; return count; }
+  return increment;
+}
+var a = make_counter();
+var b = make_counter();
+for (var i = 0; i < 300000; i = i + 1) { a(1); b(2); }
+print a(0) + b(0);
+)";
+
+static const char *loop = R"(
+var total = 0;
+for (var i = 0; i < 2000000; i = i + 1) {
+  if (i / 3 > 10 and i != 7) total = total + i * 2 - 1; else total = total - 1;
+}
+print total;
+)";
+
+template<typename F>
+static double best_of(int runs, F &&body) {
+    double best = 1e300;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+// parses, resolves and optimizes `source`, ready to run on either engine
+static void prepare(Lox::Program &program, const char *source) {
+    program.source = Lox::Source(source);
+    Scanner scanner(program.source.view());
+    Parser parser(scanner, program);
+    parser.parseTokens();
+    Lox::Resolver().resolve_program(program);
+    Lox::Optimizer(program).optimize_program();
+}
+
+int main() {
+    for (auto [name, source]: {std::pair{"fib", fib}, std::pair{"counters", counters}, std::pair{"loop", loop}}) {
+        double visitor_ms = best_of(5, [&] {
+            Lox::Interpreter interpreter;
+            Lox::Program program;
+            prepare(program, source);
+            interpreter.interpret(program, false);
+        });
+        double closures_ms = best_of(5, [&] {
+            Lox::Interpreter interpreter;
+            Lox::Program program;
+            prepare(program, source);
+            Lox::ClosureCompiler compiler(program);
+            Lox::ClosureCompiler::run(interpreter, program, compiler.compile_program(program), false);
+        });
+        std::cout << name << ": visitor " << visitor_ms << " ms, closures " << closures_ms << " ms ("
+                  << visitor_ms / closures_ms << "x)\n";
+    }
+}
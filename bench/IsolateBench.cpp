@@ -0,0 +1,64 @@
+// Throughput of independent scripts run by isolates on 1, 2, 4... threads, up to the number of cores or the count
+// given as the first argument. Every script gets a fresh Isolate, as a server handling one request per script
+// would, so this measures construction, parsing and execution. With no shared mutable state the speedup should
+// track the thread count until the cores run out. The second figure runs one program compiled up front instead,
+// which is what compiling once saves every request.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Isolate.h"
+
+static const char *script = R"(
+class Point { init(x, y) { this.x = x; this.y = y; } plus(other) { return Point(this.x + other.x, this.y + other.y); } }
+fun fib(n) { if (n < 2) return n; return fib(n - 2) + fib(n - 1); }
+var p = Point(0, 0);
+for (var i = 0; i < 2000; i = i + 1) p = p.plus(Point(1, 2));
+print p.x + p.y + fib(16);
+)";
+
+// runs `scripts` scripts spread over `threads` threads, compiling each one unless given `program`. Returns scripts
+// per second
+static double throughput(int threads, int scripts, const std::shared_ptr<const Lox::Program> &program = nullptr) {
+    std::atomic<int> next{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            while (next.fetch_add(1) < scripts) {
+                std::ostringstream out;
+                Lox::Isolate isolate(out, out);
+                if (program)
+                    isolate.run(program);
+                else
+                    isolate.run(Lox::Source(script));
+            }
+        });
+    }
+    for (auto &worker: workers)
+        worker.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return scripts / elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads = argc > 1 ? std::stoi(argv[1]) : (int) std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> counts;
+    for (int threads = 1; threads < max_threads; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(max_threads);
+    std::shared_ptr<const Lox::Program> program = Lox::Isolate().compile(Lox::Source(script));
+    double single = 0;
+    for (int threads: counts) {
+        double rate = throughput(threads, 200 * threads);
+        if (threads == 1)
+            single = rate;
+        double precompiled = throughput(threads, 200 * threads, program);
+        std::cout << threads << " threads: " << (int) rate << " scripts/s, " << rate / single << "x, precompiled "
+                  << (int) precompiled << " scripts/s\n";
+    }
+}
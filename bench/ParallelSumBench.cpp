@@ -0,0 +1,68 @@
+// Parallel sum: a CPU bound loop split across spawned Lox threads that send their partial sums over a channel,
+// against the same loop on one thread, for each engine with threads. The speedup should track the worker count
+// until the cores run out, less the cost of copying the globals into each worker.
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "Isolate.h"
+
+static std::string script(int workers) {
+    return R"(
+var N = 4000000;
+var workers = )" + std::to_string(workers) + R"(;
+fun part(from, to, results) {
+  fun run() {
+    var sum = 0;
+    for (var i = from; i < to; i = i + 1) sum = sum + i * 2;
+    send(results, sum);
+  }
+  return run;
+}
+var results = channel(workers);
+var step = N / workers;
+for (var w = 0; w < workers; w = w + 1) spawn(part(w * step, (w + 1) * step, results));
+var total = 0;
+for (var w = 0; w < workers; w = w + 1) total = total + receive(results);
+print total;
+)";
+}
+
+template<typename F>
+static double best_of(int runs, F &&body) {
+    double best = 1e300;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    int max_workers = argc > 1 ? std::stoi(argv[1]) : (int) std::max(1u, std::thread::hardware_concurrency());
+    const std::pair<const char *, Lox::Engine> engines[] = {{"tree",    Lox::Engine::TREE_WALKER},
+                                                            {"closure", Lox::Engine::CLOSURES},
+                                                            {"stack",   Lox::Engine::STACK}};
+    for (auto [name, engine]: engines) {
+        std::cout << name << ":";
+        double single = 0;
+        for (int workers = 1;; workers = std::min(workers * 2, max_workers)) {
+            double ms = best_of(3, [&] {
+                std::ostringstream out;
+                Lox::Isolate isolate(out, out);
+                isolate.set_engine(engine);
+                isolate.run(Lox::Source(script(workers)));
+            });
+            if (workers == 1)
+                single = ms;
+            std::cout << " " << workers << " workers " << ms << " ms (" << single / ms << "x)";
+            if (workers == max_workers)
+                break;
+        }
+        std::cout << "\n";
+    }
+}
@@ -0,0 +1,100 @@
+// Scanner microbenchmark on identifier heavy input: keyword classification through the perfect hash against the
+// unordered_map lookup it replaced, and whole scanner throughput. A comment, string and indentation heavy input is
+// then scanned with each SIMD level of the scan kernels.
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Keywords.h"
+#include "ScanKernels.h"
+#include "scanner.h"
+
+static std::string identifier_heavy_source(size_t min_size) {
+    const char *words[] = {"counter", "fun", "value", "i", "while", "print", "total", "x1", "return", "for",
+                           "node_next", "var", "this", "if", "accumulator", "nil", "or", "result", "and", "else"};
+    std::string source;
+    size_t n = 0;
+    while (source.size() < min_size) {
+        source += words[n % 20];
+        source += (++n % 12 == 0) ? '\n' : ' ';
+    }
+    return source;
+}
+
+static std::string comment_heavy_source(size_t min_size) {
+    std::string source;
+    while (source.size() < min_size) {
+        source += "        // keep the running total in sync with the entries added to the table below\n";
+        source += "        /* the table is rebuilt whenever it grows past its load factor,\n"
+                  "           so lookups stay cheap even for long running scripts */\n";
+        source += "        print \"processed another batch of entries, the total is now\";\n\n";
+    }
+    return source;
+}
+
+template<typename F>
+static double best_of(int runs, F &&body) {
+    double best = 1e300;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main() {
+    std::string source = identifier_heavy_source(8 * 1024 * 1024);
+    std::vector<Token> tokens = Scanner(source).scanTokens();
+    std::vector<std::string_view> lexemes;
+    for (auto &token: tokens)
+        if (token.type != T_EOF)
+            lexemes.push_back(token.lexeme);
+
+    static const std::unordered_map<std::string, token_type> keyword_map = [] {
+        std::unordered_map<std::string, token_type> map;
+        for (auto &keyword: Lox::KEYWORDS)
+            map.emplace(std::string(keyword.text), keyword.type);
+        return map;
+    }();
+
+    long checksum = 0;
+    double map_ms = best_of(5, [&] {
+        for (auto lexeme: lexemes) {
+            auto itr = keyword_map.find(std::string(lexeme));
+            checksum += itr == keyword_map.end() ? IDENTIFIER : itr->second;
+        }
+    });
+    double hash_ms = best_of(5, [&] {
+        for (auto lexeme: lexemes)
+            checksum += Lox::identifier_type(lexeme);
+    });
+    double scan_ms = best_of(5, [&] {
+        checksum += (long) Scanner(source).scanTokens().size();
+    });
+
+    double mb = (double) source.size() / (1024 * 1024);
+    std::cout << lexemes.size() << " identifiers and keywords in " << mb << " MB\n";
+    std::cout << "keyword lookup, unordered_map:  " << map_ms << " ms (" << map_ms * 1e6 / lexemes.size()
+              << " ns/lookup)\n";
+    std::cout << "keyword lookup, perfect hash:   " << hash_ms << " ms (" << hash_ms * 1e6 / lexemes.size()
+              << " ns/lookup)\n";
+    std::cout << "scanTokens:                     " << scan_ms << " ms (" << mb / (scan_ms / 1000) << " MB/s)\n";
+
+    std::string comments = comment_heavy_source(8 * 1024 * 1024);
+    double comments_mb = (double) comments.size() / (1024 * 1024);
+    std::cout << "comment and string heavy input, " << comments_mb << " MB\n";
+    for (auto level: {Lox::SimdLevel::SCALAR, Lox::SimdLevel::SSE2, Lox::SimdLevel::AVX2}) {
+        auto &kernels = Lox::scan_kernels(level);
+        if (kernels.level != level)
+            continue;
+        double ms = best_of(5, [&] {
+            checksum += (long) Scanner(comments, kernels).scanTokens().size();
+        });
+        std::cout << "scanTokens, " << kernels.name << ":" << std::string(24 - std::string(kernels.name).size(), ' ')
+                  << ms << " ms (" << comments_mb / (ms / 1000) << " MB/s)\n";
+    }
+    std::cout << "checksum " << checksum << "\n";
+}
@@ -0,0 +1,80 @@
+// Request latency of a tiny script run by a warm Server over its socket, against starting a lox process for it
+// (fork and exec), which pays for process startup, isolate construction and parsing every time. Takes the lox
+// binary to start as its argument, the one built alongside by default.
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Server.h"
+
+extern char **environ;
+
+static const char *script = R"(
+fun greet(name) { return "hello " + name; }
+var total = 0;
+for (var i = 0; i < 100; i = i + 1) total = total + i;
+print greet("world");
+print total;
+)";
+
+// times `runs` calls of body, returning them in milliseconds sorted
+template<typename F>
+static std::vector<double> latencies(int runs, F &&body) {
+    std::vector<double> times;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        times.push_back(elapsed.count());
+    }
+    std::sort(times.begin(), times.end());
+    return times;
+}
+
+static void report(const char *name, const std::vector<double> &times) {
+    std::cout << name << ": p50 " << times[times.size() / 2] << " ms, p99 " << times[times.size() * 99 / 100]
+              << " ms\n";
+}
+
+int main(int argc, char *argv[]) {
+    std::string lox = argc > 1 ? argv[1] : LOX_BINARY;
+    std::string script_path = "/tmp/lox_server_bench.lox";
+    std::string socket_path = "/tmp/lox_server_bench.sock";
+    std::ofstream(script_path) << script;
+
+    Lox::BatchOptions options;
+    options.jobs = 1;
+    Lox::Server server(socket_path, options);
+    if (!server.listen()) {
+        std::perror("listen");
+        return 1;
+    }
+    std::thread serving([&] { server.serve(); });
+    Lox::Client client;
+    if (!client.connect(socket_path)) {
+        std::perror("connect");
+        return 1;
+    }
+    report("server", latencies(2000, [&] { client.run_file(script_path); }));
+    server.stop();
+    serving.join();
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+    char *spawn_argv[] = {lox.data(), script_path.data(), nullptr};
+    report("fork and exec", latencies(300, [&] {
+        pid_t pid;
+        if (posix_spawn(&pid, lox.c_str(), &actions, nullptr, spawn_argv, environ) == 0)
+            waitpid(pid, nullptr, 0);
+    }));
+    posix_spawn_file_actions_destroy(&actions);
+    std::remove(script_path.c_str());
+}
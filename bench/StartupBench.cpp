@@ -0,0 +1,83 @@
+// Startup microbenchmark: getting a large script from disk to a parsed Program by scanning and parsing it, against
+// loading the tree from a .loxc file of the ProgramCache.
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "ProgramCache.h"
+#include "parser.h"
+#include "scanner.h"
+
+static std::string generated_script(size_t min_size) {
+    std::string source;
+    for (int n = 0; source.size() < min_size; n++) {
+        std::string i = std::to_string(n);
+        source += "fun step" + i + "(a, b) {\n"
+                  "    // keeps a running total\n"
+                  "    var total = a * " + i + " + b / 2;\n"
+                  "    if (total > 100 and b != nil) { total = total - \"limit\" == nil ? 1 : 2; }\n"
+                  "    while (total < 10) total = total + 1;\n"
+                  "    return step" + i + "(total, -a);\n"
+                  "}\n";
+    }
+    return source;
+}
+
+template<typename F>
+static double best_of(int runs, F &&body) {
+    double best = 1e300;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main() {
+    std::string directory = "/tmp/lox_startup_bench";
+    std::string path = directory + ".lox";
+    std::string source = generated_script(16 * 1024 * 1024);
+    std::ofstream(path, std::ios::binary) << source;
+    Lox::ProgramCache cache(directory);
+
+    size_t statements = 0;
+    double cold_ms = best_of(5, [&] {
+        Lox::Program program;
+        program.source = Lox::Source::from_file(path);
+        Scanner scanner(program.source.view());
+        Parser parser(scanner, program);
+        statements += parser.parseTokens().size();
+    });
+    double store_ms = best_of(1, [&] {
+        Lox::Program program;
+        program.source = Lox::Source::from_file(path);
+        Scanner scanner(program.source.view());
+        Parser parser(scanner, program);
+        parser.parseTokens();
+        cache.store(program);
+    });
+    double hit_ms = best_of(5, [&] {
+        Lox::Program program;
+        program.source = Lox::Source::from_file(path);
+        if (!cache.load(program))
+            std::cerr << "cache miss\n";
+        statements += program.statements.size();
+    });
+    double hash_ms = best_of(5, [&] {
+        Lox::Source file = Lox::Source::from_file(path);
+        statements += Lox::ProgramCache::hash_source(file.view()) & 1;
+    });
+
+    std::ifstream cached(cache.path_for(source), std::ios::binary | std::ios::ate);
+    std::cout << "script " << source.size() / (1024 * 1024) << " MB, .loxc " << cached.tellg() / (1024 * 1024)
+              << " MB\n";
+    std::cout << "cold scan + parse:   " << cold_ms << " ms\n";
+    std::cout << "parse + store:       " << store_ms << " ms\n";
+    std::cout << "cache hit:           " << hit_ms << " ms (of which hashing the source " << hash_ms << " ms)\n";
+    std::cout << "checksum " << statements << "\n";
+    std::remove(cache.path_for(source).c_str());
+    std::remove(path.c_str());
+}
@@ -0,0 +1,118 @@
+#ifndef LOX_ARENA_H
+#define LOX_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Lox {
+
+    // fixed size array allocated in an Arena, used for the child lists of AST nodes
+    template<typename T>
+    class NodeList {
+        T *items = nullptr;
+        uint32_t count = 0;
+    public:
+        NodeList() = default;
+
+        NodeList(T *items, uint32_t count) : items(items), count(count) {};
+
+        T *begin() const { return items; }
+
+        T *end() const { return items + count; }
+
+        uint32_t size() const { return count; }
+
+        bool empty() const { return count == 0; }
+
+        T &operator[](size_t index) const { return items[index]; }
+    };
+
+    // Bump allocator. Objects are carved out of large blocks and released all at once when the arena is destroyed,
+    // destructors are only recorded for the types that need one.
+    class Arena {
+        struct Finalizer {
+            void *object;
+
+            void (*destroy)(void *);
+        };
+
+        std::vector<std::unique_ptr<char[]>> blocks;
+        std::vector<Finalizer> finalizers;
+        char *position = nullptr;
+        char *limit = nullptr;
+        size_t bytes_used = 0;
+
+        void *allocate_block(size_t size, size_t align);
+
+        template<typename T>
+        void register_finalizer(T *object) {
+            if (!std::is_trivially_destructible<T>::value)
+                finalizers.push_back({object, [](void *ptr) { static_cast<T *>(ptr)->~T(); }});
+        }
+
+    public:
+        static constexpr size_t BLOCK_SIZE = 32 * 1024;
+
+        Arena() = default;
+
+        Arena(const Arena &) = delete;
+
+        Arena &operator=(const Arena &) = delete;
+
+        ~Arena();
+
+        void *allocate(size_t size, size_t align) {
+            auto address = reinterpret_cast<uintptr_t>(position);
+            uintptr_t aligned = (address + align - 1) & ~(uintptr_t) (align - 1);
+            if (!position || aligned + size > reinterpret_cast<uintptr_t>(limit))
+                return allocate_block(size, align);
+            position = reinterpret_cast<char *>(aligned + size);
+            bytes_used += size;
+            return reinterpret_cast<void *>(aligned);
+        }
+
+        template<typename T, typename... Args>
+        T *make(Args &&... args) {
+            T *object = new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            register_finalizer(object);
+            return object;
+        }
+
+        template<typename T>
+        NodeList<T> make_list(const std::vector<T> &items) {
+            if (items.empty())
+                return {};
+            auto *array = static_cast<T *>(allocate(sizeof(T) * items.size(), alignof(T)));
+            for (size_t i = 0; i < items.size(); i++) {
+                new(array + i) T(items[i]);
+                register_finalizer(array + i);
+            }
+            return {array, (uint32_t) items.size()};
+        }
+
+        // a list of `count` items built by calling `next` once for each of them, in order
+        template<typename T, typename Next>
+        NodeList<T> make_list(uint32_t count, Next &&next) {
+            if (count == 0)
+                return {};
+            auto *array = static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+            for (uint32_t i = 0; i < count; i++) {
+                new(array + i) T(next());
+                register_finalizer(array + i);
+            }
+            return {array, count};
+        }
+
+        size_t size() const { return bytes_used; }
+
+        size_t block_count() const { return blocks.size(); }
+    };
+
+} // Lox
+
+#endif //LOX_ARENA_H
@@ -0,0 +1,53 @@
+#ifndef LOX_BATCH_H
+#define LOX_BATCH_H
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Isolate.h"
+
+namespace Lox {
+
+    // the most worker threads a batch or server starts, however many jobs it's asked for
+    constexpr unsigned MAX_JOBS = 256;
+
+    // the settings every isolate of a batch gets
+    struct BatchOptions {
+        Engine engine = Engine::TREE_WALKER;
+        int optimization_level = 1;
+        // 0 keeps the default
+        size_t max_depth = 0;
+        const ProgramCache *cache = nullptr;
+        // worker threads, 0 for one per core, at most MAX_JOBS
+        unsigned jobs = 0;
+    };
+
+    // gives `isolate` the settings of `options`
+    void configure(Isolate &isolate, const BatchOptions &options);
+
+    // the worker threads `options` asks for, between 1 and MAX_JOBS
+    unsigned job_count(const BatchOptions &options);
+
+    struct ScriptResult {
+        std::string path;
+        // what the script printed and the errors it reported, kept apart like stdout and stderr
+        std::string out;
+        std::string err;
+        Isolate::Status status = Isolate::Status::OK;
+        double milliseconds = 0;
+    };
+
+    // Runs each script of `paths` in a fresh Isolate, so they don't see each other's globals, on a pool of
+    // options.jobs threads. `done` is called on the calling thread with the results in the order of `paths`, each
+    // as soon as it and all the scripts before it have finished.
+    void run_batch(const std::vector<std::string> &paths, const BatchOptions &options,
+                   const std::function<void(const ScriptResult &)> &done);
+
+    // the script paths a manifest lists one per line, without blank lines and lines starting with '#'. Nothing if
+    // the manifest can't be read
+    std::optional<std::vector<std::string>> read_manifest(const std::string &path);
+
+} // Lox
+
+#endif //LOX_BATCH_H
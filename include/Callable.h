@@ -6,17 +6,62 @@
 #define LOX_CALLABLE_H
 
 #include "interpreter.h"
+#include "LoxExceptions.h"
 
 namespace Lox {
     class Interpreter;
 
-    class Callable {
+    // the arguments of a call, a view of the values the caller evaluated onto the interpreter's stack. Only
+    // valid until the callee runs Lox code, which may grow that stack
+    class Arguments {
+        Object *items;
+        size_t count;
     public:
-        virtual Object call(Interpreter &interpreter, std::vector<Object> arguments) = 0;
+        Arguments(Object *items, size_t count) : items(items), count(count) {};
 
-        virtual ~Callable() = default;
+        Object *begin() const { return items; }
+
+        Object *end() const { return items + count; }
+
+        size_t size() const { return count; }
+
+        Object &operator[](size_t index) const { return items[index]; }
+    };
+
+    class Callable : public Obj {
+    public:
+        Callable() : Obj(ObjType::CALLABLE) {};
+
+        virtual Object call(Interpreter &interpreter, Arguments arguments) = 0;
 
         virtual int arity() = 0;
+
+        // a call of the callable as a method of `receiver`. Only functions declared in a class use the receiver
+        virtual Object call_method(Interpreter &interpreter, Object receiver, Arguments arguments) {
+            return call(interpreter, arguments);
+        }
+    };
+
+    // thrown by a native for a runtime error, the call that made it reports the error at its parenthesis
+    struct NativeError {
+        std::string message;
+    };
+
+    // calls `callee`, reporting a NativeError it throws at `paren`
+    inline Object call_at(const Token &paren, Callable *callee, Interpreter &interpreter, Arguments arguments) {
+        try {
+            return callee->call(interpreter, arguments);
+        } catch (NativeError &error) {
+            throw RuntimeException(paren, std::move(error.message));
+        }
+    }
+
+    // what a function's frame holds besides its parameters: a method has its receiver in slot 0, and an
+    // initializer also returns it
+    enum class FunctionKind : uint8_t {
+        FUNCTION,
+        METHOD,
+        INITIALIZER
     };
 
 } // Lox
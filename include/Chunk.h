@@ -0,0 +1,81 @@
+#ifndef LOX_CHUNK_H
+#define LOX_CHUNK_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Shape.h"
+#include "Value.h"
+
+namespace Lox {
+
+    // operands: CONSTANT, *_GLOBAL, CLASS, METHOD and jumps take a 2 byte big endian operand, *_LOCAL, *_UPVALUE and
+    // CALL one byte. *_PROPERTY and GET_SUPER take the 2 byte index of their cache, INVOKE and SUPER_INVOKE that and
+    // a 1 byte argument count
+    enum OpCode : uint8_t {
+        OP_CONSTANT,
+        OP_NIL,
+        OP_TRUE,
+        OP_FALSE,
+        OP_UNINITIALIZED,
+        OP_POP,
+        OP_GET_LOCAL,
+        OP_SET_LOCAL,
+        OP_GET_GLOBAL,
+        OP_DEFINE_GLOBAL,
+        OP_SET_GLOBAL,
+        OP_GET_UPVALUE,
+        OP_SET_UPVALUE,
+        OP_EQUAL,
+        OP_NOT_EQUAL,
+        OP_GREATER,
+        OP_GREATER_EQUAL,
+        OP_LESS,
+        OP_LESS_EQUAL,
+        OP_ADD,
+        OP_SUBTRACT,
+        OP_MULTIPLY,
+        OP_DIVIDE,
+        OP_NOT,
+        OP_NEGATE,
+        OP_PRINT,
+        OP_JUMP,
+        OP_JUMP_IF_FALSE,
+        OP_JUMP_IF_TRUE,
+        OP_LOOP,
+        OP_CALL,
+        OP_CLOSURE,
+        OP_CLOSE_UPVALUE,
+        OP_CLASS,
+        OP_INHERIT,
+        OP_METHOD,
+        OP_GET_PROPERTY,
+        OP_SET_PROPERTY,
+        OP_INVOKE,
+        OP_GET_SUPER,
+        OP_SUPER_INVOKE,
+        OP_RETURN,
+        // OP_CALL of the value a function returns, always followed by OP_RETURN. A call of a Lox function takes
+        // over the returning function's frame instead of pushing one
+        OP_TAIL_CALL,
+    };
+
+    class Chunk {
+        // run length encoded line table: (offset of the first byte, line) for every run of bytes on the same line
+        std::vector<std::pair<size_t, int>> lines;
+    public:
+        std::vector<uint8_t> code;
+        std::vector<Value> constants;
+        // one per property access, which knows its name from the start
+        std::vector<PropertyCache> caches;
+
+        void write(uint8_t byte, int line);
+
+        int add_constant(Value value);
+
+        int get_line(size_t offset) const;
+    };
+
+} // Lox
+
+#endif //LOX_CHUNK_H
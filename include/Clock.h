@@ -9,12 +9,19 @@
 #include "types.h"
 
 namespace Lox {
+    // seconds since the epoch, shared by the tree walker's Clock and the VM's native
+    Value clock_native(int arg_count, Value *args);
+
     class Clock : public Callable {
-        Object call(Interpreter &interpreter, std::vector<Object> arguments);
+        Object call(Interpreter &interpreter, Arguments arguments) override;
+
+        int arity() override;
+
+        size_t size() const override { return sizeof(Clock); }
 
-        int arity();
+        Obj *copy(ObjectCopier &copier) const override;
 
-        std::string to_string();
+        std::string to_string() const override;
     };
 
 }
@@ -0,0 +1,117 @@
+#ifndef LOX_CLOSURECOMPILER_H
+#define LOX_CLOSURECOMPILER_H
+
+#include "Expr.hpp"
+#include "Stmt.hpp"
+#include "Program.h"
+#include "interpreter.h"
+
+namespace Lox {
+
+    // A node of the closure compiled tree: a function pointer and the context it runs with, which is the rest of
+    // the struct that embeds this header. The function is picked once per node at compile time (per operator,
+    // per kind of variable), so running a node is one indirect call instead of accept followed by visit.
+    struct CompiledExpr {
+        Object (*eval)(const CompiledExpr *self, Interpreter &interpreter);
+    };
+
+    struct CompiledStmt {
+        Completion (*exec)(const CompiledStmt *self, Interpreter &interpreter);
+    };
+
+    // the functions the compiled nodes point at, defined next to the compiler
+    struct ClosureRuntime;
+
+    // Translates a resolved (and optionally optimized) program into compiled nodes allocated in an arena, usually
+    // the program's, run with the Interpreter's environments, globals, heap and Feedback. Selected with
+    // --engine=closure.
+    class ClosureCompiler : public ExprVisitor, public StmtVisitor {
+        Arena &arena;
+        const CompiledExpr *expr_result = nullptr;
+        const CompiledStmt *stmt_result = nullptr;
+
+        const CompiledExpr *compile(Expr *expr);
+
+        const CompiledStmt *compile(Stmt *stmt);
+
+        NodeList<const CompiledStmt *> compile(NodeList<Stmt *> statements);
+
+        // a plain call, even of a method. Tail calls need one, they unwind to the caller before calling
+        const CompiledExpr *compile_call(Call *expr);
+
+        // returns `value`, which has a call in tail position
+        const CompiledStmt *compile_return(Expr *value);
+
+        // a node of type T running `fn`, with the rest of its fields initialized from `args`
+        template<typename T, typename Fn, typename... Args>
+        const T *make(Fn fn, Args &&... args) {
+            return arena.make<T>(T{{fn}, std::forward<Args>(args)...});
+        }
+
+    public:
+        explicit ClosureCompiler(Program &program) : arena(program.arena) {};
+
+        explicit ClosureCompiler(Arena &arena) : arena(arena) {};
+
+        // compiles the top level statements of program. The code points into its tree and must not outlive it
+        NodeList<const CompiledStmt *> compile_program(const Program &program);
+
+        // runs the compiled top level statements of program, reporting a runtime error like Interpreter::interpret.
+        // With print_expressions expression statements print their value
+        static void run(Interpreter &interpreter, const Program &program, NodeList<const CompiledStmt *> code,
+                        bool print_expressions);
+
+        void visit(Expression *stmt) override;
+
+        void visit(Print *stmt) override;
+
+        void visit(Block *stmt) override;
+
+        void visit(Var *stmt) override;
+
+        void visit(If *stmt) override;
+
+        void visit(While *stmt) override;
+
+        void visit(Break *stmt) override;
+
+        void visit(Return *stmt) override;
+
+        void visit(Function *stmt) override;
+
+        void visit(Class *stmt) override;
+
+        void visit(Binary *expr) override;
+
+        void visit(Grouping *expr) override;
+
+        void visit(Ternary *expr) override;
+
+        void visit(Literal *expr) override;
+
+        void visit(Unary *expr) override;
+
+        void visit(Nothing *expr) override;
+
+        void visit(Variable *expr) override;
+
+        void visit(Logical *expr) override;
+
+        void visit(Assign *expr) override;
+
+        void visit(Call *expr) override;
+
+        void visit(FunctionExpr *expr) override;
+
+        void visit(Get *expr) override;
+
+        void visit(Set *expr) override;
+
+        void visit(This *expr) override;
+
+        void visit(Super *expr) override;
+    };
+
+} // Lox
+
+#endif //LOX_CLOSURECOMPILER_H
@@ -0,0 +1,181 @@
+#ifndef LOX_COMPILER_H
+#define LOX_COMPILER_H
+
+#include <string>
+#include <vector>
+#include "Expr.hpp"
+#include "Stmt.hpp"
+#include "Obj.h"
+
+namespace Lox {
+    class VM;
+
+    // Compiles the Stmt/Expr trees produced by the Parser into bytecode for the VM. Locals live in stack slots,
+    // variables captured by closures are turned into upvalues, and globals are indexed through the VM's table.
+    class Compiler : public ExprVisitor, StmtVisitor {
+        enum class FunctionType {
+            SCRIPT,
+            FUNCTION,
+            METHOD,
+            INITIALIZER
+        };
+
+        struct Local {
+            std::string_view name;
+            int depth;
+            bool is_captured;
+        };
+
+        struct Upvalue {
+            uint8_t index;
+            bool is_local;
+        };
+
+        struct Loop {
+            // locals deeper than this are popped when breaking out of the loop
+            int scope_depth;
+            std::vector<size_t> break_jumps;
+        };
+
+        // per function being compiled, nested function expressions push a new one
+        struct FunctionState {
+            FunctionState *enclosing;
+            ObjFunction *function;
+            FunctionType type;
+            std::vector<Local> locals;
+            std::vector<Upvalue> upvalues;
+            std::vector<Loop> loops;
+            int scope_depth = 0;
+        };
+
+        // per class declaration being compiled, for the checks the Resolver does for the tree walkers
+        struct ClassState {
+            ClassState *enclosing;
+            bool has_superclass;
+        };
+
+        VM &vm;
+        FunctionState *current = nullptr;
+        ClassState *current_class = nullptr;
+        bool print_expressions;
+        bool had_compile_error = false;
+        int line = 0;
+        // the next Call compiled is the value being returned, see compile_return
+        bool tail_call = false;
+
+        Chunk &chunk();
+
+        void emit(uint8_t byte);
+
+        void emit(uint8_t op, uint8_t operand);
+
+        void emit_short(uint8_t op, int operand);
+
+        size_t emit_jump(uint8_t op);
+
+        void patch_jump(size_t offset);
+
+        void emit_loop(size_t loop_start);
+
+        void emit_constant(Value value);
+
+        // returns nil, or `this` from an initializer
+        void emit_return();
+
+        // returns the value of `value`, making the calls in its tail position with OP_TAIL_CALL
+        void compile_return(Expr *value);
+
+        // index of a new inline cache for an access of the property `name`
+        int add_cache(const Token &name);
+
+        // pushes the variable `name`, a local, upvalue or global
+        void named_variable(std::string_view name);
+
+        void compile(Stmt *stmt);
+
+        void compile(Expr *expr);
+
+        void compile_function(FunctionExpr *expr, std::string_view name, FunctionType type = FunctionType::FUNCTION);
+
+        void begin_scope();
+
+        void end_scope();
+
+        // pops (or closes) the locals deeper than `depth` without forgetting them, used by break
+        void discard_locals(int depth);
+
+        void declare_variable(const Token &name);
+
+        int add_local(std::string_view name);
+
+        int resolve_local(FunctionState *state, std::string_view name);
+
+        int resolve_upvalue(FunctionState *state, std::string_view name);
+
+        int add_upvalue(FunctionState *state, uint8_t index, bool is_local);
+
+        void compile_error(const Token &token, const std::string &message);
+
+        // reports a `super` outside of a subclass, false if there was one
+        bool check_super(Super *expr);
+
+    public:
+        Compiler(VM &vm, bool print_expressions) : vm(vm), print_expressions(print_expressions) {};
+
+        // returns the function for the top level script, or nullptr if the program couldn't be compiled
+        ObjFunction *compile(NodeList<Stmt *> statements);
+
+        void visit(Expression *stmt) override;
+
+        void visit(Print *stmt) override;
+
+        void visit(Block *stmt) override;
+
+        void visit(Var *stmt) override;
+
+        void visit(If *stmt) override;
+
+        void visit(While *stmt) override;
+
+        void visit(Break *stmt) override;
+
+        void visit(Return *stmt) override;
+
+        void visit(Function *stmt) override;
+
+        void visit(Class *stmt) override;
+
+        void visit(Binary *expr) override;
+
+        void visit(Grouping *expr) override;
+
+        void visit(Ternary *expr) override;
+
+        void visit(Literal *expr) override;
+
+        void visit(Unary *expr) override;
+
+        void visit(Nothing *expr) override;
+
+        void visit(Variable *expr) override;
+
+        void visit(Logical *expr) override;
+
+        void visit(Assign *expr) override;
+
+        void visit(Call *expr) override;
+
+        void visit(FunctionExpr *expr) override;
+
+        void visit(Get *expr) override;
+
+        void visit(Set *expr) override;
+
+        void visit(This *expr) override;
+
+        void visit(Super *expr) override;
+    };
+
+} // Lox
+
+#endif //LOX_COMPILER_H
@@ -0,0 +1,169 @@
+#ifndef LOX_CONCURRENCY_H
+#define LOX_CONCURRENCY_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+#include "Callable.h"
+
+namespace Lox {
+
+    class Channel;
+
+    // A value in flight between threads, which have heaps of their own. Only values without an identity on the
+    // sender's heap can be sent: nil, booleans, numbers, strings, and channels, which are shared.
+    using Message = std::variant<std::monostate, bool, double, std::string, std::shared_ptr<Channel>>;
+
+    // A bounded queue of messages. Sends wait while it is full, receives while it is empty. Once closed, sends
+    // fail and receives drain what is left.
+    class Channel {
+        std::mutex mutex;
+        std::condition_variable not_empty;
+        std::condition_variable not_full;
+        std::deque<Message> messages;
+        const size_t capacity;
+        bool closed = false;
+
+    public:
+        explicit Channel(size_t capacity) : capacity(capacity) {};
+
+        // false if the channel is closed
+        bool send(Message message);
+
+        // nothing once the channel is closed and empty
+        std::optional<Message> receive();
+
+        void close();
+    };
+
+    // a channel on one interpreter's heap
+    class LoxChannel final : public Obj {
+    public:
+        const std::shared_ptr<Channel> channel;
+
+        explicit LoxChannel(std::shared_ptr<Channel> channel) : Obj(ObjType::CHANNEL), channel(std::move(channel)) {};
+
+        size_t size() const override { return sizeof(LoxChannel); }
+
+        std::string to_string() const override { return "<channel>"; }
+
+        Obj *copy(ObjectCopier &copier) const override;
+    };
+
+    // Copies objects from one interpreter's heap to another's for spawn, keeping objects reachable along several
+    // paths, and cycles, as they were. Collection on the target heap is paused while copying.
+    class ObjectCopier {
+        std::unordered_map<const Obj *, Obj *> copies;
+
+    public:
+        Interpreter &target;
+
+        explicit ObjectCopier(Interpreter &target);
+
+        ~ObjectCopier();
+
+        Object copy(const Object &value);
+
+        template<typename T>
+        T *copy(T *object) {
+            return static_cast<T *>(copy_obj(object));
+        }
+
+        Obj *copy_obj(const Obj *object);
+
+        // records the copy of an object before copying what it references, which may lead back to it
+        void remember(const Obj *original, Obj *copy) { copies[original] = copy; }
+
+        Feedback *copy_feedback(const Feedback *feedback) { return feedback ? target.feedback_like(*feedback) : nullptr; }
+    };
+
+    struct SpawnedThread {
+        std::unique_ptr<Interpreter> interpreter;
+        std::thread thread;
+        // what the thread, and those it spawned in turn, ended with
+        std::vector<RuntimeException> errors;
+        // set once errors is complete, joining the thread won't block after that
+        std::atomic<bool> done = false;
+    };
+
+    // spawn(function) runs a function without parameters on a thread of its own, see Interpreter::spawn
+    class Spawn : public Callable {
+    public:
+        Object call(Interpreter &interpreter, Arguments arguments) override;
+
+        int arity() override { return 1; }
+
+        size_t size() const override { return sizeof(Spawn); }
+
+        std::string to_string() const override { return "<native fn>"; }
+
+        Obj *copy(ObjectCopier &copier) const override;
+    };
+
+    // channel(capacity) makes a channel holding up to capacity messages
+    class MakeChannel : public Callable {
+    public:
+        Object call(Interpreter &interpreter, Arguments arguments) override;
+
+        int arity() override { return 1; }
+
+        size_t size() const override { return sizeof(MakeChannel); }
+
+        std::string to_string() const override { return "<native fn>"; }
+
+        Obj *copy(ObjectCopier &copier) const override;
+    };
+
+    // send(channel, value) waits for room in the channel, then sends a copy of value
+    class Send : public Callable {
+    public:
+        Object call(Interpreter &interpreter, Arguments arguments) override;
+
+        int arity() override { return 2; }
+
+        size_t size() const override { return sizeof(Send); }
+
+        std::string to_string() const override { return "<native fn>"; }
+
+        Obj *copy(ObjectCopier &copier) const override;
+    };
+
+    // receive(channel) waits for a message, nil once the channel is closed and empty
+    class Receive : public Callable {
+    public:
+        Object call(Interpreter &interpreter, Arguments arguments) override;
+
+        int arity() override { return 1; }
+
+        size_t size() const override { return sizeof(Receive); }
+
+        std::string to_string() const override { return "<native fn>"; }
+
+        Obj *copy(ObjectCopier &copier) const override;
+    };
+
+    // close(channel) fails later sends and lets receives finish once it's empty
+    class Close : public Callable {
+    public:
+        Object call(Interpreter &interpreter, Arguments arguments) override;
+
+        int arity() override { return 1; }
+
+        size_t size() const override { return sizeof(Close); }
+
+        std::string to_string() const override { return "<native fn>"; }
+
+        Obj *copy(ObjectCopier &copier) const override;
+    };
+
+} // Lox
+
+#endif //LOX_CONCURRENCY_H
@@ -5,7 +5,7 @@
 #ifndef LOX_ENVIRONMENT_H
 #define LOX_ENVIRONMENT_H
 
-#include<unordered_map>
+#include<vector>
 #include<string>
 #include "types.h"
 #include "token.h"
@@ -13,24 +13,59 @@
 
 namespace Lox {
 
-    class Environment {
-        Environment *enclosing;
-        std::unordered_map<std::string, Object> values;
+    // a flat array of local variable slots, laid out by the Resolver. Allocated on the Interpreter's Heap.
+    class Environment : public Obj {
+        Environment *enclosing = nullptr;
+        std::vector<Object> values;
     public:
-        Environment() = default;
+        Environment() : Obj(ObjType::ENVIRONMENT) {};
 
 
-        Environment(Environment *enclosing) : enclosing(enclosing) {};
+        Environment(Environment *enclosing, int num_slots) : Obj(ObjType::ENVIRONMENT), enclosing(enclosing),
+                                                             values(num_slots, Object::uninitialized()) {};
 
-        // set a variable, even create it if the name doesnt exist
-        void define(std::string name, Object value);
+        // make a released environment look freshly allocated, values keeps its capacity
+        void reset(Environment *enclosing_, int num_slots) {
+            enclosing = enclosing_;
+            values.assign(num_slots, Object::uninitialized());
+        }
 
-        // update a varaible, throw error if name doesnt exist
-        void assign(Token name, Object value);
+        // set the slot, used for declarations
+        void define(int slot, Object value) {
+            values[slot] = std::move(value);
+        }
 
-        Object get(Token name);
+        // update the slot `depth` environments up, the resolver guarantees that it exists
+        void assign(int depth, int slot, Object value) {
+            ancestor(depth)->values[slot] = std::move(value);
+        }
 
-        ~Environment();
+        // read the slot `depth` environments up, throw error if it was declared without an initializer
+        const Object &get(const Token &name, int depth, int slot) {
+            const Object &val = ancestor(depth)->values[slot];
+            if (val.is_uninitialized())
+                undefined(name);
+            return val;
+        }
+
+        // a slot of this environment that is known to be initialized, such as a method's receiver
+        const Object &at(int slot) const { return values[slot]; }
+
+        [[noreturn]] static void undefined(const Token &name);
+
+        Environment *ancestor(int depth) {
+            Environment *env = this;
+            while (depth--) env = env->enclosing;
+            return env;
+        }
+
+        void trace(Heap &heap) override;
+
+        size_t size() const override { return sizeof(Environment) + values.capacity() * sizeof(Object); }
+
+        std::string to_string() const override { return "<environment>"; }
+
+        Obj *copy(ObjectCopier &copier) const override;
 
     };
 
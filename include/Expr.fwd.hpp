@@ -0,0 +1,17 @@
+#pragma once
+class Expr;
+class Binary;
+class Grouping;
+class Ternary;
+class Literal;
+class Unary;
+class Nothing;
+class Variable;
+class Logical;
+class Assign;
+class Call;
+class FunctionExpr;
+class Get;
+class Set;
+class This;
+class Super;
@@ -1,6 +1,5 @@
 #pragma once
-#include<any>
-#include<memory>
+#include "Arena.h"
 #include "types.h"
 #include "token.h"
 #include "Expr.fwd.hpp"
@@ -18,99 +17,168 @@ class ExprVisitor{
    virtual void visit(Assign *expr)=0;
    virtual void visit(Call *expr)=0;
    virtual void visit(FunctionExpr *expr)=0;
+   virtual void visit(Get *expr)=0;
+   virtual void visit(Set *expr)=0;
+   virtual void visit(This *expr)=0;
+   virtual void visit(Super *expr)=0;
    virtual ~ExprVisitor()=default;
 };
+enum class ExprKind : uint8_t {
+   Binary,
+   Grouping,
+   Ternary,
+   Literal,
+   Unary,
+   Nothing,
+   Variable,
+   Logical,
+   Assign,
+   Call,
+   FunctionExpr,
+   Get,
+   Set,
+   This,
+   Super,
+};
 class Expr{
  public:
+   const ExprKind kind;
    virtual void accept(ExprVisitor& visitor)=0;
-   virtual ~Expr()=default;
 #define MAKE_VISITABLE_Expr virtual void accept(ExprVisitor& vis) override { vis.visit(this);}
+ protected:
+   explicit Expr(ExprKind kind):kind(kind){};
+   ~Expr()=default;
 };
 class Binary: public Expr{
    public:
-   std::unique_ptr<Expr > left;
+   Expr *left;
    Token oper;
-   std::unique_ptr<Expr > right;
+   Expr *right;
+   uint32_t specialization{};
    public:
- Binary(std::unique_ptr<Expr >& left,Token oper,std::unique_ptr<Expr >& right):left(std::move(left)),oper(oper),right(std::move(right)){};
+ Binary(Expr *left,Token oper,Expr *right):Expr(ExprKind::Binary),left(left),oper(oper),right(right){};
 MAKE_VISITABLE_Expr
 };
 class Grouping: public Expr{
    public:
-   std::unique_ptr<Expr > expression;
+   Expr *expression;
    public:
- Grouping(std::unique_ptr<Expr >& expression):expression(std::move(expression)){};
+ Grouping(Expr *expression):Expr(ExprKind::Grouping),expression(expression){};
 MAKE_VISITABLE_Expr
 };
 class Ternary: public Expr{
    public:
-   std::unique_ptr<Expr > condition;
-   std::unique_ptr<Expr > left;
-   std::unique_ptr<Expr > right;
+   Expr *condition;
+   Expr *left;
+   Expr *right;
    public:
- Ternary(std::unique_ptr<Expr >& condition,std::unique_ptr<Expr >& left,std::unique_ptr<Expr >& right):condition(std::move(condition)),left(std::move(left)),right(std::move(right)){};
+ Ternary(Expr *condition,Expr *left,Expr *right):Expr(ExprKind::Ternary),condition(condition),left(left),right(right){};
 MAKE_VISITABLE_Expr
 };
 class Literal: public Expr{
    public:
-   std::any value;
+   Lox::Object value;
    public:
- Literal(std::any value):value(value){};
+ Literal(Lox::Object value):Expr(ExprKind::Literal),value(value){};
 MAKE_VISITABLE_Expr
 };
 class Unary: public Expr{
    public:
    Token oper;
-   std::unique_ptr<Expr > right;
+   Expr *right;
+   uint32_t specialization{};
    public:
- Unary(Token oper,std::unique_ptr<Expr >& right):oper(oper),right(std::move(right)){};
+ Unary(Token oper,Expr *right):Expr(ExprKind::Unary),oper(oper),right(right){};
 MAKE_VISITABLE_Expr
 };
 class Nothing: public Expr{
    public:
    std::string nothing;
    public:
- Nothing(std::string nothing):nothing(nothing){};
+ Nothing(std::string nothing):Expr(ExprKind::Nothing),nothing(nothing){};
 MAKE_VISITABLE_Expr
 };
 class Variable: public Expr{
    public:
    Token name;
+   Lox::Slot slot{};
+   uint32_t specialization{};
    public:
- Variable(Token name):name(name){};
+ Variable(Token name):Expr(ExprKind::Variable),name(name){};
 MAKE_VISITABLE_Expr
 };
 class Logical: public Expr{
    public:
-   std::unique_ptr<Expr > left;
+   Expr *left;
    Token oper;
-   std::unique_ptr<Expr > right;
+   Expr *right;
    public:
- Logical(std::unique_ptr<Expr >& left,Token oper,std::unique_ptr<Expr >& right):left(std::move(left)),oper(oper),right(std::move(right)){};
+ Logical(Expr *left,Token oper,Expr *right):Expr(ExprKind::Logical),left(left),oper(oper),right(right){};
 MAKE_VISITABLE_Expr
 };
 class Assign: public Expr{
    public:
    Token name;
-   std::unique_ptr<Expr > value;
+   Expr *value;
+   Lox::Slot slot{};
    public:
- Assign(Token name,std::unique_ptr<Expr >& value):name(name),value(std::move(value)){};
+ Assign(Token name,Expr *value):Expr(ExprKind::Assign),name(name),value(value){};
 MAKE_VISITABLE_Expr
 };
 class Call: public Expr{
    public:
-   std::unique_ptr<Expr > callee;
+   Expr *callee;
    Token paren;
-   Lox::VecUniquePtr<Expr> arguments;
+   Lox::NodeList<Expr*> arguments;
    public:
- Call(std::unique_ptr<Expr >& callee,Token paren,Lox::VecUniquePtr<Expr> arguments):callee(std::move(callee)),paren(paren),arguments(arguments){};
+ Call(Expr *callee,Token paren,Lox::NodeList<Expr*> arguments):Expr(ExprKind::Call),callee(callee),paren(paren),arguments(arguments){};
 MAKE_VISITABLE_Expr
 };
 class FunctionExpr: public Expr{
    public:
-   std::vector<Token> params;
-   Lox::VecUniquePtr<Stmt> body;
+   Lox::NodeList<Token> params;
+   Lox::NodeList<Stmt*> body;
+   int num_slots{};
+   bool captured{};
+   public:
+ FunctionExpr(Lox::NodeList<Token> params,Lox::NodeList<Stmt*> body):Expr(ExprKind::FunctionExpr),params(params),body(body){};
+MAKE_VISITABLE_Expr
+};
+class Get: public Expr{
+   public:
+   Expr *object;
+   Token name;
+   uint32_t cache{};
+   public:
+ Get(Expr *object,Token name):Expr(ExprKind::Get),object(object),name(name){};
+MAKE_VISITABLE_Expr
+};
+class Set: public Expr{
+   public:
+   Expr *object;
+   Token name;
+   Expr *value;
+   uint32_t cache{};
+   public:
+ Set(Expr *object,Token name,Expr *value):Expr(ExprKind::Set),object(object),name(name),value(value){};
+MAKE_VISITABLE_Expr
+};
+class This: public Expr{
+   public:
+   Token keyword;
+   Lox::Slot slot{};
+   public:
+ This(Token keyword):Expr(ExprKind::This),keyword(keyword){};
+MAKE_VISITABLE_Expr
+};
+class Super: public Expr{
+   public:
+   Token keyword;
+   Token method;
+   Lox::Slot slot{};
+   Lox::Slot this_slot{};
+   uint32_t cache{};
    public:
- FunctionExpr(std::vector<Token> params,Lox::VecUniquePtr<Stmt> body):params(params),body(body){};
+ Super(Token keyword,Token method):Expr(ExprKind::Super),keyword(keyword),method(method){};
 MAKE_VISITABLE_Expr
 };
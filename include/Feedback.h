@@ -0,0 +1,31 @@
+#ifndef LOX_FEEDBACK_H
+#define LOX_FEEDBACK_H
+
+#include <vector>
+#include "Program.h"
+#include "Shape.h"
+#include "types.h"
+
+namespace Lox {
+
+    // What one interpreter has learned running one program: how its quickened nodes specialized and what its
+    // property accesses found. Nodes refer to their entries by the numbers the Resolver gave them, so the tree
+    // itself is never written while it runs and any number of interpreters can run it at once. Functions keep
+    // the Feedback of the program that declared them, the interpreter switches to it for the call.
+    struct Feedback {
+        const uint64_t program_id;
+        std::vector<Specialization> specializations;
+        std::vector<PropertyCache> caches;
+        // the slot in the interpreter's global table of each of Program::global_names
+        std::vector<int> global_slots;
+
+        Feedback(uint64_t program_id, size_t specialization_count, size_t cache_count)
+                : program_id(program_id), specializations(specialization_count), caches(cache_count) {};
+
+        explicit Feedback(const Program &program) : Feedback(program.id, program.specialization_count,
+                                                             program.cache_count) {};
+    };
+
+} // Lox
+
+#endif //LOX_FEEDBACK_H
@@ -0,0 +1,158 @@
+#ifndef LOX_HEAP_H
+#define LOX_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Lox {
+    class Heap;
+
+    class Value;
+
+    class LoxString;
+
+    class ObjectCopier;
+
+    enum class ObjType : uint8_t {
+        STRING,
+        ENVIRONMENT,
+        CALLABLE,
+        INSTANCE,
+        // objects of the bytecode VM, see Obj.h
+        FUNCTION,
+        NATIVE,
+        CLOSURE,
+        UPVALUE,
+        CLASS,
+        VM_INSTANCE,
+        BOUND_METHOD,
+        // a channel between threads of a script, see Concurrency.h
+        CHANNEL,
+    };
+
+    // header of every garbage collected object
+    class Obj {
+    public:
+        ObjType type;
+        bool marked = false;
+        // permanent objects (e.g. string literals) are not owned by any heap and are never traced or freed
+        bool permanent = false;
+        // bytes accounted to the heap when the object was allocated
+        uint32_t gc_size = 0;
+        Obj *next = nullptr;
+
+        explicit Obj(ObjType type) : type(type) {};
+
+        virtual ~Obj() = default;
+
+        // mark every object this one references
+        virtual void trace(Heap &heap) {};
+
+        // approximate number of bytes owned by the object, used to decide when to collect
+        virtual size_t size() const = 0;
+
+        virtual std::string to_string() const = 0;
+
+        // a deep copy of the object on the heap of copier's interpreter, null for objects that can't be copied
+        virtual Obj *copy(ObjectCopier &copier) const { return nullptr; }
+    };
+
+    // implemented by whoever owns a heap (the Interpreter, the VM) to report the objects it can still reach
+    class GcRoots {
+    public:
+        virtual void mark_roots(Heap &heap) = 0;
+
+        virtual ~GcRoots() = default;
+    };
+
+    struct HeapStats {
+        size_t bytes_allocated = 0;
+        size_t peak_bytes_allocated = 0;
+        size_t objects = 0;
+        size_t collections = 0;
+        size_t objects_freed = 0;
+        size_t bytes_freed = 0;
+        double total_pause_ms = 0;
+        double max_pause_ms = 0;
+    };
+
+    // Mark and sweep collector. Objects are allocated through allocate(), which collects first once the heap
+    // has grown past the threshold. Everything reachable from the owner's roots survives.
+    class Heap {
+        GcRoots &roots;
+        Obj *objects = nullptr;
+        std::vector<Obj *> gray_stack;
+        size_t next_gc;
+        size_t min_threshold;
+        double growth_factor = 2.0;
+        int paused = 0;
+        HeapStats heap_stats;
+
+        void link(Obj *object);
+
+        void trace_references();
+
+        void sweep();
+
+    public:
+        static constexpr size_t DEFAULT_THRESHOLD = 1024 * 1024;
+
+        explicit Heap(GcRoots &roots, size_t threshold = DEFAULT_THRESHOLD) : roots(roots), next_gc(threshold),
+                                                                           min_threshold(threshold) {};
+
+        ~Heap();
+
+        Heap(const Heap &) = delete;
+
+        Heap &operator=(const Heap &) = delete;
+
+        template<typename T, typename... Args>
+        T *allocate(Args &&... args) {
+#ifdef LOX_DEBUG_STRESS_GC
+            if (!paused)
+                collect();
+#else
+            if (heap_stats.bytes_allocated > next_gc && !paused)
+                collect();
+#endif
+            T *object = new T(std::forward<Args>(args)...);
+            link(object);
+            return object;
+        }
+
+        LoxString *make_string(std::string chars);
+
+        void mark_object(Obj *object);
+
+        void mark_value(const Value &value);
+
+        void collect();
+
+        // collections are skipped while paused, e.g. while the compiler holds objects the roots don't know about
+        void pause_collection() { paused++; }
+
+        void resume_collection() { paused--; }
+
+        // the heap collects once it grows to `growth_factor` times the live size after the last collection
+        void set_growth_factor(double factor) { growth_factor = factor; }
+
+        void set_threshold(size_t threshold) {
+            min_threshold = threshold;
+            next_gc = threshold;
+        }
+
+        const HeapStats &stats() const { return heap_stats; }
+
+        std::string stats_report() const;
+    };
+
+    // interned string for the names of properties, methods and globals, shared by every heap and never collected.
+    // Their identity is what Shapes and method tables are keyed by. String literals belong to their Program instead
+    LoxString *constant_string(const std::string &chars);
+
+} // Lox
+
+#endif //LOX_HEAP_H
@@ -0,0 +1,124 @@
+#ifndef LOX_ISOLATE_H
+#define LOX_ISOLATE_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "Heap.h"
+#include "LoxExceptions.h"
+#include "Program.h"
+#include "Source.h"
+
+namespace Lox {
+
+    class Interpreter;
+
+    class VM;
+
+    class ProgramCache;
+
+    enum class Engine {
+        TREE_WALKER, // the AST walking Interpreter
+        CLOSURES,    // the tree compiled to pre-bound callables by the ClosureCompiler, run on the Interpreter
+        STACK,       // the Interpreter's iterative evaluation, on an explicit stack instead of the native one
+        VM           // the bytecode Compiler and VM
+    };
+
+    // An independent Lox runtime: its engines with their globals and heaps, the programs it has run, its error
+    // state and the streams it prints to. Any number of isolates can run on different threads at once, but each
+    // one is used by a single thread at a time. A program compiled by one isolate can be run by all of them.
+    // What isolates do share is process wide and only ever grows: the interned names of properties, methods and
+    // globals (constant_string), the Shape transition tree, both behind a mutex, and the atomic counters that
+    // number classes and programs.
+    class Isolate {
+    public:
+        enum class Status {
+            OK,
+            COMPILE_ERROR, // scanning, parsing or resolving failed, nothing ran
+            RUNTIME_ERROR,
+            NO_INPUT       // the script file couldn't be opened
+        };
+
+    private:
+        std::ostream &out;
+        std::ostream &err;
+        Engine engine = Engine::TREE_WALKER;
+        int optimization_level = 1;
+        std::unique_ptr<Interpreter> interpreter;
+        std::unique_ptr<VM> vm;
+        // functions keep pointers into the tree they were declared in, so programs live as long as the isolate.
+        // By Program::id
+        std::unordered_map<uint64_t, std::shared_ptr<const Program>> programs;
+        // closure code for programs that were compiled without it, by Program::id
+        std::unique_ptr<Arena> closure_arena = std::make_unique<Arena>();
+        std::unordered_map<uint64_t, NodeList<const CompiledStmt *>> closure_code;
+        const ProgramCache *cache = nullptr;
+        bool had_error = false;
+        bool had_runtime_error = false;
+
+        // compile, parsing with the help of program_cache if there is one
+        std::shared_ptr<const Program> compile(Source source, const ProgramCache *program_cache);
+
+        void execute(const Program &program, bool print_expressions);
+
+        // the status of the run that just finished
+        Status status() const;
+
+    public:
+        explicit Isolate(std::ostream &out = std::cout, std::ostream &err = std::cerr);
+
+        ~Isolate();
+
+        Isolate(const Isolate &) = delete;
+
+        Isolate &operator=(const Isolate &) = delete;
+
+        void set_engine(Engine engine);
+
+        // how deeply Lox calls may nest on the STACK engine before it reports a stack overflow
+        void set_max_depth(size_t depth);
+
+        // 0 runs programs as parsed, 1 (the default) runs the Optimizer over them first, 2 also lets the tree
+        // walker specialize nodes to the operand types it sees (quickening)
+        void set_optimization_level(int level);
+
+        // where run_file looks for and stores parsed scripts, null for none. The cache may be shared by isolates
+        void set_cache(const ProgramCache *program_cache) { cache = program_cache; }
+
+        // Scans, parses, resolves and optimizes `source` with this isolate's settings, closure compiling it too if
+        // that is its engine. The program is never written again, any number of isolates can run it at once.
+        // Null after a compile error, which is reported like those of run.
+        std::shared_ptr<const Program> compile(Source source);
+
+        // runs a compiled program, with print_expressions expression statements print their value. Globals persist
+        // from one run to the next
+        Status run(const std::shared_ptr<const Program> &program, bool print_expressions = false);
+
+        // compiles and runs `source`
+        Status run(Source source, bool print_expressions = false);
+
+        // runs the script at `path`, parsed from the cache if it has it
+        Status run_file(const std::string &path);
+
+        // Forgets the globals and programs of earlier runs, so the next run starts as in a new isolate but without
+        // paying for its construction
+        void reset();
+
+        // statistics of the heap owned by the current engine
+        const HeapStats &heap_stats() const;
+
+        std::string heap_stats_report() const;
+
+        // the isolate running on this thread, which Lox::error and Lox::runtime_error report to. Null outside of
+        // run and run_file
+        static Isolate *current();
+
+        void report(int line, const std::string &where, const std::string &message);
+
+        void runtime_error(RuntimeException &e);
+    };
+
+} // Lox
+
+#endif //LOX_ISOLATE_H
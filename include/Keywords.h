@@ -0,0 +1,72 @@
+#ifndef LOX_KEYWORDS_H
+#define LOX_KEYWORDS_H
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include "types.h"
+
+namespace Lox {
+
+    struct Keyword {
+        std::string_view text;
+        token_type type;
+    };
+
+    constexpr Keyword KEYWORDS[] = {{"and",    AND},
+                                    {"class",  CLASS},
+                                    {"else",   ELSE},
+                                    {"false",  FALSE},
+                                    {"for",    FOR},
+                                    {"fun",    FUN},
+                                    {"if",     IF},
+                                    {"nil",    NIL},
+                                    {"or",     OR},
+                                    {"print",  PRINT},
+                                    {"return", RETURN},
+                                    {"super",  SUPER},
+                                    {"this",   THIS},
+                                    {"true",   TRUE},
+                                    {"var",    VAR},
+                                    {"while",  WHILE},
+                                    {"break",  T_BREAK},
+    };
+
+    constexpr size_t KEYWORD_MIN_LENGTH = 2;
+    constexpr size_t KEYWORD_MAX_LENGTH = 6;
+    constexpr size_t KEYWORD_TABLE_SIZE = 32;
+
+    // perfect hash over the keywords above, a static_assert below fails if a new keyword collides
+    constexpr size_t keyword_hash(std::string_view text) {
+        return ((unsigned char) text.front() + (unsigned char) text.back() * 7 + text.size()) % KEYWORD_TABLE_SIZE;
+    }
+
+    constexpr std::array<Keyword, KEYWORD_TABLE_SIZE> build_keyword_table() {
+        std::array<Keyword, KEYWORD_TABLE_SIZE> table{};
+        for (auto &keyword: KEYWORDS)
+            table[keyword_hash(keyword.text)] = keyword;
+        return table;
+    }
+
+    constexpr std::array<Keyword, KEYWORD_TABLE_SIZE> KEYWORD_TABLE = build_keyword_table();
+
+    constexpr bool keyword_hash_is_perfect() {
+        for (auto &keyword: KEYWORDS)
+            if (KEYWORD_TABLE[keyword_hash(keyword.text)].text != keyword.text)
+                return false;
+        return true;
+    }
+
+    static_assert(keyword_hash_is_perfect(), "keyword_hash has collisions, pick other multipliers or table size");
+
+    // IDENTIFIER unless `text` is a reserved word, one hash and at most one comparison
+    constexpr token_type identifier_type(std::string_view text) {
+        if (text.size() < KEYWORD_MIN_LENGTH || text.size() > KEYWORD_MAX_LENGTH)
+            return IDENTIFIER;
+        const Keyword &keyword = KEYWORD_TABLE[keyword_hash(text)];
+        return keyword.text == text ? keyword.type : IDENTIFIER;
+    }
+
+} // Lox
+
+#endif //LOX_KEYWORDS_H
@@ -0,0 +1,136 @@
+#ifndef LOX_LOXCLASS_H
+#define LOX_LOXCLASS_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Callable.h"
+#include "Shape.h"
+
+namespace Lox {
+
+    // A class of the tree walking engines. Methods are copied down from the superclass when the class is created,
+    // so a lookup is a single hash probe whatever the depth of the hierarchy. Calling the class makes an instance
+    // and runs init on it.
+    class LoxClass final : public Callable {
+        std::unordered_map<LoxString *, Callable *> methods;
+        Callable *initializer = nullptr;
+    public:
+        const std::string name;
+        const uint64_t id = next_class_id();
+        LoxClass *const superclass;
+        // the most fields an instance of the class has had, new instances reserve room for that many
+        uint32_t field_hint = 0;
+
+        LoxClass(std::string name, LoxClass *superclass);
+
+        // the superclass `value` names, a runtime error at `name` if it isn't a class
+        static LoxClass *superclass_of(const Object &value, const Token &name);
+
+        void add_method(LoxString *method_name, Callable *method);
+
+        Callable *init() const { return initializer; }
+
+        Callable *find_method(LoxString *method_name) const {
+            auto itr = methods.find(method_name);
+            return itr == methods.end() ? nullptr : itr->second;
+        }
+
+        // the method `method_name` names for a `super` access, cached by class in `cache`
+        Callable *super_method(const Token &method_name, PropertyCache &cache);
+
+        Object call(Interpreter &interpreter, Arguments arguments) override;
+
+        int arity() override { return initializer ? initializer->arity() : 0; }
+
+        void trace(Heap &heap) override;
+
+        size_t size() const override { return sizeof(LoxClass); }
+
+        Obj *copy(ObjectCopier &copier) const override;
+
+        std::string to_string() const override { return name; }
+    };
+
+    // Fields live in a vector indexed by the slots of the instance's Shape, so a cached access skips the name
+    // lookup altogether.
+    class LoxInstance final : public Obj {
+        // where `name` is on this instance, a field slot or a method. False if it is neither
+        bool resolve(const Token &name, PropertyCache &cache, PropertyCache::Entry &entry) {
+            if (const PropertyCache::Entry *hit = cache.find(fields.shape, klass->id)) {
+                entry = *hit;
+                return true;
+            }
+            return resolve_miss(name, cache, entry);
+        }
+
+        bool resolve_miss(const Token &name, PropertyCache &cache, PropertyCache::Entry &entry);
+
+        [[noreturn]] static void undefined(const Token &name);
+
+    public:
+        LoxClass *const klass;
+        Fields fields;
+
+        explicit LoxInstance(LoxClass *klass) : Obj(ObjType::INSTANCE), klass(klass) {
+            fields.values.reserve(klass->field_hint);
+        }
+
+        // the instance a property is read from or a method invoked on, else "Only instances have properties."
+        static LoxInstance *receiver(const Object &value, const Token &name);
+
+        // the instance a field is set on, else "Only instances have fields."
+        static LoxInstance *target(const Object &value, const Token &name);
+
+        // the field `name`, or the method bound to this instance. The instance has to be rooted by the caller,
+        // binding allocates
+        Object get(Heap &heap, const Token &name, PropertyCache &cache);
+
+        void set(const Token &name, PropertyCache &cache, Object value);
+
+        // for an invoke, the method `name` without binding it. A field of that name is returned in `field`
+        Callable *method(const Token &name, PropertyCache &cache, Object &field) {
+            PropertyCache::Entry entry{};
+            if (!resolve(name, cache, entry))
+                undefined(name);
+            if (entry.method)
+                return static_cast<Callable *>(entry.method);
+            field = fields.values[entry.slot];
+            return nullptr;
+        }
+
+        void trace(Heap &heap) override;
+
+        size_t size() const override { return sizeof(LoxInstance) + fields.values.capacity() * sizeof(Object); }
+
+        Obj *copy(ObjectCopier &copier) const override;
+
+        std::string to_string() const override { return klass->name + " instance"; }
+    };
+
+    // a method read off an instance without calling it
+    class BoundMethod final : public Callable {
+    public:
+        const Object receiver;
+        Callable *const method;
+
+        BoundMethod(Object receiver, Callable *method) : receiver(receiver), method(method) {};
+
+        Object call(Interpreter &interpreter, Arguments arguments) override {
+            return method->call_method(interpreter, receiver, arguments);
+        }
+
+        int arity() override { return method->arity(); }
+
+        void trace(Heap &heap) override;
+
+        size_t size() const override { return sizeof(BoundMethod); }
+
+        Obj *copy(ObjectCopier &copier) const override;
+
+        std::string to_string() const override { return method->to_string(); }
+    };
+
+} // Lox
+
+#endif //LOX_LOXCLASS_H
@@ -20,15 +20,6 @@ namespace Lox {
         const char *what();
     };
 
-    class BreakException : public std::exception {
-    };
-
-    class ReturnException : public std::exception {
-    public:
-        Object value;
-        ReturnException(Object value) : value(value) {};
-    };
-
 } // Lox
 
 #endif //LOX_LOXEXCEPTIONS_H
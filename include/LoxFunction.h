@@ -10,21 +10,44 @@
 
 namespace Lox {
 
-    class LoxFunction : public Callable {
+    class LoxFunction final : public Callable {
         FunctionExpr* function_definition;
         Environment *closure;
+        // of the program the function was declared in
+        Feedback *function_feedback;
         std::optional<Token> name;
+        FunctionKind kind = FunctionKind::FUNCTION;
+
+        // runs the function and whatever it tail calls, receiver is only used by methods
+        Object run(Interpreter &interpreter, Object receiver, Arguments arguments);
     public:
-        LoxFunction(FunctionExpr* ptr, Environment *closure);
+        LoxFunction(FunctionExpr* ptr, Environment *closure, Feedback *feedback);
+
+        LoxFunction(Token name, FunctionExpr* ptr, Environment *closure, Feedback *feedback,
+                    FunctionKind kind = FunctionKind::FUNCTION);
+
+        Object call(Interpreter &interpreter, Arguments arguments) override;
+
+        Object call_method(Interpreter &interpreter, Object receiver, Arguments arguments) override;
+
+        int arity() override;
+
+        FunctionExpr *definition() const { return function_definition; }
+
+        Environment *enclosing() const { return closure; }
+
+        Feedback *feedback() const { return function_feedback; }
+
+        FunctionKind function_kind() const { return kind; }
 
-        LoxFunction(Token name,FunctionExpr* ptr, Environment *closure);
+        void trace(Heap &heap) override;
 
-        Object call(Interpreter &interpreter, std::vector<Object> arguments);
+        size_t size() const override { return sizeof(LoxFunction); }
 
-        int arity();
+        Obj *copy(ObjectCopier &copier) const override;
 
-        operator std::string() const {
-            return "<fn " + (name ? (name->lexeme) : "anonymous") + ">";
+        std::string to_string() const override {
+            return "<fn " + (name ? std::string(name->lexeme) : "anonymous") + ">";
         }
 
     };
@@ -0,0 +1,153 @@
+#ifndef LOX_OBJ_H
+#define LOX_OBJ_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Chunk.h"
+#include "Shape.h"
+#include "Value.h"
+
+namespace Lox {
+
+    // heap objects of the bytecode VM, allocated on the VM's Heap
+
+    class ObjFunction : public Obj {
+    public:
+        int arity = 0;
+        int upvalue_count = 0;
+        Chunk chunk;
+        // empty for anonymous functions and the top level script
+        std::string name;
+
+        ObjFunction() : Obj(ObjType::FUNCTION) {};
+
+        void trace(Heap &heap) override;
+
+        size_t size() const override { return sizeof(ObjFunction); }
+
+        std::string to_string() const override;
+    };
+
+    typedef Value (*NativeFn)(int arg_count, Value *args);
+
+    class ObjNative : public Obj {
+    public:
+        NativeFn function;
+        int arity;
+
+        ObjNative(NativeFn function, int arity) : Obj(ObjType::NATIVE), function(function), arity(arity) {};
+
+        size_t size() const override { return sizeof(ObjNative); }
+
+        std::string to_string() const override;
+    };
+
+    // a captured variable, pointing at its stack slot while open and at `closed` once the slot is popped
+    class ObjUpvalue : public Obj {
+    public:
+        Value *location;
+        Value closed;
+        ObjUpvalue *next_open = nullptr;
+
+        explicit ObjUpvalue(Value *slot) : Obj(ObjType::UPVALUE), location(slot) {};
+
+        // an open upvalue's slot is on the VM stack, which is a root already
+        void trace(Heap &heap) override { heap.mark_value(closed); }
+
+        size_t size() const override { return sizeof(ObjUpvalue); }
+
+        std::string to_string() const override;
+    };
+
+    class ObjClosure : public Obj {
+    public:
+        ObjFunction *function;
+        std::vector<ObjUpvalue *> upvalues;
+
+        explicit ObjClosure(ObjFunction *function) : Obj(ObjType::CLOSURE), function(function),
+                                                     upvalues(function->upvalue_count, nullptr) {};
+
+        void trace(Heap &heap) override;
+
+        size_t size() const override { return sizeof(ObjClosure) + upvalues.capacity() * sizeof(ObjUpvalue *); }
+
+        std::string to_string() const override;
+    };
+
+    // a class of the VM. Like the tree walkers' classes, methods are copied down from the superclass by OP_INHERIT
+    class ObjClass : public Obj {
+    public:
+        std::string name;
+        const uint64_t id = next_class_id();
+        std::unordered_map<LoxString *, ObjClosure *> methods;
+        ObjClosure *initializer = nullptr;
+        // the most fields an instance of the class has had, new instances reserve room for that many
+        uint32_t field_hint = 0;
+
+        explicit ObjClass(std::string name) : Obj(ObjType::CLASS), name(std::move(name)) {};
+
+        ObjClosure *find_method(LoxString *method_name) const {
+            auto itr = methods.find(method_name);
+            return itr == methods.end() ? nullptr : itr->second;
+        }
+
+        // the method cache.name for a `super` access, null if there is none
+        ObjClosure *super_method(PropertyCache &cache);
+
+        void trace(Heap &heap) override;
+
+        size_t size() const override { return sizeof(ObjClass); }
+
+        std::string to_string() const override { return name; }
+    };
+
+    class ObjInstance : public Obj {
+    public:
+        ObjClass *klass;
+        Fields fields;
+
+        explicit ObjInstance(ObjClass *klass) : Obj(ObjType::VM_INSTANCE), klass(klass) {
+            fields.values.reserve(klass->field_hint);
+        }
+
+        // where cache.name is on this instance, a field slot or a method, from the cache or else looked up and
+        // remembered. Null if it is neither
+        const PropertyCache::Entry *resolve(PropertyCache &cache, PropertyCache::Entry &miss) {
+            if (const PropertyCache::Entry *hit = cache.find(fields.shape, klass->id))
+                return hit;
+            return resolve_miss(cache, miss);
+        }
+
+        const PropertyCache::Entry *resolve_miss(PropertyCache &cache, PropertyCache::Entry &miss);
+
+        void set(PropertyCache &cache, Value value) {
+            if (fields.set(cache, value) && fields.shape->field_count() > klass->field_hint)
+                klass->field_hint = fields.shape->field_count();
+        }
+
+        void trace(Heap &heap) override;
+
+        size_t size() const override { return sizeof(ObjInstance) + fields.values.capacity() * sizeof(Value); }
+
+        std::string to_string() const override { return klass->name + " instance"; }
+    };
+
+    class ObjBoundMethod : public Obj {
+    public:
+        Value receiver;
+        ObjClosure *method;
+
+        ObjBoundMethod(Value receiver, ObjClosure *method) : Obj(ObjType::BOUND_METHOD), receiver(receiver),
+                                                             method(method) {};
+
+        void trace(Heap &heap) override;
+
+        size_t size() const override { return sizeof(ObjBoundMethod); }
+
+        std::string to_string() const override { return method->to_string(); }
+    };
+
+} // Lox
+
+#endif //LOX_OBJ_H
@@ -0,0 +1,109 @@
+#ifndef LOX_OPTIMIZER_H
+#define LOX_OPTIMIZER_H
+
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Expr.hpp"
+#include "Stmt.hpp"
+#include "Program.h"
+#include "types.h"
+
+namespace Lox {
+
+    // Rewrites a program's tree in place before it runs (-O1). Operators over literals are folded, groupings
+    // dropped, constant ternaries, logicals, ifs and whiles reduced to the branch that runs, and reads of local
+    // variables that are initialized with a literal and never assigned replaced by that literal. An operation that
+    // would raise a runtime error is left as it is so the error still happens, with its line. Runs after the
+    // Resolver, the slots it assigned stay valid because no declaration is removed.
+    class Optimizer : public ExprVisitor, public StmtVisitor {
+        // the declaration each name in a local scope refers to, innermost scope last. Globals are never tracked,
+        // they can be assigned from anywhere (and from later REPL lines)
+        std::vector<std::unordered_map<std::string_view, Var *>> scopes;
+        // locals assigned somewhere, found by a first pass over the tree
+        std::unordered_set<Var *> assigned;
+        std::unordered_map<Var *, Object> constants;
+        bool finding_assignments = false;
+        Program &program;
+        Expr *expr_result = nullptr;
+        Stmt *stmt_result = nullptr;
+
+        Expr *optimize(Expr *expr);
+
+        Stmt *optimize(Stmt *stmt);
+
+        NodeList<Stmt *> optimize(NodeList<Stmt *> statements);
+
+        // a statement that is needed where a removed one was the only child
+        Stmt *empty_block();
+
+        void optimize_function(FunctionExpr *function);
+
+        void declare(const Token &name, Var *var);
+
+        Var *lookup(const Token &name);
+
+        Literal *literal(Expr *expr);
+
+        Expr *fold_binary(Binary *expr, const Object &left, const Object &right);
+
+    public:
+        explicit Optimizer(Program &program) : program(program) {};
+
+        void optimize_program();
+
+        void visit(Expression *stmt) override;
+
+        void visit(Print *stmt) override;
+
+        void visit(Block *stmt) override;
+
+        void visit(Var *stmt) override;
+
+        void visit(If *stmt) override;
+
+        void visit(While *stmt) override;
+
+        void visit(Break *stmt) override;
+
+        void visit(Return *stmt) override;
+
+        void visit(Function *stmt) override;
+
+        void visit(Class *stmt) override;
+
+        void visit(Binary *expr) override;
+
+        void visit(Grouping *expr) override;
+
+        void visit(Ternary *expr) override;
+
+        void visit(Literal *expr) override;
+
+        void visit(Unary *expr) override;
+
+        void visit(Nothing *expr) override;
+
+        void visit(Variable *expr) override;
+
+        void visit(Logical *expr) override;
+
+        void visit(Assign *expr) override;
+
+        void visit(Call *expr) override;
+
+        void visit(FunctionExpr *expr) override;
+
+        void visit(Get *expr) override;
+
+        void visit(Set *expr) override;
+
+        void visit(This *expr) override;
+
+        void visit(Super *expr) override;
+    };
+
+} // Lox
+
+#endif //LOX_OPTIMIZER_H
@@ -0,0 +1,50 @@
+#ifndef LOX_PROGRAM_H
+#define LOX_PROGRAM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Arena.h"
+#include "Source.h"
+#include "Stmt.fwd.hpp"
+
+namespace Lox {
+
+    struct CompiledStmt;
+
+    class LoxString;
+
+    // The result of one parse. Every AST node is allocated in the program's arena and tokens point into its
+    // source, so the whole tree is freed together with the program and functions created from it must not
+    // outlive it. Once resolved (and optimized) a program is never written again: what interpreters learn while
+    // running it lives in their Feedback, so one program can run in any number of them at once.
+    class Program {
+    public:
+        // tells programs apart for the lifetime of the process, unlike their addresses
+        const uint64_t id;
+        Source source;
+        Arena arena;
+        NodeList<Stmt *> statements;
+        // entries of a Feedback for this program, numbered by the Resolver
+        uint32_t specialization_count = 0;
+        uint32_t cache_count = 0;
+        // the globals the program names, a global Slot indexes this. Each interpreter maps them to slots of its
+        // own global table the first time it runs the program
+        std::vector<std::string> global_names;
+        // the statements compiled by the ClosureCompiler, if the program was compiled for that engine
+        NodeList<const CompiledStmt *> closure_code;
+        bool has_closure_code = false;
+
+        Program();
+
+        // a permanent string for a literal of the program, allocated in its arena so it is freed with the tree
+        LoxString *constant_string(std::string chars);
+
+        Program(const Program &) = delete;
+
+        Program &operator=(const Program &) = delete;
+    };
+
+} // Lox
+
+#endif //LOX_PROGRAM_H
@@ -0,0 +1,44 @@
+#ifndef LOX_PROGRAMCACHE_H
+#define LOX_PROGRAMCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "Program.h"
+
+namespace Lox {
+
+    // Stores parsed programs as .loxc files so an unchanged script skips the Scanner and Parser on later runs.
+    // Files are named after a hash of the source text and hold the tree in preorder with tokens as offsets into
+    // that source. A file with another format version, or one that doesn't describe the source, is ignored.
+    // Resolution is not cached because global slots belong to the interpreter the program runs in.
+    class ProgramCache {
+        std::string directory;
+
+    public:
+        static constexpr uint32_t FORMAT_VERSION = 2;
+
+        explicit ProgramCache(std::string directory) : directory(std::move(directory)) {};
+
+        // $LOX_CACHE_DIR, else $XDG_CACHE_HOME/lox or $HOME/.cache/lox. Empty if none of them is set
+        static std::string default_directory();
+
+        static uint64_t hash_source(std::string_view source);
+
+        std::string path_for(std::string_view source) const;
+
+        // fills in program.statements from the cached tree for program.source, false on a miss
+        bool load(Program &program) const;
+
+        // writes the parsed program, failures only mean the next run parses again
+        void store(const Program &program) const;
+
+        static std::string serialize(const Program &program);
+
+        // rebuilds the tree in `data` into the program's arena, false if `data` isn't a tree of program.source
+        static bool deserialize(std::string_view data, Program &program);
+    };
+
+} // Lox
+
+#endif //LOX_PROGRAMCACHE_H
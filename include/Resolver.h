@@ -0,0 +1,117 @@
+#ifndef LOX_RESOLVER_H
+#define LOX_RESOLVER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Expr.hpp"
+#include "Stmt.hpp"
+#include "Program.h"
+#include "types.h"
+
+namespace Lox {
+    // Static pass run between parsing and interpretation. Computes a (depth, slot) pair for every variable
+    // declaration and reference so that environments can be flat arrays and lookups never hash names, and numbers
+    // the nodes that keep Feedback.
+    class Resolver : public ExprVisitor, StmtVisitor {
+        enum class FunctionType {
+            NONE,
+            FUNCTION,
+            METHOD,
+            INITIALIZER
+        };
+
+        enum class ClassType {
+            NONE,
+            CLASS,
+            SUBCLASS
+        };
+
+        // one entry per environment the interpreter will create at runtime, mapping names to slots
+        std::vector<std::unordered_map<std::string_view, int>> scopes;
+        Program *program = nullptr;
+        // the index of each name in Program::global_names
+        std::unordered_map<std::string_view, int> globals;
+        FunctionType current_function = FunctionType::NONE;
+        ClassType current_class = ClassType::NONE;
+        // functions resolved so far. A scope that sees this change declares a function, which may capture its
+        // environment; the environments of the other scopes can be reused once they exit
+        int functions_resolved = 0;
+
+        void resolve(Stmt *stmt);
+
+        void resolve(Expr *expr);
+
+        void resolve(NodeList<Stmt *> statements);
+
+        void resolve_function(FunctionExpr *function, FunctionType type);
+
+        Slot declare(const Token &name);
+
+        Slot resolve_local(const Token &name);
+
+        // the global slot of `name` in the program
+        Slot global(const Token &name);
+
+        static bool declares_variables(NodeList<Stmt *> statements);
+
+        // whether returning `value` makes a call in tail position: the value itself, or a branch of a conditional
+        static bool has_tail_call(Expr *value);
+
+    public:
+        void resolve_program(Program &program);
+
+        void visit(Expression *stmt) override;
+
+        void visit(Print *stmt) override;
+
+        void visit(Block *stmt) override;
+
+        void visit(Var *stmt) override;
+
+        void visit(If *stmt) override;
+
+        void visit(While *stmt) override;
+
+        void visit(Break *stmt) override;
+
+        void visit(Return *stmt) override;
+
+        void visit(Function *stmt) override;
+
+        void visit(Class *stmt) override;
+
+        void visit(Binary *expr) override;
+
+        void visit(Grouping *expr) override;
+
+        void visit(Ternary *expr) override;
+
+        void visit(Literal *expr) override;
+
+        void visit(Unary *expr) override;
+
+        void visit(Nothing *expr) override;
+
+        void visit(Variable *expr) override;
+
+        void visit(Logical *expr) override;
+
+        void visit(Assign *expr) override;
+
+        void visit(Call *expr) override;
+
+        void visit(FunctionExpr *expr) override;
+
+        void visit(Get *expr) override;
+
+        void visit(Set *expr) override;
+
+        void visit(This *expr) override;
+
+        void visit(Super *expr) override;
+    };
+
+} // Lox
+
+#endif //LOX_RESOLVER_H
@@ -0,0 +1,31 @@
+#ifndef LOX_SCANKERNELS_H
+#define LOX_SCANKERNELS_H
+
+namespace Lox {
+
+    enum class SimdLevel {
+        SCALAR, SSE2, AVX2
+    };
+
+    // The byte loops the scanner spends most of its time in. Each returns the first byte that stops the scan, or
+    // `end`, and adds the newlines it stepped over to `lines` so token line numbers stay exact.
+    struct ScanKernels {
+        SimdLevel level;
+        const char *name;
+        // skips spaces, tabs, carriage returns and newlines
+        const char *(*skip_whitespace)(const char *p, const char *end, int &lines);
+        // finds the next `c`; newlines before it are counted, so `c` itself should not be '\n' unless that is wanted
+        const char *(*find_char)(const char *p, const char *end, char c, int &lines);
+    };
+
+    // best level this CPU supports, checked once at runtime
+    SimdLevel detect_simd_level();
+
+    // kernels for `level`, or for the best supported level below it
+    const ScanKernels &scan_kernels(SimdLevel level);
+
+    // kernels for the detected level
+    const ScanKernels &scan_kernels();
+}
+
+#endif //LOX_SCANKERNELS_H
@@ -0,0 +1,106 @@
+#ifndef LOX_SERVER_H
+#define LOX_SERVER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Batch.h"
+
+namespace Lox {
+
+    // Keeps warm isolates and the programs they compiled resident, running the scripts clients send over a Unix
+    // domain socket. A connection carries any number of requests, one after the other, but holds a worker only
+    // while one of them runs: between requests it is watched by serve, with the others. Requests are a kind byte,
+    // 's' for script text or 'p' for the path of a script, then the length of the text or path as a 32 bit
+    // integer and its bytes. Responses are the Isolate::Status as a byte, the run time in microseconds as a 32 bit
+    // integer, then what the script printed and the errors it reported, each as a length and bytes. Integers are
+    // in the machine's byte order, both ends are on one machine.
+    class Server {
+        std::string socket_path;
+        BatchOptions options;
+        int listener = -1;
+        // written to when a worker hands a connection back or the server stops, to wake serve from poll
+        int wake[2] = {-1, -1};
+        bool stopping = false;
+        // connections with a request waiting for a worker
+        std::deque<int> connections;
+        // connections a worker is serving
+        std::vector<int> active;
+        // connections a worker finished a request on, for serve to watch for the next one
+        std::vector<int> returned;
+        std::mutex mutex;
+        std::condition_variable connection_ready;
+        // compiled programs by the hash of their source, cleared when it holds MAX_PROGRAMS
+        std::unordered_map<uint64_t, std::shared_ptr<const Program>> programs;
+        std::mutex programs_mutex;
+
+        void work();
+
+        // serves the next request on connection, false if the connection is closed, broken or malformed
+        bool handle(int connection, Isolate &isolate, std::ostringstream &out, std::ostringstream &err);
+
+        void wake_serve();
+
+        // the program for `source`, compiled by `isolate` unless an earlier request had the same text
+        std::shared_ptr<const Program> program_for(Source source, Isolate &isolate);
+
+    public:
+        static constexpr size_t MAX_PROGRAMS = 1024;
+        static constexpr uint32_t MAX_REQUEST = 64 * 1024 * 1024;
+        // how long a request may stall halfway, or a client leave its reply unread, before its connection is dropped
+        static constexpr int REQUEST_TIMEOUT_SECONDS = 10;
+
+        // options.jobs isolates serve requests, one per core if it's 0
+        Server(std::string socket_path, BatchOptions options);
+
+        ~Server();
+
+        Server(const Server &) = delete;
+
+        Server &operator=(const Server &) = delete;
+
+        // binds and listens on the socket, replacing a stale socket file. False, with errno set, if it can't
+        bool listen();
+
+        // serves requests until stop is called
+        void serve();
+
+        // stops serve from any thread, letting the requests in progress finish
+        void stop();
+    };
+
+    // a connection to a Server, the stand-in for a real client in tests and benchmarks
+    class Client {
+        int socket = -1;
+
+        std::optional<ScriptResult> request(char kind, const std::string &payload);
+
+    public:
+        Client() = default;
+
+        ~Client();
+
+        Client(const Client &) = delete;
+
+        Client &operator=(const Client &) = delete;
+
+        // false, with errno set, if there is no server at socket_path
+        bool connect(const std::string &socket_path);
+
+        // runs the script in `source`, nothing if the connection failed
+        std::optional<ScriptResult> run(const std::string &source);
+
+        // runs the script at `path`, which the server resolves against the client's working directory
+        std::optional<ScriptResult> run_file(const std::string &path);
+    };
+
+} // Lox
+
+#endif //LOX_SERVER_H
@@ -0,0 +1,127 @@
+#ifndef LOX_SHAPE_H
+#define LOX_SHAPE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "Value.h"
+
+namespace Lox {
+
+    // Hidden class of an instance: the names of its fields, in the order they were added, which is also the order
+    // of their slots. Instances that got the same fields in the same order share a Shape, so where a property lives
+    // can be cached per Shape instead of looked up by name. Shapes form a tree of transitions starting from
+    // empty(), are shared by every heap and thread and are never freed, so caches compare them by address.
+    class Shape {
+        std::vector<LoxString *> names;
+        mutable std::mutex mutex;
+        mutable std::unordered_map<LoxString *, std::unique_ptr<Shape>> transitions;
+
+        Shape() = default;
+
+    public:
+        Shape(const Shape &) = delete;
+
+        Shape &operator=(const Shape &) = delete;
+
+        // the shape of an instance without fields
+        static const Shape *empty();
+
+        // slot of the field `name`, -1 if objects of this shape don't have it. Names are interned
+        int find(LoxString *name) const {
+            for (size_t i = 0; i < names.size(); i++) {
+                if (names[i] == name)
+                    return (int) i;
+            }
+            return -1;
+        }
+
+        // the shape after adding the field `name`, which goes into slot field_count()
+        const Shape *add(LoxString *name) const;
+
+        uint32_t field_count() const { return (uint32_t) names.size(); }
+    };
+
+    // a process wide unique id for every class, used by caches instead of a class's address, which a class
+    // allocated after it was collected could reuse
+    uint64_t next_class_id();
+
+    // Inline cache of a property access site. Remembers what the property was for the last few shapes seen there,
+    // so an access to an object of one of them is a pointer compare and an indexed load. A field only depends on the
+    // shape, a method also on the class, as a field of the same name would be in the shape. Starts out empty, is
+    // monomorphic after the first miss and polymorphic up to WAYS entries. Sites that see more shapes than that
+    // (megamorphic) keep what they have and look the rest up by name.
+    struct PropertyCache {
+        struct Entry {
+            const Shape *shape;
+            // for sets, the shape after the set, which adds the field when it differs from shape
+            const Shape *next;
+            uint64_t class_id;
+            // the method the property resolves to, null for a field in slot
+            Obj *method;
+            uint32_t slot;
+        };
+
+        static constexpr int WAYS = 4;
+
+        // interned property name, filled in by the first lookup
+        LoxString *name;
+        Entry entries[WAYS];
+        uint8_t count;
+        bool megamorphic;
+
+        // the entry for an object with `shape` whose class has `class_id`, null on a miss
+        const Entry *find(const Shape *shape, uint64_t class_id) const {
+            for (int i = 0; i < count; i++) {
+                const Entry &entry = entries[i];
+                if (entry.shape == shape && (!entry.method || entry.class_id == class_id))
+                    return &entry;
+            }
+            return nullptr;
+        }
+
+        void remember(const Entry &entry) {
+            if (count == WAYS) {
+                megamorphic = true;
+                return;
+            }
+            entries[count++] = entry;
+        }
+    };
+
+    static_assert(std::is_trivially_destructible<PropertyCache>::value, "caches live in arena allocated nodes");
+
+    // the fields of an instance, laid out by its shape. Shared by the instances of the tree walkers and the VM
+    struct Fields {
+        const Shape *shape = Shape::empty();
+        std::vector<Value> values;
+
+        // stores value into the field cache.name, true if that added the field
+        bool set(PropertyCache &cache, Value value) {
+            // set entries never hold a method, so the class doesn't matter
+            if (const PropertyCache::Entry *entry = cache.find(shape, 0)) {
+                if (entry->next == shape) {
+                    values[entry->slot] = value;
+                    return false;
+                }
+                add(entry->next, value);
+                return true;
+            }
+            return set_miss(cache, value);
+        }
+
+        bool set_miss(PropertyCache &cache, Value value);
+
+        // a new field always goes into the next slot
+        void add(const Shape *next, Value value) {
+            values.push_back(value);
+            shape = next;
+        }
+    };
+
+} // Lox
+
+#endif //LOX_SHAPE_H
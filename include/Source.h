@@ -0,0 +1,52 @@
+#ifndef LOX_SOURCE_H
+#define LOX_SOURCE_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Lox {
+
+    // Program text handed to the Scanner as a read-only view. Regular files are memory mapped, pipes, stdin and
+    // REPL lines are kept in a string.
+    class Source {
+        std::string text;
+        void *mapping = nullptr;
+        size_t mapping_size = 0;
+
+        void unmap();
+
+    public:
+        Source() = default;
+
+        explicit Source(std::string text) : text(std::move(text)) {};
+
+        // maps the file at `path`, or reads it if it can't be mapped. "-" reads stdin
+        static Source from_file(const std::string &path);
+
+        // like from_file, but an unreadable path is reported by returning nothing
+        static std::optional<Source> open(const std::string &path);
+
+        Source(Source &&other) noexcept;
+
+        Source &operator=(Source &&other) noexcept;
+
+        Source(const Source &) = delete;
+
+        Source &operator=(const Source &) = delete;
+
+        ~Source() { unmap(); }
+
+        std::string_view view() const {
+            if (mapping)
+                return {static_cast<const char *>(mapping), mapping_size};
+            return text;
+        }
+
+        bool is_mapped() const { return mapping != nullptr; }
+    };
+
+} // Lox
+
+#endif //LOX_SOURCE_H
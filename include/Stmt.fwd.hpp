@@ -0,0 +1,12 @@
+#pragma once
+class Stmt;
+class Expression;
+class Print;
+class Block;
+class Var;
+class If;
+class While;
+class Break;
+class Return;
+class Function;
+class Class;
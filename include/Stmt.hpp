@@ -1,6 +1,5 @@
 #pragma once
-#include<any>
-#include<memory>
+#include "Arena.h"
 #include "types.h"
 #include "token.h"
 #include "Expr.fwd.hpp"
@@ -16,80 +15,111 @@ class StmtVisitor{
    virtual void visit(Break *stmt)=0;
    virtual void visit(Return *stmt)=0;
    virtual void visit(Function *stmt)=0;
+   virtual void visit(Class *stmt)=0;
    virtual ~StmtVisitor()=default;
 };
+enum class StmtKind : uint8_t {
+   Expression,
+   Print,
+   Block,
+   Var,
+   If,
+   While,
+   Break,
+   Return,
+   Function,
+   Class,
+};
 class Stmt{
  public:
+   const StmtKind kind;
    virtual void accept(StmtVisitor& visitor)=0;
-   virtual ~Stmt()=default;
 #define MAKE_VISITABLE_Stmt virtual void accept(StmtVisitor& vis) override { vis.visit(this);}
+ protected:
+   explicit Stmt(StmtKind kind):kind(kind){};
+   ~Stmt()=default;
 };
 class Expression: public Stmt{
    public:
-   std::unique_ptr<Expr > expression;
+   Expr *expression;
    public:
- Expression(std::unique_ptr<Expr >& expression):expression(std::move(expression)){};
+ Expression(Expr *expression):Stmt(StmtKind::Expression),expression(expression){};
 MAKE_VISITABLE_Stmt
 };
 class Print: public Stmt{
    public:
-   std::unique_ptr<Expr > expression;
+   Expr *expression;
    public:
- Print(std::unique_ptr<Expr >& expression):expression(std::move(expression)){};
+ Print(Expr *expression):Stmt(StmtKind::Print),expression(expression){};
 MAKE_VISITABLE_Stmt
 };
 class Block: public Stmt{
    public:
-   Lox::VecUniquePtr<Stmt> statements;
+   Lox::NodeList<Stmt*> statements;
+   int num_slots{};
+   bool captured{};
    public:
- Block(Lox::VecUniquePtr<Stmt> statements):statements(statements){};
+ Block(Lox::NodeList<Stmt*> statements):Stmt(StmtKind::Block),statements(statements){};
 MAKE_VISITABLE_Stmt
 };
 class Var: public Stmt{
    public:
    Token name;
-   std::unique_ptr<Expr > initializer;
+   Expr *initializer;
+   Lox::Slot slot{};
    public:
- Var(Token name,std::unique_ptr<Expr >& initializer):name(name),initializer(std::move(initializer)){};
+ Var(Token name,Expr *initializer):Stmt(StmtKind::Var),name(name),initializer(initializer){};
 MAKE_VISITABLE_Stmt
 };
 class If: public Stmt{
    public:
-   std::unique_ptr<Expr > condition;
-   std::unique_ptr<Stmt > then_branch;
-   std::unique_ptr<Stmt > else_branch;
+   Expr *condition;
+   Stmt *then_branch;
+   Stmt *else_branch;
    public:
- If(std::unique_ptr<Expr >& condition,std::unique_ptr<Stmt >& then_branch,std::unique_ptr<Stmt >& else_branch):condition(std::move(condition)),then_branch(std::move(then_branch)),else_branch(std::move(else_branch)){};
+ If(Expr *condition,Stmt *then_branch,Stmt *else_branch):Stmt(StmtKind::If),condition(condition),then_branch(then_branch),else_branch(else_branch){};
 MAKE_VISITABLE_Stmt
 };
 class While: public Stmt{
    public:
-   std::unique_ptr<Expr > condition;
-   std::unique_ptr<Stmt > body;
+   Expr *condition;
+   Stmt *body;
    public:
- While(std::unique_ptr<Expr >& condition,std::unique_ptr<Stmt >& body):condition(std::move(condition)),body(std::move(body)){};
+ While(Expr *condition,Stmt *body):Stmt(StmtKind::While),condition(condition),body(body){};
 MAKE_VISITABLE_Stmt
 };
 class Break: public Stmt{
    public:
    std::string placeholder;
    public:
- Break(std::string placeholder):placeholder(placeholder){};
+ Break(std::string placeholder):Stmt(StmtKind::Break),placeholder(placeholder){};
 MAKE_VISITABLE_Stmt
 };
 class Return: public Stmt{
    public:
    Token keyword;
-   std::unique_ptr<Expr > value;
+   Expr *value;
+   bool tail_call{};
    public:
- Return(Token keyword,std::unique_ptr<Expr >& value):keyword(keyword),value(std::move(value)){};
+ Return(Token keyword,Expr *value):Stmt(StmtKind::Return),keyword(keyword),value(value){};
 MAKE_VISITABLE_Stmt
 };
 class Function: public Stmt{
    public:
    Token name;
-   std::unique_ptr<FunctionExpr > fn_expr;
+   FunctionExpr *fn_expr;
+   Lox::Slot slot{};
+   public:
+ Function(Token name,FunctionExpr *fn_expr):Stmt(StmtKind::Function),name(name),fn_expr(fn_expr){};
+MAKE_VISITABLE_Stmt
+};
+class Class: public Stmt{
+   public:
+   Token name;
+   Expr *superclass;
+   Lox::NodeList<Function*> methods;
+   Lox::Slot slot{};
    public:
- Function(Token name,std::unique_ptr<FunctionExpr >& fn_expr):name(name),fn_expr(std::move(fn_expr)){};
+ Class(Token name,Expr *superclass,Lox::NodeList<Function*> methods):Stmt(StmtKind::Class),name(name),superclass(superclass),methods(methods){};
 MAKE_VISITABLE_Stmt
 };
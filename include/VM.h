@@ -0,0 +1,88 @@
+#ifndef LOX_VM_H
+#define LOX_VM_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "LoxExceptions.h"
+#include "Obj.h"
+#include "Program.h"
+#include "Stmt.hpp"
+#include "types.h"
+
+namespace Lox {
+
+    // Stack based virtual machine executing the bytecode produced by the Compiler. Selected with --engine=vm.
+    class VM : public GcRoots {
+        struct CallFrame {
+            ObjClosure *closure;
+            uint8_t *ip;
+            Value *slots;
+        };
+
+        static constexpr int FRAMES_MAX = 1024;
+        static constexpr int STACK_MAX = FRAMES_MAX * 256;
+
+        std::unique_ptr<Value[]> stack;
+        Value *stack_top;
+        std::unique_ptr<CallFrame[]> frames;
+        // where OP_PRINT writes
+        std::ostream &out;
+        int frame_count = 0;
+        ObjUpvalue *open_upvalues = nullptr;
+
+        // globals are late bound, the Compiler hands out slots by name
+        std::vector<Value> globals;
+        std::vector<std::string> global_names;
+        std::vector<bool> global_defined;
+        std::unordered_map<std::string, int> global_slots;
+
+        void run();
+
+        void reset_stack();
+
+        void call(ObjClosure *closure, int arg_count);
+
+        void call_value(const Value &callee, int arg_count);
+
+        // builds the exception for a runtime error at the instruction the innermost frame is executing
+        RuntimeException error(const std::string &message);
+
+        ObjUpvalue *capture_upvalue(Value *local);
+
+        void close_upvalues(Value *last);
+
+        void define_native(const std::string &name, NativeFn function, int arity);
+
+        // defines clock and the other native functions
+        void define_natives();
+
+    public:
+        Heap heap{*this};
+
+        explicit VM(std::ostream &out = std::cout);
+
+        ~VM();
+
+        VM(const VM &) = delete;
+
+        VM &operator=(const VM &) = delete;
+
+        // slot of the global named `name`, creating an undefined one if it hasn't been seen yet
+        int global_slot(std::string_view name);
+
+        ObjFunction *new_function();
+
+        void mark_roots(Heap &heap) override;
+
+        void interpret(const Program &program, bool print_expressions);
+
+        // forgets every global but the natives, and their names
+        void reset_globals();
+    };
+
+} // Lox
+
+#endif //LOX_VM_H
@@ -0,0 +1,102 @@
+#ifndef LOX_VALUE_H
+#define LOX_VALUE_H
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "Heap.h"
+
+namespace Lox {
+    class Callable;
+
+    // immutable string, allocated on a Heap or permanent: an interned name or a literal owned by its Program
+    class LoxString : public Obj {
+    public:
+        const std::string chars;
+
+        explicit LoxString(std::string chars) : Obj(ObjType::STRING), chars(std::move(chars)) {};
+
+        size_t size() const override { return sizeof(LoxString) + chars.capacity(); }
+
+        std::string to_string() const override { return chars; }
+    };
+
+    enum class ValueType : uint8_t {
+        UNINITIALIZED, // declared with `var x;` but never assigned, reading it is a runtime error
+        NIL,
+        BOOL,
+        NUMBER,
+        STRING,
+        CALLABLE,
+        OBJ, // objects owned by the bytecode VM, see Obj.h
+    };
+
+    // 16 byte tagged value: numbers, bools and nil are stored inline, strings, callables and VM objects as pointers
+    // to garbage collected objects. Copies are plain bit copies, the Heap keeps reachable objects alive.
+    class Value {
+        ValueType type_;
+        union {
+            bool boolean;
+            double number;
+            LoxString *string;
+            Callable *callable;
+            Obj *obj;
+        } as;
+
+    public:
+        Value() : type_(ValueType::NIL) { as.number = 0; };
+
+        Value(bool boolean) : type_(ValueType::BOOL) { as.boolean = boolean; };
+
+        Value(double number) : type_(ValueType::NUMBER) { as.number = number; };
+
+        Value(Callable *callable) : type_(ValueType::CALLABLE) { as.callable = callable; };
+
+        Value(Obj *obj) : type_(ValueType::OBJ) { as.obj = obj; };
+
+        Value(LoxString *string) : type_(ValueType::STRING) { as.string = string; };
+
+        static Value uninitialized() {
+            Value value;
+            value.type_ = ValueType::UNINITIALIZED;
+            return value;
+        }
+
+        ValueType type() const { return type_; }
+
+        bool is_uninitialized() const { return type_ == ValueType::UNINITIALIZED; }
+
+        bool is_nil() const { return type_ == ValueType::NIL; }
+
+        bool is_bool() const { return type_ == ValueType::BOOL; }
+
+        bool is_number() const { return type_ == ValueType::NUMBER; }
+
+        bool is_string() const { return type_ == ValueType::STRING; }
+
+        bool is_callable() const { return type_ == ValueType::CALLABLE; }
+
+        bool is_obj() const { return type_ == ValueType::OBJ; }
+
+        bool is_heap_object() const { return type_ >= ValueType::STRING; }
+
+        bool as_bool() const { return as.boolean; }
+
+        double as_number() const { return as.number; }
+
+        const std::string &as_string() const { return as.string->chars; }
+
+        Callable *as_callable() const { return as.callable; }
+
+        Obj *as_obj() const { return as.obj; }
+
+        // the garbage collected object behind a string, callable or VM object, nullptr for inline values
+        Obj *as_heap_object() const;
+    };
+
+    static_assert(sizeof(Value) == 16, "Value should stay two words wide");
+    static_assert(std::is_trivially_copyable<Value>::value, "Value is copied around freely, the GC owns its objects");
+}
+
+#endif //LOX_VALUE_H
@@ -1,39 +1,278 @@
 #pragma once
 
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "Environment.h"
 #include "Stmt.hpp"
 #include "Expr.hpp"
 #include "Callable.h"
+#include "Feedback.h"
+#include "LoxExceptions.h"
+#include "Program.h"
 
 namespace Lox {
     class Callable;
 
-    class Interpreter : public ExprVisitor, StmtVisitor {
-        std::unique_ptr<Object> value; //value for exprvisitor
-//        Object value;
-        void execute(Stmt *stmt);
+    class LoxFunction;
+
+    class Arguments;
+
+    struct ClosureRuntime;
+
+    struct SpawnedThread;
+
+    // how a statement finished executing, break and return unwind the enclosing blocks until a loop or call
+    enum class Completion {
+        NORMAL,
+        BREAK,
+        RETURN,
+        // a `return f(...)`, the callee and its arguments are left on the stack for the call being returned from
+        TAIL_CALL
+    };
+
+    class Interpreter : public ExprVisitor, StmtVisitor, public GcRoots {
+        // closure compiled code runs on the same environments, stack and globals
+        friend struct ClosureRuntime;
+    public:
+        // owns every Environment, function and string created while interpreting
+        Heap heap{*this};
+    private:
+        // where print statements write
+        std::ostream &out;
+        // result register for the expression visitor, written by Return and moved out by get_expr_value
+        Object value;
+        bool has_value = false;
+        // set by Break and Return statements, cleared by the loop or call that consumes it
+        Completion completion = Completion::NORMAL;
+        Object return_value;
+        // where the pending tail call's callee is on the stack, and the call's parenthesis for its errors
+        size_t tail_call_base = 0;
+        const Token *tail_call_paren = nullptr;
+        // environments saved by execute_block and values held by evaluator frames across an allocation, both
+        // are GC roots
+        std::vector<Environment *> environments;
+        std::vector<Object> stack;
+        // environments of scopes that no function could capture, reused by new_environment. Kept empty so they
+        // don't hold on to anything, capped so a deep recursion doesn't pin its peak, and dropped at every
+        // collection, which frees whatever the heap can't reach otherwise
+        static constexpr size_t MAX_FREE_ENVIRONMENTS = 64;
+        std::vector<Environment *> free_environments;
 
         virtual void visit(Return *stmt);
 
-        Callable *global_clock;
+        // globals are late bound, so they live in a table with a slot for every name the programs run so far
+        // refer to. A program's Feedback maps its global Slots to these
+        std::unordered_map<std::string, int> global_slots;
+        std::vector<Object> global_values;
+        std::vector<bool> global_defined;
+        // what the interpreter learned about each program it ran, by Program::id
+        std::unordered_map<uint64_t, std::unique_ptr<Feedback>> feedback_tables;
+        // rewrite Binary, Unary and Variable nodes into specialized forms as they run
+        bool quickening = false;
+        // the threads this interpreter spawned, each running on an interpreter of its own. Once there are any,
+        // prints of the interpreters sharing `out` take output_lock
+        std::vector<std::unique_ptr<SpawnedThread>> spawned;
+        // what the threads that were reaped while the script ran ended with, until join_spawned
+        std::vector<RuntimeException> spawned_errors;
+        std::shared_ptr<std::mutex> output_lock;
+
+        // a continuation of iterative evaluation, run when everything pushed after it has finished. Expression
+        // tasks find their operands on `stack`
+        struct Task {
+            enum Op : uint8_t {
+                EVAL,       // evaluate node, an Expr
+                BINARY_RIGHT, // the left operand of node is on the stack
+                BINARY,     // both operands of node are on the stack
+                UNARY,
+                LOGICAL,    // the left operand decides whether the right one runs
+                TERNARY,
+                ASSIGN,     // count is set when the value isn't used
+                CALL,       // the callee and `count` arguments of node are on the stack
+                INVOKE,     // node is a Call of a Get, its object and `count` arguments are on the stack
+                GET,
+                SET,        // the object and value of node are on the stack
+                EXEC,       // execute node, a Stmt
+                POP,        // the value of an expression statement
+                PRINT,
+                DEFINE,     // the initializer of node, a Var
+                IF,
+                LOOP,       // an iteration of node, a While, finished. Break unwinds to here
+                LOOP_TEST,
+                BLOCK_EXIT, // leaves the environment of node, a Block
+                RETURN,
+                TAIL_CALL,  // node is a Call being returned, its callee and arguments are on the stack
+                TAIL_BRANCH, // the condition of node, a Ternary being returned, is on the stack
+                FRAME       // returns from a call of node, a FunctionExpr, count is set for an initializer. Return
+                            // unwinds to here
+            };
+            Op op;
+            uint32_t count;
+            void *node;
+        };
+        // run programs with a loop over `tasks` instead of recursing through the visitor, see set_iterative
+        bool iterative = false;
+        std::vector<Task> tasks;
+        // the Feedback of each caller of a call in progress in iterative evaluation
+        std::vector<Feedback *> saved_feedback;
+        // calls in progress in iterative evaluation and the most allowed
+        size_t depth = 0;
+        size_t max_depth = DEFAULT_MAX_DEPTH;
+
+        void reset_after_error();
+
+        void run_tasks(size_t floor);
+
+        // evaluates the left spine of expr, pushing the tasks that finish the rest
+        void descend(Expr *expr);
+
+        void exec(Stmt *stmt);
+
+        // pushes the value of a literal or variable, false for other expressions
+        bool push_leaf(Expr *expr);
+
+        void apply_binary(Binary *binary);
+
+        // evaluates the callee and arguments of call and then runs `then`. False if they were all leaves, the
+        // caller runs `then` itself
+        bool push_call_operands(Call *call, Expr *first, Task then);
+
+        void tail_call(Call *call);
+
+        // returns `value` from the function running, making a call in its tail position after leaving the frame
+        void return_value_of(Expr *value);
+
+        // returns the branch of `ternary` its condition, on the stack, picks
+        void tail_branch(Ternary *ternary);
+
+        void push_statements(NodeList<Stmt *> statements);
+
+        void enter_call(Call *expr, size_t arg_count);
+
+        void enter_invoke(Call *expr, size_t arg_count);
+
+        // starts a call of function with its arguments above stack[base], and for a method its receiver there
+        void enter_function(LoxFunction *function, const Token &paren, size_t base);
+
+        // leaves a call, an initializer's `this` replaces the value it returned
+        void leave_call(FunctionExpr *function, bool initializer);
+
+        void leave_block(Block *block);
+
+        void branch(If *stmt);
+
+        void loop(While *stmt);
+
+        void loop_test(While *stmt);
+
+        // pops tasks up to and including the innermost one with `op`, leaving the blocks and loops on the way
+        void unwind(Task::Op op);
+
+        // the superclass method expr names, bound to `this`
+        Callable *bind_super(Super *expr);
+
+        Object binary_operation(const Token &oper, Object &left, Object &right);
+
+        static Specialization specialize(token_type oper, const Object &left, const Object &right);
+        // the slot of the global `name` in this interpreter's table, added if the name is new
+        int global_slot(const std::string &name);
+
+        // where the global Slot of the running program lives in the table
+        int global_index(Slot slot) const { return feedback->global_slots[slot.index]; }
+
+        // defines clock and the natives of Concurrency.h
+        void define_natives();
+
+        // the body of a spawned thread, calls function on this interpreter
+        void run_spawned(Callable *function, SpawnedThread &thread);
+
+        // joins the spawned threads that are done, freeing their interpreters and keeping their errors
+        void reap_spawned();
+
     public:
-        Environment *global, *environment;
-        Interpreter();
+        Environment *global = nullptr, *environment = nullptr;
+        // the Feedback of the program the running code belongs to, switched by calls of its functions
+        Feedback *feedback = nullptr;
+        explicit Interpreter(std::ostream &out = std::cout);
+
+        // waits for the threads it spawned
+        ~Interpreter() override;
+
+        Interpreter(const Interpreter &) = delete;
+
+        Interpreter &operator=(const Interpreter &) = delete;
+
+        void define_global(const std::string &name, Object value);
+
+        // forgets every global but the natives, their names and everything learned about the programs run so far,
+        // leaving the interpreter as if new but with its heap already allocated
+        void reset_globals();
+
+        void set_quickening(bool enabled) { quickening = enabled; }
+
+        // writes the value of a print statement
+        void print(const Object &value);
+
+        // the Feedback for the program `other` was learned from, for a function copied from another interpreter
+        Feedback *feedback_like(const Feedback &other);
+
+        // Calls `function` on a thread of its own. The thread gets a new interpreter with its own heap, into which
+        // the function, everything it captured and the globals are copied, so the threads share nothing but the
+        // channels they are handed.
+        void spawn(Callable *function);
+
+        // waits for every thread spawned by this interpreter and the threads they spawned, returning the runtime
+        // errors they ended with
+        std::vector<RuntimeException> join_spawned();
+
+        static constexpr size_t DEFAULT_MAX_DEPTH = 100000;
+
+        // Iterative evaluation runs on an explicit task stack and the value stack, so neither nested expressions
+        // nor Lox calls use the native stack. A call nested deeper than the maximum depth is a runtime error.
+        void set_iterative(bool enabled) { iterative = enabled; }
 
-        ~Interpreter();
+        void set_max_depth(size_t max) { max_depth = max; }
+
+        Object evaluate_iteratively(Expr *expr);
+
+        void execute_iteratively(Stmt *stmt);
+
+        const Object &lookup(const Token &name, Slot slot);
+
+        // an environment for a call or a block, a released one if there is any
+        Environment *new_environment(Environment *enclosing, int num_slots);
+
+        // hands back the environment of a scope that has exited, only for scopes the Resolver didn't mark captured
+        void release_environment(Environment *env);
+
+        void define(Slot slot, Object value);
+
+        void assign(const Token &name, Slot slot, Object value);
+
+        void mark_roots(Heap &heap) override;
 
         Object evaluate(Expr *n);
 
         //unsafe if value doesnt contain any value
-        Object get_expr_value();
+        Object get_expr_value() {
+            has_value = false;
+            return std::move(value);
+        }
 
-        void Return(Object value_);
+        void Return(Object value_) {
+            value = std::move(value_);
+            has_value = true;
+        }
 
 #define RETURN(ret) Return(ret);return
 
 
-        void interpret(VecUniquePtr<Stmt> &statements, bool print_expressions);
+        // makes `program` the one running, with the Feedback the interpreter keeps for it
+        void enter_program(const Program &program);
+
+        void interpret(const Program &program, bool print_expressions);
 
         void visit(Var *stmt);
 
@@ -65,23 +304,55 @@ namespace Lox {
 
         void visit(Nothing *expr);
 
-        void check_number_operand(Token operator_token, Object &operand);
+        void check_number_operand(const Token &operator_token, Object &operand);
 
-        void check_number_operands(Token operator_token, Object &left, Object &right);
+        void check_number_operands(const Token &operator_token, Object &left, Object &right);
 
         bool isEqual(double x, double y);
 
-        void check_not_zero(Token operator_token, double d);
+        void check_not_zero(const Token &operator_token, double d);
 
         void visit(Unary *expr);
 
         void visit(Block *stmt);
 
-        void execute_block(VecUniquePtr<Stmt> &statements, Environment *env);
+        Completion execute(Stmt *stmt);
+
+        Completion execute_block(NodeList<Stmt *> statements, Environment *env);
+
+        // the value of the Return statement that ended the current call, resets the completion to normal
+        Object take_return_value();
+
+        // evaluates the callee and arguments of a call onto the stack and checks them, returns where they start
+        size_t push_call(Call *expr);
+
+        // raises the error for a call of the callee at stack[base] with the values above it as arguments, if any
+        void check_call(const Token &paren, size_t base);
+
+        // the callee of the call pushed at `base` and its arguments, which stay valid until the callee runs code
+        Callable *callee_at(size_t base) { return stack[base].as_callable(); }
+
+        Arguments arguments_at(size_t base);
+
+        // pops a call pushed at `base` once it is done with its arguments, resets the completion to normal
+        void drop_call(size_t base) {
+            stack.resize(base);
+            completion = Completion::NORMAL;
+        }
+
+        // where the callee of the pending tail call was pushed. Resets the completion to normal, so the callee can
+        // run before the call is dropped
+        size_t take_tail_call() {
+            completion = Completion::NORMAL;
+            return tail_call_base;
+        }
+
+        // the parenthesis of the pending tail call
+        const Token &tail_call_site() const { return *tail_call_paren; }
 
         void visit(Binary *expr);
 
-        bool isTruthy(Object val);;
+        bool isTruthy(const Object &val);
 
         bool isEqual(Object &val1, Object &val2);
 
@@ -92,6 +363,25 @@ namespace Lox {
 
         void visit(FunctionExpr *expr) override;
 
+        void visit(Class *stmt) override;
+
+        void visit(Get *expr) override;
+
+        void visit(Set *expr) override;
+
+        void visit(This *expr) override;
+
+        void visit(Super *expr) override;
+
+        // creates the class stmt declares, superclass is the value of its superclass expression if it has one
+        void define_class(Class *stmt, const Object &superclass);
+
+        // calls the property `name` of the instance at stack[base] with the values above it as arguments. A
+        // method is called with the instance as its receiver without binding it first
+        Object invoke(const Token &name, PropertyCache &cache, const Token &paren, size_t base);
+
+        // raises the error for calling `callee` with arg_count arguments, if it takes another number
+        void check_arity(const Token &paren, Callable *callee, size_t arg_count);
 
     };
 
@@ -2,26 +2,51 @@
 
 #include <fstream>
 #include <string>
+#include "Heap.h"
+#include "Isolate.h"
+#include "Source.h"
 #include "LoxExceptions.h"
 #include "token.h"
 
-std::string readTextFile(const std::string &path);
+namespace Lox {
 
+    // The functions below drive one isolate shared by the whole process, for the command line and the REPL.
+    // Embedders running scripts on several threads give each thread an Isolate of its own instead.
 
-namespace Lox {
-//    extern bool had_error;
+    void set_engine(Engine engine);
+
+    // how deeply Lox calls may nest on the STACK engine before it reports a stack overflow
+    void set_max_depth(size_t depth);
+
+    // 0 runs programs as parsed, 1 (the default) runs the Optimizer over them first, 2 also lets the tree walker
+    // specialize nodes to the operand types it sees (quickening)
+    void set_optimization_level(int level);
+
+    // runFile caches parsed scripts in `directory`, an empty string turns the cache off
+    void set_cache_directory(std::string directory);
+
+    // statistics of the heap owned by the current engine
+    const HeapStats &heap_stats();
+
+    std::string heap_stats_report();
 
     void run(std::string input,bool print_expressions);
 
+    void run(Source source, bool print_expressions);
+
+    // errors are reported to the isolate running on this thread, or only printed if there is none
     void report(int line, const std::string &where, const std::string &message);
 
+    // the sysexits code a script that ended with `status` makes the process exit with
+    int exit_code(Isolate::Status status);
+
     void runFile(std::string path);
 
     void runPrompt();
 
     void error(int line, std::string message);
 
-    void error(Token token, std::string message);
+    void error(const Token &token, const std::string &message);
 
     void runtime_error(RuntimeException& e);
 
@@ -4,12 +4,15 @@
 #include <vector>
 #include <initializer_list>
 #include <stdexcept>
+#include <string_view>
 #include <iostream>
 #include <memory>
+#include "Expr.hpp"
 #include "Stmt.hpp"
+#include "Program.h"
 #include "token.h"
+#include "scanner.h"
 
-using std::unique_ptr;
 using std::vector;
 
 class ParseError : public std::exception {
@@ -26,65 +29,82 @@ public:
 };
 
 
+// Pulls tokens from the scanner as it goes, so only a few of them are alive at once
 class Parser {
-    vector<Token> tokens;
+    // the previous token, the current one and the one after it (for check_next), rounded up to a power of two
+    static constexpr size_t WINDOW_SIZE = 4;
+    Scanner &scanner;
+    Token window[WINDOW_SIZE];
+    // number of tokens pulled from the scanner so far
+    size_t scanned = 0;
+    // owns every node the parser creates
+    Lox::Program &program;
     vector<HandledParseError> handled_parse_errors;
     int nested_loops = 0;
-    int current = 0;
+    size_t current = 0;
 
-    unique_ptr<Expr> expression();
+    const Token &token_at(size_t position);
 
-    unique_ptr<Expr> equality();
+    Expr *expression();
 
-    unique_ptr<Expr> comparison();
+    Expr *equality();
 
-    unique_ptr<Expr> term();
+    Expr *comparison();
 
-    unique_ptr<Expr> factor();
+    Expr *term();
 
-    unique_ptr<Expr> unary();
+    Expr *factor();
 
-    unique_ptr<Expr> call();
+    Expr *unary();
 
-    unique_ptr<Stmt> function_decl(std::string kind);
+    Expr *call();
 
-    unique_ptr<FunctionExpr> function_body(std::string kind);
+    Stmt *function_decl(std::string kind);
 
-    unique_ptr<Expr> function_expr_along_with_rest();
+    FunctionExpr *function_body(std::string kind);
 
-    unique_ptr<Expr> finish_call(unique_ptr<Expr>);
+    Expr *function_expr_along_with_rest();
 
-    unique_ptr<Expr> primary();
+    Expr *finish_call(Expr *callee);
 
-    unique_ptr<Expr> comma();
+    Expr *primary();
 
-    unique_ptr<Expr> ternary();
+    Expr *comma();
 
-    unique_ptr<Expr> logical_or();
+    Expr *ternary();
 
-    unique_ptr<Expr> logical_and();
+    Expr *logical_or();
 
-    unique_ptr<Expr> assignment();
+    Expr *logical_and();
 
-    unique_ptr<Stmt> statement();
+    Expr *assignment();
 
-    unique_ptr<Return> return_statement();
+    Stmt *statement();
 
-    unique_ptr<If> if_statement();
+    Return *return_statement();
 
-    unique_ptr<While> while_statement();
+    If *if_statement();
 
-    unique_ptr<Stmt> for_statement();
+    While *while_statement();
 
-    unique_ptr<Stmt> declaration();
+    Stmt *for_statement();
 
-    unique_ptr<Var> var_declaration();
+    Stmt *declaration();
 
-    unique_ptr<Print> print_statement();
+    Var *var_declaration();
 
-    Lox::VecUniquePtr<Stmt> block();
+    Class *class_declaration();
 
-    unique_ptr<Expression> expression_statement();
+    Print *print_statement();
+
+    Lox::NodeList<Stmt *> block();
+
+    Expression *expression_statement();
+
+    template<typename T, typename... Args>
+    T *make(Args &&... args) {
+        return program.arena.make<T>(std::forward<Args>(args)...);
+    }
 
     bool match(std::initializer_list<token_type>);
 
@@ -93,9 +113,9 @@ class Parser {
         return dynamic_cast<const DstType *>(src) != nullptr;
     }
 
-    void check_missing_expr(Expr *expr, std::string error_message);
+    void check_missing_expr(Expr *expr, std::string_view error_message);
 
-    void check_invalid_token(token_type token, Token previous, std::string error_message);
+    void check_invalid_token(token_type token, const Token &previous, std::string_view error_message);
 
     bool check(token_type);
 
@@ -103,21 +123,24 @@ class Parser {
 
     bool isAtEnd();
 
-    Token advance();
+    const Token &advance();
 
-    Token previous();
+    const Token &previous();
 
-    Token peek();
+    const Token &peek();
 
-    Token consume(token_type type, std::string message);
+    const Token &consume(token_type type, std::string_view message);
 
-    ParseError error(Token token, std::string message);
+    ParseError error(const Token &token, const std::string &message);
 
     void synchronise();
 
 public:
-    explicit Parser(vector<Token> tokens) : tokens(std::move(tokens)) {};
+    Parser(Scanner &scanner, Lox::Program &program)
+            : scanner(scanner), window{{T_EOF, {}, 1}, {T_EOF, {}, 1}, {T_EOF, {}, 1}, {T_EOF, {}, 1}},
+              program(program) {};
 
-    Lox::VecUniquePtr<Stmt> parseTokens();
+    // parses the whole token stream into the program's statements
+    Lox::NodeList<Stmt *> parseTokens();
 };
 
@@ -1,29 +1,28 @@
 #pragma once
 
-#include <string>
+#include <cstddef>
+#include <string_view>
 #include <vector>
-#include <variant>
-#include <unordered_map>
 #include "types.h"
 #include "token.h"
+#include "ScanKernels.h"
 
-typedef std::variant<std::monostate, double, std::string> literal_type;
-literal_type get_empty_literal();
-
+// Splits the source into tokens that point back into it, so the source has to outlive them. Tokens are pulled one
+// at a time with next_token, or all at once with scanTokens.
 class Scanner
 {
-    std::string source;
-    std::vector<Token> tokens;
-    int start = 0;
-    int current = 0;
+    std::string_view source;
+    const Lox::ScanKernels &kernels;
+    Token token{T_EOF, {}, 1};
+    bool token_ready = false;
+    size_t start = 0;
+    size_t current = 0;
     int line = 1;
 
     char advance();
 
     void addToken(token_type);
 
-    void addToken(token_type, literal_type);
-
     void scanToken();
 
     bool match(char);
@@ -46,13 +45,17 @@ class Scanner
 
     void multiline_comment();
 
-    static std::unordered_map<std::string, token_type> keywords;
+    void skip_whitespace();
 
     bool isAtEnd();
 
 
 public:
-    Scanner(std::string source) : source(source){};
+    Scanner(std::string_view source, const Lox::ScanKernels &kernels = Lox::scan_kernels())
+            : source(source), kernels(kernels) {};
+
+    // the next token of the source, T_EOF once it is exhausted
+    Token next_token();
 
     std::vector<Token> scanTokens();
 };
\ No newline at end of file
@@ -0,0 +1,29 @@
+//
+// Created by Dipin Garg on 30-01-2023.
+//
+
+#ifndef LOX_TOKEN_H
+#define LOX_TOKEN_H
+
+#include "types.h"
+#include <string_view>
+
+// A lexeme of the source buffer, which has to outlive the token (the Program owns it). Tokens are plain
+// values, literals are decoded from the lexeme when the parser needs them.
+class Token
+{
+public:
+    token_type type;
+    int line;
+    std::string_view lexeme;
+
+    Token(token_type type, std::string_view lexeme, int line) : type(type), line(line), lexeme(lexeme){};
+
+    // value of a NUMBER token
+    double number() const;
+
+    // contents of a STRING token without the quotes
+    std::string_view string() const { return lexeme.substr(1, lexeme.size() - 2); }
+};
+
+#endif //LOX_TOKEN_H
@@ -5,33 +5,41 @@
 #ifndef LOX_TYPES_H
 #define LOX_TYPES_H
 
-#include <any>
 #include <vector>
 #include <memory>
+#include "Value.h"
+#include "Shape.h"
 
 namespace Lox {
-    template<typename T>
-    class VecUniquePtr {
-        std::vector<std::unique_ptr<T>> _vec;
-    public:
-        VecUniquePtr(std::vector<std::unique_ptr<T>> &vec) : _vec(std::move(vec)) {};
+    typedef Value Object;
 
-        VecUniquePtr(VecUniquePtr &&v) : _vec(std::move(v._vec)) {};
+    // where a variable lives, filled in by the Resolver. depth is the number of environments to walk
+    // up from the current one, -1 means index is a slot in the interpreter's global table
+    struct Slot {
+        int depth = -1;
+        int index = -1;
 
-        VecUniquePtr(VecUniquePtr &v) : _vec(std::move(v._vec)) {};
-
-        VecUniquePtr() {};
-
-        std::vector<std::unique_ptr<T>> &get() {
-            return _vec;
-        }
-
-        void push_back(std::unique_ptr<T> ptr) {
-            _vec.push_back(std::move(ptr));
-        }
+        bool is_global() const { return depth < 0; }
     };
 
-    typedef std::any Object;
+    // What a Binary, Unary or Variable node has specialized into after its first execution when the interpreter
+    // quickens (-O2), kept in the interpreter's Feedback for the program. The specialized forms guard on the operand
+    // types they saw and fall back to GENERIC for good when the guard fails.
+    enum class Specialization : uint8_t {
+        UNINITIALIZED,
+        GENERIC,
+        NUMBER_ADD,
+        NUMBER_SUBTRACT,
+        NUMBER_MULTIPLY,
+        NUMBER_DIVIDE,
+        NUMBER_GREATER,
+        NUMBER_GREATER_EQUAL,
+        NUMBER_LESS,
+        NUMBER_LESS_EQUAL,
+        NUMBER_NEGATE,
+        // a global that has been read successfully, later reads only check that it is still initialized
+        DEFINED_GLOBAL
+    };
 }
 enum token_type
 {
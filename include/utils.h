@@ -20,21 +20,12 @@ namespace Lox {
         return dynamic_cast<const other *>(ptr) != nullptr;
     }
 
-    template<typename T>
-    bool lox_object_type(Object &obj) {
-        return obj.type() == typeid(T);
-    }
+    std::string get_string_repr(const Object &obj);
 
-    template<typename T>
-    T lox_object_cast(Object &obj) {
-        try {
-            return std::any_cast<T>(obj);
-        }
-        catch (std::bad_any_cast &e) {
-            throw e;
-        }
-    }
+    // nil and false are falsey, everything else is truthy
+    bool is_truthy(const Object &obj);
 
-    std::string get_string_repr(Object &obj);
+    // Lox equality: values of different types are never equal, objects compare by identity
+    bool values_equal(const Object &val1, const Object &val2);
 
 }
\ No newline at end of file
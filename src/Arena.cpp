@@ -0,0 +1,19 @@
+#include "Arena.h"
+#include <algorithm>
+
+namespace Lox {
+
+    void *Arena::allocate_block(size_t size, size_t align) {
+        size_t block_size = std::max(BLOCK_SIZE, size + align);
+        blocks.emplace_back(new char[block_size]);
+        position = blocks.back().get();
+        limit = position + block_size;
+        return allocate(size, align);
+    }
+
+    Arena::~Arena() {
+        for (auto itr = finalizers.rbegin(); itr != finalizers.rend(); itr++)
+            itr->destroy(itr->object);
+    }
+
+} // Lox
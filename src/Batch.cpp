@@ -0,0 +1,91 @@
+#include "Batch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace Lox {
+
+    void configure(Isolate &isolate, const BatchOptions &options) {
+        isolate.set_engine(options.engine);
+        isolate.set_optimization_level(options.optimization_level);
+        if (options.max_depth)
+            isolate.set_max_depth(options.max_depth);
+        isolate.set_cache(options.cache);
+    }
+
+    unsigned job_count(const BatchOptions &options) {
+        unsigned jobs = options.jobs ? options.jobs : std::thread::hardware_concurrency();
+        return std::clamp(jobs, 1u, MAX_JOBS);
+    }
+
+    static ScriptResult run_script(const std::string &path, const BatchOptions &options) {
+        ScriptResult result;
+        result.path = path;
+        std::ostringstream out, err;
+        auto start = std::chrono::steady_clock::now();
+        {
+            Isolate isolate(out, err);
+            configure(isolate, options);
+            result.status = isolate.run_file(path);
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        result.milliseconds = elapsed.count();
+        result.out = out.str();
+        result.err = err.str();
+        return result;
+    }
+
+    void run_batch(const std::vector<std::string> &paths, const BatchOptions &options,
+                   const std::function<void(const ScriptResult &)> &done) {
+        std::vector<ScriptResult> results(paths.size());
+        std::vector<bool> finished(paths.size());
+        std::mutex mutex;
+        std::condition_variable finished_one;
+        std::atomic<size_t> next{0};
+        auto work = [&] {
+            for (size_t i; (i = next.fetch_add(1)) < paths.size();) {
+                ScriptResult result = run_script(paths[i], options);
+                std::lock_guard<std::mutex> lock(mutex);
+                results[i] = std::move(result);
+                finished[i] = true;
+                finished_one.notify_one();
+            }
+        };
+        unsigned jobs = job_count(options);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < jobs && t < paths.size(); t++)
+            workers.emplace_back(work);
+        for (size_t i = 0; i < paths.size(); i++) {
+            ScriptResult result;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                finished_one.wait(lock, [&] { return finished[i]; });
+                // output is handed on as soon as it's in order, not held until the whole batch is done
+                result = std::move(results[i]);
+            }
+            done(result);
+        }
+        for (auto &worker: workers)
+            worker.join();
+    }
+
+    std::optional<std::vector<std::string>> read_manifest(const std::string &path) {
+        std::ifstream manifest(path);
+        if (!manifest)
+            return std::nullopt;
+        std::vector<std::string> paths;
+        for (std::string line; std::getline(manifest, line);) {
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            line.erase(0, line.find_first_not_of(" \t"));
+            if (!line.empty() && line[0] != '#')
+                paths.push_back(line);
+        }
+        return paths;
+    }
+
+} // Lox
@@ -0,0 +1,28 @@
+#include "Chunk.h"
+#include <algorithm>
+
+namespace Lox {
+
+    void Chunk::write(uint8_t byte, int line) {
+        if (lines.empty() || lines.back().second != line) {
+            lines.emplace_back(code.size(), line);
+        }
+        code.push_back(byte);
+    }
+
+    int Chunk::add_constant(Value value) {
+        constants.push_back(std::move(value));
+        return (int) constants.size() - 1;
+    }
+
+    int Chunk::get_line(size_t offset) const {
+        auto itr = std::upper_bound(lines.begin(), lines.end(), offset,
+                                    [](size_t offset, const std::pair<size_t, int> &run) {
+                                        return offset < run.first;
+                                    });
+        if (itr == lines.begin())
+            return 0;
+        return std::prev(itr)->second;
+    }
+
+} // Lox
@@ -4,20 +4,29 @@
 
 #include "Clock.h"
 #include <chrono>
+#include "Concurrency.h"
 
 uint64_t timeSinceEpochMillisec() {
     using namespace std::chrono;
     return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
 }
 
-Lox::Object Lox::Clock::call(Interpreter &interpreter, std::vector<Object> arguments) {
+Lox::Value Lox::clock_native(int arg_count, Value *args) {
     return (double) timeSinceEpochMillisec() / 1000.0;
 }
 
+Lox::Object Lox::Clock::call(Interpreter &interpreter, Arguments arguments) {
+    return clock_native((int) arguments.size(), arguments.begin());
+}
+
 int Lox::Clock::arity() {
     return 0;
 }
 
-std::string Lox::Clock::to_string() {
+std::string Lox::Clock::to_string() const {
     return "<native fn>";
 }
+
+Lox::Obj *Lox::Clock::copy(ObjectCopier &copier) const {
+    return copier.target.heap.allocate<Clock>();
+}
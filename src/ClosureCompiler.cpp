@@ -0,0 +1,786 @@
+#include "ClosureCompiler.h"
+#include <iostream>
+#include <stdexcept>
+#include "Callable.h"
+#include "Concurrency.h"
+#include "LoxClass.h"
+#include "LoxExceptions.h"
+#include "lox.h"
+#include "utils.h"
+
+namespace Lox {
+
+    // The compiled node types and the functions they run. Each function knows the concrete type of its node, so
+    // children are reached through a static_cast and evaluated with a direct call through their pointer.
+    struct ClosureRuntime {
+        struct FunctionCode {
+            NodeList<const CompiledStmt *> body;
+            uint32_t arity;
+            int num_slots;
+            bool captured;
+            // null for function expressions
+            const Token *name;
+            FunctionKind kind;
+        };
+
+        struct Constant : CompiledExpr {
+            Object value;
+        };
+
+        struct Local : CompiledExpr {
+            Token name;
+            int depth;
+            int index;
+        };
+
+        struct Global : CompiledExpr {
+            Token name;
+            Slot slot;
+        };
+
+        struct AssignLocal : CompiledExpr {
+            const CompiledExpr *value;
+            int depth;
+            int index;
+        };
+
+        struct AssignGlobal : CompiledExpr {
+            const CompiledExpr *value;
+            Token name;
+            Slot slot;
+        };
+
+        struct Operation : CompiledExpr {
+            const CompiledExpr *left;
+            const CompiledExpr *right;
+            Token oper;
+        };
+
+        struct Conditional : CompiledExpr {
+            const CompiledExpr *condition;
+            const CompiledExpr *left;
+            const CompiledExpr *right;
+        };
+
+        struct CallNode : CompiledExpr {
+            const CompiledExpr *callee;
+            NodeList<const CompiledExpr *> arguments;
+            Token paren;
+        };
+
+        struct Closure : CompiledExpr {
+            const FunctionCode *code;
+        };
+
+        // a get, or a set with a value
+        struct Property : CompiledExpr {
+            const CompiledExpr *object;
+            const CompiledExpr *value;
+            Token name;
+            // of the interpreter's Feedback
+            uint32_t cache;
+        };
+
+        struct Invoke : CompiledExpr {
+            const CompiledExpr *object;
+            NodeList<const CompiledExpr *> arguments;
+            Token name;
+            Token paren;
+            uint32_t cache;
+        };
+
+        struct SuperAccess : CompiledExpr {
+            Super *expr;
+        };
+
+        struct ExprStmt : CompiledStmt {
+            const CompiledExpr *expression;
+        };
+
+        struct Declaration : CompiledStmt {
+            const CompiledExpr *initializer;
+            Slot slot;
+        };
+
+        struct BlockStmt : CompiledStmt {
+            NodeList<const CompiledStmt *> statements;
+            int num_slots;
+            bool captured;
+        };
+
+        struct IfStmt : CompiledStmt {
+            const CompiledExpr *condition;
+            const CompiledStmt *then_branch;
+            const CompiledStmt *else_branch;
+        };
+
+        struct WhileStmt : CompiledStmt {
+            const CompiledExpr *condition;
+            const CompiledStmt *body;
+        };
+
+        struct FunctionStmt : CompiledStmt {
+            const FunctionCode *code;
+            Slot slot;
+        };
+
+        struct ClassStmt : CompiledStmt {
+            Class *stmt;
+            const CompiledExpr *superclass;
+            NodeList<const FunctionCode *> methods;
+        };
+
+        static Object evaluate(const CompiledExpr *expr, Interpreter &interpreter) {
+            return expr->eval(expr, interpreter);
+        }
+
+        static Completion execute(const CompiledStmt *stmt, Interpreter &interpreter) {
+            return stmt->exec(stmt, interpreter);
+        }
+
+        static Completion execute_all(NodeList<const CompiledStmt *> statements, Interpreter &interpreter) {
+            for (auto stmt: statements) {
+                Completion completion = execute(stmt, interpreter);
+                if (completion != Completion::NORMAL)
+                    return completion;
+            }
+            return Completion::NORMAL;
+        }
+
+        static Completion execute_block(NodeList<const CompiledStmt *> statements, Environment *env,
+                                        Interpreter &interpreter) {
+            interpreter.environments.push_back(interpreter.environment);
+            interpreter.environment = env;
+            Completion completion = execute_all(statements, interpreter);
+            interpreter.environment = interpreter.environments.back();
+            interpreter.environments.pop_back();
+            return completion;
+        }
+
+        static void reset(Interpreter &interpreter) {
+            interpreter.environment = interpreter.global;
+            interpreter.environments.clear();
+            interpreter.stack.clear();
+            interpreter.completion = Completion::NORMAL;
+        }
+
+        static Object constant(const CompiledExpr *self, Interpreter &) {
+            return static_cast<const Constant *>(self)->value;
+        }
+
+        static Object local(const CompiledExpr *self, Interpreter &interpreter) {
+            auto node = static_cast<const Local *>(self);
+            return interpreter.environment->get(node->name, node->depth, node->index);
+        }
+
+        static Object global(const CompiledExpr *self, Interpreter &interpreter) {
+            auto node = static_cast<const Global *>(self);
+            const Object &val = interpreter.global_values[interpreter.global_index(node->slot)];
+            if (!val.is_uninitialized())
+                return val;
+            // raises the error for an undefined or uninitialized global
+            return interpreter.lookup(node->name, node->slot);
+        }
+
+        static Object assign_local(const CompiledExpr *self, Interpreter &interpreter) {
+            auto node = static_cast<const AssignLocal *>(self);
+            Object value = evaluate(node->value, interpreter);
+            interpreter.environment->assign(node->depth, node->index, value);
+            return value;
+        }
+
+        static Object assign_global(const CompiledExpr *self, Interpreter &interpreter) {
+            auto node = static_cast<const AssignGlobal *>(self);
+            Object value = evaluate(node->value, interpreter);
+            interpreter.assign(node->name, node->slot, value);
+            return value;
+        }
+
+        template<token_type OP>
+        static Object binary(const CompiledExpr *self, Interpreter &interpreter) {
+            auto node = static_cast<const Operation *>(self);
+            Object left = evaluate(node->left, interpreter);
+            if constexpr (OP == COMMA) {
+                return evaluate(node->right, interpreter);
+            } else {
+                // the right operand may allocate and trigger a collection
+                bool root_left = left.is_heap_object();
+                if (root_left)
+                    interpreter.stack.push_back(left);
+                Object right = evaluate(node->right, interpreter);
+                if (root_left)
+                    interpreter.stack.pop_back();
+                if constexpr (OP == EQUAL_EQUAL) {
+                    return values_equal(left, right);
+                } else if constexpr (OP == BANG_EQUAL) {
+                    return !values_equal(left, right);
+                } else if constexpr (OP == PLUS) {
+                    if (left.is_number() && right.is_number())
+                        return left.as_number() + right.as_number();
+                    if (left.is_string()) {
+                        if (right.is_string())
+                            return interpreter.heap.make_string(left.as_string() + right.as_string());
+                        if (right.is_number())
+                            return interpreter.heap.make_string(left.as_string() + to_string(right.as_number()));
+                    }
+                    if (left.is_number() && right.is_string())
+                        return interpreter.heap.make_string(to_string(left.as_number()) + right.as_string());
+                    interpreter.check_number_operands(node->oper, left, right);
+                    return {};
+                } else {
+                    interpreter.check_number_operands(node->oper, left, right);
+                    double a = left.as_number(), b = right.as_number();
+                    if constexpr (OP == MINUS)
+                        return a - b;
+                    else if constexpr (OP == STAR)
+                        return a * b;
+                    else if constexpr (OP == SLASH) {
+                        interpreter.check_not_zero(node->oper, b);
+                        return a / b;
+                    } else if constexpr (OP == GREATER)
+                        return a > b;
+                    else if constexpr (OP == GREATER_EQUAL)
+                        return a >= b;
+                    else if constexpr (OP == LESS)
+                        return a < b;
+                    else
+                        return a <= b;
+                }
+            }
+        }
+
+        static Object negate(const CompiledExpr *self, Interpreter &interpreter) {
+            auto node = static_cast<const Operation *>(self);
+            Object right = evaluate(node->right, interpreter);
+            interpreter.check_number_operand(node->oper, right);
+            return -right.as_number();
+        }
+
+        static Object logical_not(const CompiledExpr *self, Interpreter &interpreter) {
+            auto node = static_cast<const Operation *>(self);
+            return !is_truthy(evaluate(node->right, interpreter));
+        }
+
+        template<bool IS_OR>
+        static Object logical(const CompiledExpr *self, Interpreter &interpreter) {
+            auto node = static_cast<const Operation *>(self);
+            Object left = evaluate(node->left, interpreter);
+            if (is_truthy(left) == IS_OR)
+                return left;
+            return evaluate(node->right, interpreter);
+        }
+
+        static Object ternary(const CompiledExpr *self, Interpreter &interpreter) {
+            auto node = static_cast<const Conditional *>(self);
+            if (is_truthy(evaluate(node->condition, interpreter)))
+                return evaluate(node->left, interpreter);
+            return evaluate(node->right, interpreter);
+        }
+
+        static Object call(const CompiledExpr *self, Interpreter &interpreter) {
+            auto node = static_cast<const CallNode *>(self);
+            // the callee and arguments stay on the stack until the call returns so a collection can't free them
+            size_t base = push_call(node, interpreter);
+            Object result = call_at(node->paren, interpreter.callee_at(base), interpreter, interpreter.arguments_at(base));
+            interpreter.stack.resize(base);
+            return result;
+        }
+
+        static size_t push_call(const CallNode *node, Interpreter &interpreter) {
+            auto &stack = interpreter.stack;
+            size_t base = stack.size();
+            stack.push_back(evaluate(node->callee, interpreter));
+            for (auto argument: node->arguments)
+                stack.push_back(evaluate(argument, interpreter));
+            interpreter.check_call(node->paren, base);
+            return base;
+        }
+
+        static Object closure(const CompiledExpr *self, Interpreter &interpreter);
+
+        static Object get(const CompiledExpr *self, Interpreter &interpreter) {
+            auto node = static_cast<const Property *>(self);
+            Object object = evaluate(node->object, interpreter);
+            LoxInstance *instance = LoxInstance::receiver(object, node->name);
+            // binding a method allocates
+            interpreter.stack.push_back(object);
+            Object result = instance->get(interpreter.heap, node->name, interpreter.feedback->caches[node->cache]);
+            interpreter.stack.pop_back();
+            return result;
+        }
+
+        static Object set(const CompiledExpr *self, Interpreter &interpreter) {
+            auto node = static_cast<const Property *>(self);
+            Object object = evaluate(node->object, interpreter);
+            interpreter.stack.push_back(object);
+            Object result = evaluate(node->value, interpreter);
+            interpreter.stack.pop_back();
+            LoxInstance::target(object, node->name)->set(node->name, interpreter.feedback->caches[node->cache], result);
+            return result;
+        }
+
+        static Object invoke(const CompiledExpr *self, Interpreter &interpreter) {
+            auto node = static_cast<const Invoke *>(self);
+            auto &stack = interpreter.stack;
+            size_t base = stack.size();
+            stack.push_back(evaluate(node->object, interpreter));
+            for (auto argument: node->arguments)
+                stack.push_back(evaluate(argument, interpreter));
+            Object result = interpreter.invoke(node->name, interpreter.feedback->caches[node->cache], node->paren, base);
+            stack.resize(base);
+            return result;
+        }
+
+        static Object super_access(const CompiledExpr *self, Interpreter &interpreter) {
+            return interpreter.bind_super(static_cast<const SuperAccess *>(self)->expr);
+        }
+
+        static Object nothing(const CompiledExpr *, Interpreter &) {
+            throw std::runtime_error("Runtime error");
+        }
+
+        static Completion expression(const CompiledStmt *self, Interpreter &interpreter) {
+            evaluate(static_cast<const ExprStmt *>(self)->expression, interpreter);
+            return Completion::NORMAL;
+        }
+
+        static Completion print(const CompiledStmt *self, Interpreter &interpreter) {
+            Object val = evaluate(static_cast<const ExprStmt *>(self)->expression, interpreter);
+            interpreter.print(val);
+            return Completion::NORMAL;
+        }
+
+        static Object initial_value(const Declaration *node, Interpreter &interpreter) {
+            return node->initializer ? evaluate(node->initializer, interpreter) : Object::uninitialized();
+        }
+
+        static Completion define_local(const CompiledStmt *self, Interpreter &interpreter) {
+            auto node = static_cast<const Declaration *>(self);
+            interpreter.environment->define(node->slot.index, initial_value(node, interpreter));
+            return Completion::NORMAL;
+        }
+
+        static Completion define_global(const CompiledStmt *self, Interpreter &interpreter) {
+            auto node = static_cast<const Declaration *>(self);
+            interpreter.define(node->slot, initial_value(node, interpreter));
+            return Completion::NORMAL;
+        }
+
+        static Completion block(const CompiledStmt *self, Interpreter &interpreter) {
+            return execute_all(static_cast<const BlockStmt *>(self)->statements, interpreter);
+        }
+
+        static Completion scoped_block(const CompiledStmt *self, Interpreter &interpreter) {
+            auto node = static_cast<const BlockStmt *>(self);
+            Environment *env = interpreter.new_environment(interpreter.environment, node->num_slots);
+            Completion completion = execute_block(node->statements, env, interpreter);
+            if (!node->captured)
+                interpreter.release_environment(env);
+            return completion;
+        }
+
+        static Completion if_else(const CompiledStmt *self, Interpreter &interpreter) {
+            auto node = static_cast<const IfStmt *>(self);
+            if (is_truthy(evaluate(node->condition, interpreter)))
+                return execute(node->then_branch, interpreter);
+            if (node->else_branch)
+                return execute(node->else_branch, interpreter);
+            return Completion::NORMAL;
+        }
+
+        static Completion loop(const CompiledStmt *self, Interpreter &interpreter) {
+            auto node = static_cast<const WhileStmt *>(self);
+            // the Optimizer drops conditions that are always true
+            while (!node->condition || is_truthy(evaluate(node->condition, interpreter))) {
+                Completion completion = execute(node->body, interpreter);
+                // a break is consumed here, a return keeps unwinding to the call
+                if (completion == Completion::BREAK)
+                    break;
+                if (completion == Completion::RETURN)
+                    return completion;
+            }
+            return Completion::NORMAL;
+        }
+
+        static Completion break_loop(const CompiledStmt *, Interpreter &) {
+            return Completion::BREAK;
+        }
+
+        static Completion return_value(const CompiledStmt *self, Interpreter &interpreter) {
+            auto node = static_cast<const ExprStmt *>(self);
+            interpreter.return_value = node->expression ? evaluate(node->expression, interpreter) : Object();
+            return Completion::RETURN;
+        }
+
+        static Completion tail_call(const CompiledStmt *self, Interpreter &interpreter) {
+            auto node = static_cast<const ExprStmt *>(self);
+            interpreter.tail_call_base = push_call(static_cast<const CallNode *>(node->expression), interpreter);
+            interpreter.tail_call_paren = &static_cast<const CallNode *>(node->expression)->paren;
+            return Completion::TAIL_CALL;
+        }
+
+        static Completion function(const CompiledStmt *self, Interpreter &interpreter);
+
+        static Completion define_class(const CompiledStmt *self, Interpreter &interpreter);
+
+        static Object call_function(const FunctionCode &code, Environment *closure, Feedback *feedback,
+                                    Interpreter &interpreter,
+                                    Object receiver, Arguments arguments);
+    };
+
+    // a function declared in closure compiled code, the counterpart of LoxFunction
+    class CompiledFunction : public Callable {
+        friend struct ClosureRuntime;
+        const ClosureRuntime::FunctionCode *code;
+        Environment *closure;
+        Feedback *feedback;
+    public:
+        CompiledFunction(const ClosureRuntime::FunctionCode *code, Environment *closure, Feedback *feedback)
+                : code(code), closure(closure), feedback(feedback) {};
+
+        Object call(Interpreter &interpreter, Arguments arguments) override {
+            return ClosureRuntime::call_function(*code, closure, feedback, interpreter, {}, arguments);
+        }
+
+        Object call_method(Interpreter &interpreter, Object receiver, Arguments arguments) override {
+            return ClosureRuntime::call_function(*code, closure, feedback, interpreter, receiver, arguments);
+        }
+
+        int arity() override { return (int) code->arity; }
+
+        void trace(Heap &heap) override { heap.mark_object(closure); }
+
+        Obj *copy(ObjectCopier &copier) const override {
+            auto *function = copier.target.heap.allocate<CompiledFunction>(code, nullptr, copier.copy_feedback(feedback));
+            copier.remember(this, function);
+            function->closure = copier.copy(closure);
+            return function;
+        }
+
+        size_t size() const override { return sizeof(CompiledFunction); }
+
+        std::string to_string() const override {
+            return "<fn " + (code->name ? std::string(code->name->lexeme) : "anonymous") + ">";
+        }
+    };
+
+    Object ClosureRuntime::closure(const CompiledExpr *self, Interpreter &interpreter) {
+        auto node = static_cast<const Closure *>(self);
+        Callable *fn = interpreter.heap.allocate<CompiledFunction>(node->code, interpreter.environment,
+                                                                  interpreter.feedback);
+        return fn;
+    }
+
+    // the same loop as LoxFunction::call, a tail call runs in place of the function that made it
+    Object ClosureRuntime::call_function(const FunctionCode &function, Environment *closure, Feedback *feedback,
+                                         Interpreter &interpreter, Object receiver, Arguments arguments) {
+        const FunctionCode *code = &function;
+        bool tail_call = false;
+        Feedback *caller_feedback = interpreter.feedback;
+        while (true) {
+            uint32_t first = code->kind == FunctionKind::FUNCTION ? 0 : 1;
+            Environment *env;
+            if (first) {
+                // a new instance is only referenced from here until it is in slot 0
+                interpreter.heap.pause_collection();
+                env = interpreter.new_environment(closure, code->num_slots);
+                interpreter.heap.resume_collection();
+                env->define(0, receiver);
+            } else {
+                env = interpreter.new_environment(closure, code->num_slots);
+            }
+            for (uint32_t i = 0; i < code->arity; i++)
+                env->define((int) (i + first), arguments[i]);
+            if (tail_call)
+                interpreter.drop_call(interpreter.tail_call_base);
+            interpreter.feedback = feedback;
+            Completion completion = execute_block(code->body, env, interpreter);
+            interpreter.feedback = caller_feedback;
+            if (!code->captured)
+                interpreter.release_environment(env);
+            if (code->kind == FunctionKind::INITIALIZER) {
+                if (completion == Completion::RETURN)
+                    interpreter.take_return_value();
+                return receiver;
+            }
+            if (completion == Completion::RETURN)
+                return interpreter.take_return_value();
+            if (completion != Completion::TAIL_CALL)
+                return {};
+            size_t base = interpreter.take_tail_call();
+            arguments = interpreter.arguments_at(base);
+            Callable *callee = interpreter.callee_at(base);
+            receiver = Object();
+            if (auto bound = dynamic_cast<BoundMethod *>(callee)) {
+                receiver = bound->receiver;
+                callee = bound->method;
+            }
+            auto *next = dynamic_cast<CompiledFunction *>(callee);
+            if (!next) {
+                Object result = call_at(interpreter.tail_call_site(), interpreter.callee_at(base), interpreter, arguments);
+                interpreter.drop_call(base);
+                return result;
+            }
+            code = next->code;
+            closure = next->closure;
+            feedback = next->feedback;
+            tail_call = true;
+        }
+    }
+
+    Completion ClosureRuntime::function(const CompiledStmt *self, Interpreter &interpreter) {
+        auto node = static_cast<const FunctionStmt *>(self);
+        Callable *fn = interpreter.heap.allocate<CompiledFunction>(node->code, interpreter.environment,
+                                                                  interpreter.feedback);
+        interpreter.define(node->slot, fn);
+        return Completion::NORMAL;
+    }
+
+    // Interpreter::define_class with compiled methods
+    Completion ClosureRuntime::define_class(const CompiledStmt *self, Interpreter &interpreter) {
+        auto node = static_cast<const ClassStmt *>(self);
+        Class *stmt = node->stmt;
+        LoxClass *superclass = nullptr;
+        if (node->superclass) {
+            auto name = static_cast<Variable *>(stmt->superclass)->name;
+            superclass = LoxClass::superclass_of(evaluate(node->superclass, interpreter), name);
+        }
+        Callable *klass = interpreter.heap.allocate<LoxClass>(std::string(stmt->name.lexeme), superclass);
+        interpreter.define(stmt->slot, klass);
+        Environment *closure = interpreter.environment;
+        if (superclass) {
+            closure = interpreter.new_environment(interpreter.environment, 1);
+            closure->define(0, superclass);
+            interpreter.stack.push_back(static_cast<Obj *>(closure));
+        }
+        for (auto code: node->methods) {
+            Callable *fn = interpreter.heap.allocate<CompiledFunction>(code, closure, interpreter.feedback);
+            static_cast<LoxClass *>(klass)->add_method(constant_string(std::string(code->name->lexeme)), fn);
+        }
+        if (superclass)
+            interpreter.stack.pop_back();
+        return Completion::NORMAL;
+    }
+
+    using R = ClosureRuntime;
+
+    NodeList<const CompiledStmt *> ClosureCompiler::compile_program(const Program &program) {
+        return compile(program.statements);
+    }
+
+    void ClosureCompiler::run(Interpreter &interpreter, const Program &program, NodeList<const CompiledStmt *> code,
+                              bool print_expressions) {
+        interpreter.enter_program(program);
+        try {
+            for (auto stmt: code) {
+                // at the prompt an expression statement prints its value
+                if (print_expressions && stmt->exec == &R::expression)
+                    R::print(stmt, interpreter);
+                else
+                    R::execute(stmt, interpreter);
+            }
+        }
+        catch (RuntimeException &e) {
+            R::reset(interpreter);
+            Lox::runtime_error(e);
+        }
+    }
+
+    const CompiledExpr *ClosureCompiler::compile(Expr *expr) {
+        if (!expr)
+            return nullptr;
+        const CompiledExpr *enclosing = expr_result;
+        expr->accept(*this);
+        const CompiledExpr *result = expr_result;
+        expr_result = enclosing;
+        return result;
+    }
+
+    const CompiledStmt *ClosureCompiler::compile(Stmt *stmt) {
+        if (!stmt)
+            return nullptr;
+        const CompiledStmt *enclosing = stmt_result;
+        stmt->accept(*this);
+        const CompiledStmt *result = stmt_result;
+        stmt_result = enclosing;
+        return result;
+    }
+
+    NodeList<const CompiledStmt *> ClosureCompiler::compile(NodeList<Stmt *> statements) {
+        return arena.make_list<const CompiledStmt *>(statements.size(), [&, itr = statements.begin()]() mutable {
+            return compile(*itr++);
+        });
+    }
+
+    static const R::FunctionCode *function_code(Arena &arena, FunctionExpr *function, const Token *name,
+                                                NodeList<const CompiledStmt *> body,
+                                                FunctionKind kind = FunctionKind::FUNCTION) {
+        return arena.make<R::FunctionCode>(R::FunctionCode{body, function->params.size(), function->num_slots,
+                                                           function->captured, name, kind});
+    }
+
+    void ClosureCompiler::visit(Expression *stmt) {
+        stmt_result = make<R::ExprStmt>(&R::expression, compile(stmt->expression));
+    }
+
+    void ClosureCompiler::visit(Print *stmt) {
+        stmt_result = make<R::ExprStmt>(&R::print, compile(stmt->expression));
+    }
+
+    void ClosureCompiler::visit(Block *stmt) {
+        auto run = stmt->num_slots == 0 ? &R::block : &R::scoped_block;
+        stmt_result = make<R::BlockStmt>(run, compile(stmt->statements), stmt->num_slots, stmt->captured);
+    }
+
+    void ClosureCompiler::visit(Var *stmt) {
+        auto define = stmt->slot.is_global() ? &R::define_global : &R::define_local;
+        stmt_result = make<R::Declaration>(define, compile(stmt->initializer), stmt->slot);
+    }
+
+    void ClosureCompiler::visit(If *stmt) {
+        stmt_result = make<R::IfStmt>(&R::if_else, compile(stmt->condition), compile(stmt->then_branch),
+                                      compile(stmt->else_branch));
+    }
+
+    void ClosureCompiler::visit(While *stmt) {
+        stmt_result = make<R::WhileStmt>(&R::loop, compile(stmt->condition), compile(stmt->body));
+    }
+
+    void ClosureCompiler::visit(Break *stmt) {
+        stmt_result = make<CompiledStmt>(&R::break_loop);
+    }
+
+    void ClosureCompiler::visit(Return *stmt) {
+        stmt_result = stmt->tail_call ? compile_return(stmt->value)
+                                      : make<R::ExprStmt>(&R::return_value, compile(stmt->value));
+    }
+
+    const CompiledStmt *ClosureCompiler::compile_return(Expr *value) {
+        // a conditional in tail position is an if statement returning from both branches
+        if (value->kind == ExprKind::Ternary) {
+            auto ternary = static_cast<Ternary *>(value);
+            return make<R::IfStmt>(&R::if_else, compile(ternary->condition), compile_return(ternary->left),
+                                   compile_return(ternary->right));
+        }
+        if (value->kind == ExprKind::Call)
+            return make<R::ExprStmt>(&R::tail_call, compile_call(static_cast<Call *>(value)));
+        return make<R::ExprStmt>(&R::return_value, compile(value));
+    }
+
+    void ClosureCompiler::visit(Function *stmt) {
+        auto code = function_code(arena, stmt->fn_expr, &stmt->name, compile(stmt->fn_expr->body));
+        stmt_result = make<R::FunctionStmt>(&R::function, code, stmt->slot);
+    }
+
+    void ClosureCompiler::visit(Binary *expr) {
+        Object (*eval)(const CompiledExpr *, Interpreter &) = nullptr;
+        switch (expr->oper.type) {
+            case COMMA: eval = &R::binary<COMMA>; break;
+            case PLUS: eval = &R::binary<PLUS>; break;
+            case MINUS: eval = &R::binary<MINUS>; break;
+            case STAR: eval = &R::binary<STAR>; break;
+            case SLASH: eval = &R::binary<SLASH>; break;
+            case GREATER: eval = &R::binary<GREATER>; break;
+            case GREATER_EQUAL: eval = &R::binary<GREATER_EQUAL>; break;
+            case LESS: eval = &R::binary<LESS>; break;
+            case LESS_EQUAL: eval = &R::binary<LESS_EQUAL>; break;
+            case EQUAL_EQUAL: eval = &R::binary<EQUAL_EQUAL>; break;
+            case BANG_EQUAL: eval = &R::binary<BANG_EQUAL>; break;
+            default: eval = &R::nothing; break;
+        }
+        expr_result = make<R::Operation>(eval, compile(expr->left), compile(expr->right), expr->oper);
+    }
+
+    void ClosureCompiler::visit(Grouping *expr) {
+        expr_result = compile(expr->expression);
+    }
+
+    void ClosureCompiler::visit(Ternary *expr) {
+        expr_result = make<R::Conditional>(&R::ternary, compile(expr->condition), compile(expr->left),
+                                           compile(expr->right));
+    }
+
+    void ClosureCompiler::visit(Literal *expr) {
+        expr_result = make<R::Constant>(&R::constant, expr->value);
+    }
+
+    void ClosureCompiler::visit(Unary *expr) {
+        auto eval = expr->oper.type == MINUS ? &R::negate : &R::logical_not;
+        expr_result = make<R::Operation>(eval, nullptr, compile(expr->right), expr->oper);
+    }
+
+    void ClosureCompiler::visit(Nothing *expr) {
+        expr_result = make<CompiledExpr>(&R::nothing);
+    }
+
+    void ClosureCompiler::visit(Variable *expr) {
+        if (expr->slot.is_global())
+            expr_result = make<R::Global>(&R::global, expr->name, expr->slot);
+        else
+            expr_result = make<R::Local>(&R::local, expr->name, expr->slot.depth, expr->slot.index);
+    }
+
+    void ClosureCompiler::visit(Logical *expr) {
+        auto eval = expr->oper.type == OR ? &R::logical<true> : &R::logical<false>;
+        expr_result = make<R::Operation>(eval, compile(expr->left), compile(expr->right), expr->oper);
+    }
+
+    void ClosureCompiler::visit(Assign *expr) {
+        if (expr->slot.is_global())
+            expr_result = make<R::AssignGlobal>(&R::assign_global, compile(expr->value), expr->name, expr->slot);
+        else
+            expr_result = make<R::AssignLocal>(&R::assign_local, compile(expr->value), expr->slot.depth,
+                                               expr->slot.index);
+    }
+
+    void ClosureCompiler::visit(Class *stmt) {
+        auto methods = arena.make_list<const R::FunctionCode *>(
+                stmt->methods.size(), [this, itr = stmt->methods.begin()]() mutable {
+                    Function *method = *itr++;
+                    auto kind = method->name.lexeme == "init" ? FunctionKind::INITIALIZER : FunctionKind::METHOD;
+                    return function_code(arena, method->fn_expr, &method->name, compile(method->fn_expr->body), kind);
+                });
+        stmt_result = make<R::ClassStmt>(&R::define_class, stmt, compile(stmt->superclass), methods);
+    }
+
+    void ClosureCompiler::visit(Get *expr) {
+        expr_result = make<R::Property>(&R::get, compile(expr->object), nullptr, expr->name, expr->cache);
+    }
+
+    void ClosureCompiler::visit(Set *expr) {
+        expr_result = make<R::Property>(&R::set, compile(expr->object), compile(expr->value), expr->name,
+                                        expr->cache);
+    }
+
+    void ClosureCompiler::visit(This *expr) {
+        expr_result = make<R::Local>(&R::local, expr->keyword, expr->slot.depth, expr->slot.index);
+    }
+
+    void ClosureCompiler::visit(Super *expr) {
+        expr_result = make<R::SuperAccess>(&R::super_access, expr);
+    }
+
+    void ClosureCompiler::visit(Call *expr) {
+        if (expr->callee->kind == ExprKind::Get) {
+            auto get = static_cast<Get *>(expr->callee);
+            auto arguments = arena.make_list<const CompiledExpr *>(
+                    expr->arguments.size(), [this, itr = expr->arguments.begin()]() mutable { return compile(*itr++); });
+            expr_result = make<R::Invoke>(&R::invoke, compile(get->object), arguments, get->name, expr->paren,
+                                          get->cache);
+            return;
+        }
+        expr_result = compile_call(expr);
+    }
+
+    const CompiledExpr *ClosureCompiler::compile_call(Call *expr) {
+        const CompiledExpr *callee = compile(expr->callee);
+        auto arguments = arena.make_list<const CompiledExpr *>(
+                expr->arguments.size(), [this, itr = expr->arguments.begin()]() mutable { return compile(*itr++); });
+        return make<R::CallNode>(&R::call, callee, arguments, expr->paren);
+    }
+
+    void ClosureCompiler::visit(FunctionExpr *expr) {
+        expr_result = make<R::Closure>(&R::closure, function_code(arena, expr, nullptr, compile(expr->body)));
+    }
+
+} // Lox
@@ -0,0 +1,615 @@
+#include "Compiler.h"
+#include "VM.h"
+#include "lox.h"
+#include "utils.h"
+
+namespace Lox {
+
+    ObjFunction *Compiler::compile(NodeList<Stmt *> statements) {
+        FunctionState script{nullptr, vm.new_function(), FunctionType::SCRIPT};
+        // slot 0 of every frame holds the callee
+        script.locals.push_back({"", 0, false});
+        current = &script;
+        had_compile_error = false;
+        for (auto stmt: statements) {
+            auto *expression = dynamic_cast<Expression *>(stmt);
+            if (print_expressions && expression) {
+                compile(expression->expression);
+                emit(OP_PRINT);
+            } else {
+                compile(stmt);
+            }
+        }
+        emit(OP_NIL);
+        emit(OP_RETURN);
+        current = nullptr;
+        return had_compile_error ? nullptr : script.function;
+    }
+
+    Chunk &Compiler::chunk() {
+        return current->function->chunk;
+    }
+
+    void Compiler::emit(uint8_t byte) {
+        chunk().write(byte, line);
+    }
+
+    void Compiler::emit(uint8_t op, uint8_t operand) {
+        emit(op);
+        emit(operand);
+    }
+
+    void Compiler::emit_short(uint8_t op, int operand) {
+        emit(op);
+        emit((operand >> 8) & 0xff);
+        emit(operand & 0xff);
+    }
+
+    size_t Compiler::emit_jump(uint8_t op) {
+        emit_short(op, 0xffff);
+        return chunk().code.size() - 2;
+    }
+
+    void Compiler::patch_jump(size_t offset) {
+        // -2 to adjust for the jump offset itself
+        size_t jump = chunk().code.size() - offset - 2;
+        if (jump > UINT16_MAX) {
+            compile_error(Token(T_EOF, "", line), "Too much code to jump over.");
+        }
+        chunk().code[offset] = (jump >> 8) & 0xff;
+        chunk().code[offset + 1] = jump & 0xff;
+    }
+
+    void Compiler::emit_loop(size_t loop_start) {
+        size_t offset = chunk().code.size() - loop_start + 3;
+        if (offset > UINT16_MAX) {
+            compile_error(Token(T_EOF, "", line), "Loop body too large.");
+        }
+        emit_short(OP_LOOP, (int) offset);
+    }
+
+    void Compiler::emit_constant(Value value) {
+        int index = chunk().add_constant(std::move(value));
+        if (index > UINT16_MAX) {
+            compile_error(Token(T_EOF, "", line), "Too many constants in one chunk.");
+        }
+        emit_short(OP_CONSTANT, index);
+    }
+
+    void Compiler::emit_return() {
+        if (current->type == FunctionType::INITIALIZER)
+            emit(OP_GET_LOCAL, 0);
+        else
+            emit(OP_NIL);
+        emit(OP_RETURN);
+    }
+
+    int Compiler::add_cache(const Token &name) {
+        auto &caches = chunk().caches;
+        if (caches.size() > UINT16_MAX) {
+            compile_error(name, "Too many property accesses in one chunk.");
+            return 0;
+        }
+        caches.push_back(PropertyCache{constant_string(std::string(name.lexeme)), {}, 0, false});
+        return (int) caches.size() - 1;
+    }
+
+    void Compiler::named_variable(std::string_view name) {
+        int arg = resolve_local(current, name);
+        if (arg != -1) {
+            emit(OP_GET_LOCAL, arg);
+        } else if ((arg = resolve_upvalue(current, name)) != -1) {
+            emit(OP_GET_UPVALUE, arg);
+        } else {
+            emit_short(OP_GET_GLOBAL, vm.global_slot(name));
+        }
+    }
+
+    void Compiler::compile(Stmt *stmt) {
+        if (stmt)stmt->accept(*this);
+    }
+
+    void Compiler::compile(Expr *expr) {
+        expr->accept(*this);
+    }
+
+    void Compiler::compile_function(FunctionExpr *expr, std::string_view name, FunctionType type) {
+        FunctionState state{current, vm.new_function(), type};
+        state.function->name = name;
+        state.function->arity = (int) expr->params.size();
+        // a method's receiver takes the place of the callee
+        state.locals.push_back({type == FunctionType::FUNCTION ? "" : "this", 0, false});
+        current = &state;
+        begin_scope();
+        for (auto &param: expr->params) {
+            add_local(param.lexeme);
+        }
+        for (auto stmt: expr->body) {
+            compile(stmt);
+        }
+        emit_return();
+        // the frame is discarded as a whole on return, so there is no end_scope() here
+        state.function->upvalue_count = (int) state.upvalues.size();
+        current = state.enclosing;
+
+        int index = chunk().add_constant(Value((Obj *) state.function));
+        emit_short(OP_CLOSURE, index);
+        for (auto &upvalue: state.upvalues) {
+            emit(upvalue.is_local ? 1 : 0, upvalue.index);
+        }
+    }
+
+    void Compiler::begin_scope() {
+        current->scope_depth++;
+    }
+
+    void Compiler::end_scope() {
+        current->scope_depth--;
+        auto &locals = current->locals;
+        while (!locals.empty() && locals.back().depth > current->scope_depth) {
+            emit(locals.back().is_captured ? OP_CLOSE_UPVALUE : OP_POP);
+            locals.pop_back();
+        }
+    }
+
+    void Compiler::discard_locals(int depth) {
+        auto &locals = current->locals;
+        for (int i = (int) locals.size() - 1; i >= 0 && locals[i].depth > depth; i--) {
+            emit(locals[i].is_captured ? OP_CLOSE_UPVALUE : OP_POP);
+        }
+    }
+
+    int Compiler::add_local(std::string_view name) {
+        if (current->locals.size() > UINT8_MAX) {
+            compile_error(Token(IDENTIFIER, name, line), "Too many local variables in function.");
+            return 0;
+        }
+        current->locals.push_back({name, current->scope_depth, false});
+        return (int) current->locals.size() - 1;
+    }
+
+    int Compiler::resolve_local(FunctionState *state, std::string_view name) {
+        for (int i = (int) state->locals.size() - 1; i >= 0; i--) {
+            if (state->locals[i].name == name)
+                return i;
+        }
+        return -1;
+    }
+
+    int Compiler::resolve_upvalue(FunctionState *state, std::string_view name) {
+        if (!state->enclosing)
+            return -1;
+        int local = resolve_local(state->enclosing, name);
+        if (local != -1) {
+            state->enclosing->locals[local].is_captured = true;
+            return add_upvalue(state, (uint8_t) local, true);
+        }
+        int upvalue = resolve_upvalue(state->enclosing, name);
+        if (upvalue != -1) {
+            return add_upvalue(state, (uint8_t) upvalue, false);
+        }
+        return -1;
+    }
+
+    int Compiler::add_upvalue(FunctionState *state, uint8_t index, bool is_local) {
+        auto &upvalues = state->upvalues;
+        for (int i = 0; i < upvalues.size(); i++) {
+            if (upvalues[i].index == index && upvalues[i].is_local == is_local)
+                return i;
+        }
+        if (upvalues.size() > UINT8_MAX) {
+            compile_error(Token(T_EOF, "", line), "Too many closure variables in function.");
+            return 0;
+        }
+        upvalues.push_back({index, is_local});
+        return (int) upvalues.size() - 1;
+    }
+
+    void Compiler::compile_error(const Token &token, const std::string &message) {
+        Lox::error(token, message);
+        had_compile_error = true;
+    }
+
+    void Compiler::visit(Expression *stmt) {
+        compile(stmt->expression);
+        emit(OP_POP);
+    }
+
+    void Compiler::visit(Print *stmt) {
+        compile(stmt->expression);
+        emit(OP_PRINT);
+    }
+
+    void Compiler::visit(Block *stmt) {
+        begin_scope();
+        for (auto inner: stmt->statements) {
+            compile(inner);
+        }
+        end_scope();
+    }
+
+    void Compiler::visit(Var *stmt) {
+        line = stmt->name.line;
+        // the initializer is compiled before the name is declared so that `var a = a;` refers to the outer a
+        if (stmt->initializer) {
+            compile(stmt->initializer);
+        } else {
+            emit(OP_UNINITIALIZED);
+        }
+        if (current->scope_depth == 0) {
+            emit_short(OP_DEFINE_GLOBAL, vm.global_slot(stmt->name.lexeme));
+            return;
+        }
+        // redeclaring a name in the same scope reuses its slot like the tree walker does
+        int existing = resolve_local(current, stmt->name.lexeme);
+        if (existing != -1 && current->locals[existing].depth == current->scope_depth) {
+            emit(OP_SET_LOCAL, existing);
+            emit(OP_POP);
+            return;
+        }
+        add_local(stmt->name.lexeme);
+    }
+
+    void Compiler::visit(If *stmt) {
+        compile(stmt->condition);
+        size_t then_jump = emit_jump(OP_JUMP_IF_FALSE);
+        emit(OP_POP);
+        compile(stmt->then_branch);
+        size_t else_jump = emit_jump(OP_JUMP);
+        patch_jump(then_jump);
+        emit(OP_POP);
+        compile(stmt->else_branch);
+        patch_jump(else_jump);
+    }
+
+    void Compiler::visit(While *stmt) {
+        size_t loop_start = chunk().code.size();
+        // the Optimizer drops conditions that are always true, such loops only end with a break or return
+        size_t exit_jump = 0;
+        if (stmt->condition) {
+            compile(stmt->condition);
+            exit_jump = emit_jump(OP_JUMP_IF_FALSE);
+            emit(OP_POP);
+        }
+        current->loops.push_back({current->scope_depth, {}});
+        compile(stmt->body);
+        emit_loop(loop_start);
+        if (stmt->condition) {
+            patch_jump(exit_jump);
+            emit(OP_POP);
+        }
+        // breaks jump past the pop of the condition, they leave nothing on the stack
+        for (size_t jump: current->loops.back().break_jumps) {
+            patch_jump(jump);
+        }
+        current->loops.pop_back();
+    }
+
+    void Compiler::visit(Break *stmt) {
+        if (current->loops.empty()) {
+            compile_error(Token(T_BREAK, "break", line), "Cannot use 'break' without a loop");
+            return;
+        }
+        discard_locals(current->loops.back().scope_depth);
+        current->loops.back().break_jumps.push_back(emit_jump(OP_JUMP));
+    }
+
+    void Compiler::visit(Return *stmt) {
+        line = stmt->keyword.line;
+        if (current->type == FunctionType::SCRIPT) {
+            compile_error(stmt->keyword, "Can't return from top-level code.");
+        }
+        if (!stmt->value) {
+            emit_return();
+            return;
+        }
+        if (current->type == FunctionType::INITIALIZER) {
+            compile_error(stmt->keyword, "Can't return a value from an initializer.");
+        }
+        compile_return(stmt->value);
+    }
+
+    void Compiler::compile_return(Expr *value) {
+        // both branches of a conditional are in tail position, each returns on its own
+        if (value->kind == ExprKind::Ternary) {
+            auto ternary = static_cast<Ternary *>(value);
+            compile(ternary->condition);
+            size_t else_jump = emit_jump(OP_JUMP_IF_FALSE);
+            emit(OP_POP);
+            compile_return(ternary->left);
+            patch_jump(else_jump);
+            emit(OP_POP);
+            compile_return(ternary->right);
+            return;
+        }
+        tail_call = value->kind == ExprKind::Call;
+        compile(value);
+        emit(OP_RETURN);
+    }
+
+    void Compiler::visit(Function *stmt) {
+        line = stmt->name.line;
+        std::string_view name = stmt->name.lexeme;
+        if (current->scope_depth == 0) {
+            compile_function(stmt->fn_expr, name);
+            emit_short(OP_DEFINE_GLOBAL, vm.global_slot(name));
+            return;
+        }
+        int existing = resolve_local(current, name);
+        if (existing != -1 && current->locals[existing].depth == current->scope_depth) {
+            compile_function(stmt->fn_expr, name);
+            emit(OP_SET_LOCAL, existing);
+            emit(OP_POP);
+            return;
+        }
+        // declared before the body is compiled so the function can refer to itself recursively
+        add_local(name);
+        compile_function(stmt->fn_expr, name);
+    }
+
+    void Compiler::visit(Binary *expr) {
+        compile(expr->left);
+        if (expr->oper.type == COMMA) {
+            emit(OP_POP);
+            compile(expr->right);
+            return;
+        }
+        compile(expr->right);
+        line = expr->oper.line;
+        switch (expr->oper.type) {
+            case MINUS:
+                emit(OP_SUBTRACT);
+                break;
+            case SLASH:
+                emit(OP_DIVIDE);
+                break;
+            case STAR:
+                emit(OP_MULTIPLY);
+                break;
+            case PLUS:
+                emit(OP_ADD);
+                break;
+            case GREATER:
+                emit(OP_GREATER);
+                break;
+            case GREATER_EQUAL:
+                emit(OP_GREATER_EQUAL);
+                break;
+            case LESS:
+                emit(OP_LESS);
+                break;
+            case LESS_EQUAL:
+                emit(OP_LESS_EQUAL);
+                break;
+            case BANG_EQUAL:
+                emit(OP_NOT_EQUAL);
+                break;
+            case EQUAL_EQUAL:
+                emit(OP_EQUAL);
+                break;
+            default:
+                // unknown operators evaluate to nil in the tree walker as well
+                emit(OP_POP);
+                emit(OP_POP);
+                emit(OP_NIL);
+                break;
+        }
+    }
+
+    void Compiler::visit(Grouping *expr) {
+        compile(expr->expression);
+    }
+
+    void Compiler::visit(Ternary *expr) {
+        compile(expr->condition);
+        size_t else_jump = emit_jump(OP_JUMP_IF_FALSE);
+        emit(OP_POP);
+        compile(expr->left);
+        size_t end_jump = emit_jump(OP_JUMP);
+        patch_jump(else_jump);
+        emit(OP_POP);
+        compile(expr->right);
+        patch_jump(end_jump);
+    }
+
+    void Compiler::visit(Literal *expr) {
+        switch (expr->value.type()) {
+            case ValueType::NIL:
+                emit(OP_NIL);
+                break;
+            case ValueType::BOOL:
+                emit(expr->value.as_bool() ? OP_TRUE : OP_FALSE);
+                break;
+            default:
+                emit_constant(expr->value);
+                break;
+        }
+    }
+
+    void Compiler::visit(Unary *expr) {
+        compile(expr->right);
+        line = expr->oper.line;
+        switch (expr->oper.type) {
+            case MINUS:
+                emit(OP_NEGATE);
+                break;
+            case BANG:
+                emit(OP_NOT);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void Compiler::visit(Nothing *expr) {
+        emit(OP_NIL);
+    }
+
+    void Compiler::visit(Variable *expr) {
+        line = expr->name.line;
+        named_variable(expr->name.lexeme);
+    }
+
+    void Compiler::visit(Logical *expr) {
+        compile(expr->left);
+        size_t end_jump = emit_jump(expr->oper.type == OR ? OP_JUMP_IF_TRUE : OP_JUMP_IF_FALSE);
+        emit(OP_POP);
+        compile(expr->right);
+        patch_jump(end_jump);
+    }
+
+    void Compiler::visit(Assign *expr) {
+        compile(expr->value);
+        line = expr->name.line;
+        std::string_view name = expr->name.lexeme;
+        int arg = resolve_local(current, name);
+        if (arg != -1) {
+            emit(OP_SET_LOCAL, arg);
+        } else if ((arg = resolve_upvalue(current, name)) != -1) {
+            emit(OP_SET_UPVALUE, arg);
+        } else {
+            emit_short(OP_SET_GLOBAL, vm.global_slot(name));
+        }
+    }
+
+    void Compiler::visit(Call *expr) {
+        // method calls look the method up without binding it
+        // method calls are never tail calls, neither are the calls among the operands
+        bool tail = tail_call;
+        tail_call = false;
+        if (expr->callee->kind == ExprKind::Get) {
+            auto get = static_cast<Get *>(expr->callee);
+            compile(get->object);
+            for (auto argument: expr->arguments) {
+                compile(argument);
+            }
+            line = expr->paren.line;
+            emit_short(OP_INVOKE, add_cache(get->name));
+            emit((uint8_t) expr->arguments.size());
+            return;
+        }
+        if (expr->callee->kind == ExprKind::Super) {
+            auto super = static_cast<Super *>(expr->callee);
+            if (!check_super(super))
+                return;
+            named_variable("this");
+            for (auto argument: expr->arguments) {
+                compile(argument);
+            }
+            named_variable("super");
+            line = expr->paren.line;
+            emit_short(OP_SUPER_INVOKE, add_cache(super->method));
+            emit((uint8_t) expr->arguments.size());
+            return;
+        }
+        compile(expr->callee);
+        for (auto argument: expr->arguments) {
+            compile(argument);
+        }
+        line = expr->paren.line;
+        emit(tail ? OP_TAIL_CALL : OP_CALL, (uint8_t) expr->arguments.size());
+    }
+
+    void Compiler::visit(FunctionExpr *expr) {
+        compile_function(expr, "");
+    }
+
+    void Compiler::visit(Class *stmt) {
+        line = stmt->name.line;
+        std::string_view name = stmt->name.lexeme;
+        int name_constant = chunk().add_constant(Value(constant_string(std::string(name))));
+        if (name_constant > UINT16_MAX) {
+            compile_error(stmt->name, "Too many constants in one chunk.");
+        }
+        // declared like a function, the class is on the stack once it is defined
+        if (current->scope_depth == 0) {
+            emit_short(OP_CLASS, name_constant);
+            emit_short(OP_DEFINE_GLOBAL, vm.global_slot(name));
+        } else {
+            int existing = resolve_local(current, name);
+            emit_short(OP_CLASS, name_constant);
+            if (existing != -1 && current->locals[existing].depth == current->scope_depth) {
+                emit(OP_SET_LOCAL, existing);
+                emit(OP_POP);
+            } else {
+                add_local(name);
+            }
+        }
+        ClassState class_state{current_class, stmt->superclass != nullptr};
+        current_class = &class_state;
+        if (stmt->superclass) {
+            auto superclass = static_cast<Variable *>(stmt->superclass);
+            if (superclass->name.lexeme == name) {
+                compile_error(superclass->name, "A class can't inherit from itself.");
+            }
+            compile(superclass);
+            // the superclass stays on the stack as the local `super` the methods capture
+            begin_scope();
+            add_local("super");
+            named_variable(name);
+            line = superclass->name.line;
+            emit(OP_INHERIT);
+        }
+        named_variable(name);
+        for (auto method: stmt->methods) {
+            line = method->name.line;
+            bool initializer = method->name.lexeme == "init";
+            compile_function(method->fn_expr, method->name.lexeme,
+                             initializer ? FunctionType::INITIALIZER : FunctionType::METHOD);
+            int method_constant = chunk().add_constant(Value(constant_string(std::string(method->name.lexeme))));
+            if (method_constant > UINT16_MAX) {
+                compile_error(method->name, "Too many constants in one chunk.");
+            }
+            emit_short(OP_METHOD, method_constant);
+        }
+        emit(OP_POP);
+        if (stmt->superclass) {
+            end_scope();
+        }
+        current_class = class_state.enclosing;
+    }
+
+    void Compiler::visit(Get *expr) {
+        compile(expr->object);
+        line = expr->name.line;
+        emit_short(OP_GET_PROPERTY, add_cache(expr->name));
+    }
+
+    void Compiler::visit(Set *expr) {
+        compile(expr->object);
+        compile(expr->value);
+        line = expr->name.line;
+        emit_short(OP_SET_PROPERTY, add_cache(expr->name));
+    }
+
+    void Compiler::visit(This *expr) {
+        line = expr->keyword.line;
+        if (!current_class) {
+            compile_error(expr->keyword, "Can't use 'this' outside of a class.");
+            return;
+        }
+        named_variable("this");
+    }
+
+    bool Compiler::check_super(Super *expr) {
+        line = expr->keyword.line;
+        if (!current_class) {
+            compile_error(expr->keyword, "Can't use 'super' outside of a class.");
+            return false;
+        }
+        if (!current_class->has_superclass) {
+            compile_error(expr->keyword, "Can't use 'super' in a class with no superclass.");
+            return false;
+        }
+        return true;
+    }
+
+    void Compiler::visit(Super *expr) {
+        if (!check_super(expr))
+            return;
+        named_variable("this");
+        named_variable("super");
+        emit_short(OP_GET_SUPER, add_cache(expr->method));
+    }
+
+} // Lox
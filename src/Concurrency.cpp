@@ -0,0 +1,271 @@
+#include "Concurrency.h"
+#include <cmath>
+#include "Clock.h"
+#include "LoxFunction.h"
+
+namespace Lox {
+
+    bool Channel::send(Message message) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [&] { return closed || messages.size() < capacity; });
+        if (closed)
+            return false;
+        messages.push_back(std::move(message));
+        not_empty.notify_one();
+        return true;
+    }
+
+    std::optional<Message> Channel::receive() {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [&] { return closed || !messages.empty(); });
+        if (messages.empty())
+            return std::nullopt;
+        Message message = std::move(messages.front());
+        messages.pop_front();
+        not_full.notify_one();
+        return message;
+    }
+
+    void Channel::close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    Obj *LoxChannel::copy(ObjectCopier &copier) const {
+        return copier.target.heap.allocate<LoxChannel>(channel);
+    }
+
+    ObjectCopier::ObjectCopier(Interpreter &target) : target(target) {
+        // the copies are only reachable from each other until the copier hands them out
+        target.heap.pause_collection();
+    }
+
+    ObjectCopier::~ObjectCopier() {
+        target.heap.resume_collection();
+    }
+
+    Object ObjectCopier::copy(const Object &value) {
+        switch (value.type()) {
+            case ValueType::STRING: {
+                auto *string = static_cast<LoxString *>(value.as_heap_object());
+                if (string->permanent)
+                    return value;
+                return static_cast<LoxString *>(copy_obj(string));
+            }
+            case ValueType::CALLABLE:
+                return static_cast<Callable *>(copy_obj(value.as_callable()));
+            case ValueType::OBJ:
+                return copy_obj(value.as_obj());
+            default:
+                return value;
+        }
+    }
+
+    Obj *ObjectCopier::copy_obj(const Obj *object) {
+        if (!object)
+            return nullptr;
+        auto itr = copies.find(object);
+        if (itr != copies.end())
+            return itr->second;
+        Obj *copy = object->type == ObjType::STRING
+                    ? target.heap.make_string(static_cast<const LoxString *>(object)->chars)
+                    : object->copy(*this);
+        if (!copy)
+            throw NativeError{"Only values of the tree walking engines can be copied to another thread."};
+        copies[object] = copy;
+        return copy;
+    }
+
+    // the channel argument of a native, else a runtime error
+    static Channel &channel_of(const Object &value) {
+        if (!value.is_obj() || value.as_obj()->type != ObjType::CHANNEL)
+            throw NativeError{"Expected a channel."};
+        return *static_cast<LoxChannel *>(value.as_obj())->channel;
+    }
+
+    Object Spawn::call(Interpreter &interpreter, Arguments arguments) {
+        if (!arguments[0].is_callable() || arguments[0].as_callable()->arity() != 0)
+            throw NativeError{"Can only spawn functions without parameters."};
+        interpreter.spawn(arguments[0].as_callable());
+        return {};
+    }
+
+    Obj *Spawn::copy(ObjectCopier &copier) const {
+        return copier.target.heap.allocate<Spawn>();
+    }
+
+    Object MakeChannel::call(Interpreter &interpreter, Arguments arguments) {
+        const Object &capacity = arguments[0];
+        if (!capacity.is_number() || capacity.as_number() < 1 || capacity.as_number() != std::floor(capacity.as_number()))
+            throw NativeError{"Channel capacity must be a positive integer."};
+        auto channel = std::make_shared<Channel>((size_t) std::min(capacity.as_number(), 1e9));
+        return static_cast<Obj *>(interpreter.heap.allocate<LoxChannel>(std::move(channel)));
+    }
+
+    Obj *MakeChannel::copy(ObjectCopier &copier) const {
+        return copier.target.heap.allocate<MakeChannel>();
+    }
+
+    Object Send::call(Interpreter &interpreter, Arguments arguments) {
+        Channel &channel = channel_of(arguments[0]);
+        const Object &value = arguments[1];
+        Message message;
+        switch (value.type()) {
+            case ValueType::NIL:
+                break;
+            case ValueType::BOOL:
+                message = value.as_bool();
+                break;
+            case ValueType::NUMBER:
+                message = value.as_number();
+                break;
+            case ValueType::STRING:
+                message = value.as_string();
+                break;
+            default:
+                if (value.is_obj() && value.as_obj()->type == ObjType::CHANNEL) {
+                    message = static_cast<LoxChannel *>(value.as_obj())->channel;
+                    break;
+                }
+                throw NativeError{"Only nil, booleans, numbers, strings and channels can be sent."};
+        }
+        if (!channel.send(std::move(message)))
+            throw NativeError{"Send on a closed channel."};
+        return {};
+    }
+
+    Obj *Send::copy(ObjectCopier &copier) const {
+        return copier.target.heap.allocate<Send>();
+    }
+
+    Object Receive::call(Interpreter &interpreter, Arguments arguments) {
+        std::optional<Message> message = channel_of(arguments[0]).receive();
+        if (!message)
+            return {};
+        switch (message->index()) {
+            case 1:
+                return std::get<bool>(*message);
+            case 2:
+                return std::get<double>(*message);
+            case 3:
+                return interpreter.heap.make_string(std::move(std::get<std::string>(*message)));
+            case 4:
+                return static_cast<Obj *>(interpreter.heap.allocate<LoxChannel>(
+                        std::move(std::get<std::shared_ptr<Channel>>(*message))));
+            default:
+                return {};
+        }
+    }
+
+    Obj *Receive::copy(ObjectCopier &copier) const {
+        return copier.target.heap.allocate<Receive>();
+    }
+
+    Object Close::call(Interpreter &interpreter, Arguments arguments) {
+        channel_of(arguments[0]).close();
+        return {};
+    }
+
+    Obj *Close::copy(ObjectCopier &copier) const {
+        return copier.target.heap.allocate<Close>();
+    }
+
+    void Interpreter::define_natives() {
+        define_global("clock", static_cast<Callable *>(heap.allocate<Clock>()));
+        define_global("spawn", static_cast<Callable *>(heap.allocate<Spawn>()));
+        define_global("channel", static_cast<Callable *>(heap.allocate<MakeChannel>()));
+        define_global("send", static_cast<Callable *>(heap.allocate<Send>()));
+        define_global("receive", static_cast<Callable *>(heap.allocate<Receive>()));
+        define_global("close", static_cast<Callable *>(heap.allocate<Close>()));
+    }
+
+    Interpreter::~Interpreter() {
+        join_spawned();
+    }
+
+    void Interpreter::spawn(Callable *function) {
+        // a script spawning threads in a loop doesn't hold on to the heaps of those that have finished
+        reap_spawned();
+        if (!output_lock)
+            output_lock = std::make_shared<std::mutex>();
+        auto thread = std::make_unique<SpawnedThread>();
+        thread->interpreter = std::make_unique<Interpreter>(out);
+        Interpreter &child = *thread->interpreter;
+        child.output_lock = output_lock;
+        child.quickening = quickening;
+        child.iterative = iterative;
+        child.max_depth = max_depth;
+        Callable *copy;
+        {
+            ObjectCopier copier(child);
+            copier.remember(global, child.global);
+            // the same slots as here, so the copied functions' Feedback maps their globals the same way
+            child.global_slots = global_slots;
+            child.global_values.assign(global_values.size(), Object::uninitialized());
+            child.global_defined.assign(global_defined.size(), false);
+            for (size_t slot = 0; slot < global_values.size(); slot++) {
+                if (global_defined[slot]) {
+                    child.global_values[slot] = copier.copy(global_values[slot]);
+                    child.global_defined[slot] = true;
+                }
+            }
+            copy = copier.copy(function);
+            // rooted on the child's stack until it has been called
+            child.stack.push_back(copy);
+        }
+        SpawnedThread &spawned_thread = *thread;
+        spawned_thread.thread = std::thread([&child, copy, &spawned_thread] {
+            child.run_spawned(copy, spawned_thread);
+        });
+        spawned.push_back(std::move(thread));
+    }
+
+    void Interpreter::run_spawned(Callable *function, SpawnedThread &thread) {
+        // the parenthesis a stack overflow would be reported at, Spawn checked the arity
+        static const Token spawn_call(LEFT_PAREN, "(", 0);
+        try {
+            size_t base = stack.size() - 1;
+            if (iterative && typeid(*function) == typeid(LoxFunction)) {
+                size_t floor = tasks.size();
+                enter_function(static_cast<LoxFunction *>(function), spawn_call, base);
+                run_tasks(floor);
+            } else {
+                function->call(*this, arguments_at(base));
+            }
+        } catch (RuntimeException &error) {
+            thread.errors.push_back(error);
+        }
+        for (auto &error: join_spawned())
+            thread.errors.push_back(error);
+        thread.done.store(true, std::memory_order_release);
+    }
+
+    void Interpreter::reap_spawned() {
+        // the threads still running move to the front, in the order they were spawned
+        size_t running = 0;
+        for (size_t i = 0; i < spawned.size(); i++) {
+            SpawnedThread &thread = *spawned[i];
+            if (thread.done.load(std::memory_order_acquire)) {
+                thread.thread.join();
+                spawned_errors.insert(spawned_errors.end(), thread.errors.begin(), thread.errors.end());
+            } else {
+                std::swap(spawned[running++], spawned[i]);
+            }
+        }
+        spawned.resize(running);
+    }
+
+    std::vector<RuntimeException> Interpreter::join_spawned() {
+        std::vector<RuntimeException> errors = std::move(spawned_errors);
+        spawned_errors.clear();
+        for (auto &thread: spawned) {
+            thread->thread.join();
+            errors.insert(errors.end(), thread->errors.begin(), thread->errors.end());
+        }
+        spawned.clear();
+        return errors;
+    }
+
+} // Lox
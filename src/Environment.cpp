@@ -3,39 +3,27 @@
 //
 
 #include "Environment.h"
+#include "Concurrency.h"
 #include <iostream>
 #include "LoxExceptions.h"
 #include "token.h"
 
-void Lox::Environment::define(std::string name, Object value) {
-    values[name] = value;
+void Lox::Environment::undefined(const Token &name) {
+    throw RuntimeException(name, "Can't access undefined variable");
 }
 
-Lox::Object Lox::Environment::get(Token name) {
-//    std::cout << "ACCESSING " << name.lexeme << std::endl;
-
-    if (values.count(name.lexeme)) {
-        auto val = values.at(name.lexeme);
-        if (!val.has_value()) {
-            throw RuntimeException(name, "Can't access undefined variable");
-        }
-        return val;
-    }
-    if (enclosing)
-        return enclosing->get(name);
-    throw RuntimeException(name,
-                           "Undefined variable '" + name.lexeme + "'.");
-}
-
-void Lox::Environment::assign(Token name, Object value) {
-    if (values.count(name.lexeme)) {
-        values[name.lexeme] = value;
-        return;
-    }
-    if (enclosing)enclosing->assign(name, value);
-    else throw RuntimeException(name, "Undefined variable " + name.lexeme + ".");
+void Lox::Environment::trace(Heap &heap) {
+    heap.mark_object(enclosing);
+    for (auto &value: values)
+        heap.mark_value(value);
 }
 
-Lox::Environment::~Environment() {
-    if (enclosing)delete enclosing;
+Lox::Obj *Lox::Environment::copy(ObjectCopier &copier) const {
+    auto *env = copier.target.heap.allocate<Environment>();
+    copier.remember(this, env);
+    env->enclosing = copier.copy(enclosing);
+    env->values.reserve(values.size());
+    for (auto &value: values)
+        env->values.push_back(copier.copy(value));
+    return env;
 }
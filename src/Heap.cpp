@@ -0,0 +1,123 @@
+#include "Heap.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include "Callable.h"
+#include "Value.h"
+
+namespace Lox {
+
+    Obj *Value::as_heap_object() const {
+        switch (type_) {
+            case ValueType::STRING:
+                return as.string;
+            case ValueType::CALLABLE:
+                return as.callable;
+            case ValueType::OBJ:
+                return as.obj;
+            default:
+                return nullptr;
+        }
+    }
+
+    Heap::~Heap() {
+        while (objects) {
+            Obj *next = objects->next;
+            delete objects;
+            objects = next;
+        }
+    }
+
+    void Heap::link(Obj *object) {
+        object->gc_size = (uint32_t) object->size();
+        object->next = objects;
+        objects = object;
+        heap_stats.bytes_allocated += object->gc_size;
+        heap_stats.peak_bytes_allocated = std::max(heap_stats.peak_bytes_allocated, heap_stats.bytes_allocated);
+        heap_stats.objects++;
+    }
+
+    LoxString *Heap::make_string(std::string chars) {
+        return allocate<LoxString>(std::move(chars));
+    }
+
+    void Heap::mark_object(Obj *object) {
+        if (!object || object->marked || object->permanent)
+            return;
+        object->marked = true;
+        // strings have no references, no need to revisit them
+        if (object->type != ObjType::STRING)
+            gray_stack.push_back(object);
+    }
+
+    void Heap::mark_value(const Value &value) {
+        if (value.is_heap_object())
+            mark_object(value.as_heap_object());
+    }
+
+    void Heap::trace_references() {
+        while (!gray_stack.empty()) {
+            Obj *object = gray_stack.back();
+            gray_stack.pop_back();
+            object->trace(*this);
+        }
+    }
+
+    void Heap::sweep() {
+        Obj **link = &objects;
+        while (*link) {
+            Obj *object = *link;
+            if (object->marked) {
+                object->marked = false;
+                link = &object->next;
+                continue;
+            }
+            *link = object->next;
+            heap_stats.bytes_allocated -= object->gc_size;
+            heap_stats.bytes_freed += object->gc_size;
+            heap_stats.objects--;
+            heap_stats.objects_freed++;
+            delete object;
+        }
+    }
+
+    void Heap::collect() {
+        auto start = std::chrono::steady_clock::now();
+
+        roots.mark_roots(*this);
+        trace_references();
+        sweep();
+        next_gc = std::max(min_threshold, (size_t) ((double) heap_stats.bytes_allocated * growth_factor));
+
+        double pause = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        heap_stats.collections++;
+        heap_stats.total_pause_ms += pause;
+        heap_stats.max_pause_ms = std::max(heap_stats.max_pause_ms, pause);
+    }
+
+    std::string Heap::stats_report() const {
+        std::ostringstream out;
+        out << "heap: " << heap_stats.bytes_allocated << " bytes in " << heap_stats.objects << " objects, peak "
+            << heap_stats.peak_bytes_allocated << " bytes\n";
+        out << "gc: " << heap_stats.collections << " collections freed " << heap_stats.objects_freed
+            << " objects (" << heap_stats.bytes_freed << " bytes), pause total " << heap_stats.total_pause_ms
+            << " ms, max " << heap_stats.max_pause_ms << " ms\n";
+        return out.str();
+    }
+
+    LoxString *constant_string(const std::string &chars) {
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::unique_ptr<LoxString>> constants;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &constant = constants[chars];
+        if (!constant) {
+            constant = std::make_unique<LoxString>(chars);
+            constant->permanent = true;
+        }
+        return constant.get();
+    }
+
+} // Lox
@@ -0,0 +1,162 @@
+#include "Isolate.h"
+#include "ClosureCompiler.h"
+#include "Optimizer.h"
+#include "ProgramCache.h"
+#include "Resolver.h"
+#include "VM.h"
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+
+namespace Lox {
+
+    static thread_local Isolate *running = nullptr;
+
+    // makes an isolate the current one of its thread for the duration of a run, runs may nest through the REPL
+    class CurrentIsolate {
+        Isolate *previous;
+    public:
+        explicit CurrentIsolate(Isolate *isolate) : previous(running) { running = isolate; }
+
+        ~CurrentIsolate() { running = previous; }
+    };
+
+    Isolate::Isolate(std::ostream &out, std::ostream &err) : out(out), err(err),
+                                                             interpreter(std::make_unique<Interpreter>(out)) {}
+
+    Isolate::~Isolate() = default;
+
+    Isolate *Isolate::current() {
+        return running;
+    }
+
+    void Isolate::set_engine(Engine engine_) {
+        engine = engine_;
+        if (engine == Engine::VM && !vm)
+            vm = std::make_unique<VM>(out);
+    }
+
+    void Isolate::set_max_depth(size_t depth) {
+        interpreter->set_max_depth(depth);
+    }
+
+    void Isolate::set_optimization_level(int level) {
+        optimization_level = level;
+    }
+
+    void Isolate::reset() {
+        interpreter->reset_globals();
+        if (vm)
+            vm->reset_globals();
+        programs.clear();
+        closure_code.clear();
+        closure_arena = std::make_unique<Arena>();
+    }
+
+    const HeapStats &Isolate::heap_stats() const {
+        return engine == Engine::VM ? vm->heap.stats() : interpreter->heap.stats();
+    }
+
+    std::string Isolate::heap_stats_report() const {
+        return engine == Engine::VM ? vm->heap.stats_report() : interpreter->heap.stats_report();
+    }
+
+    std::shared_ptr<const Program> Isolate::compile(Source source, const ProgramCache *program_cache) {
+        auto program = std::make_shared<Program>();
+        program->source = std::move(source);
+        if (!program_cache || !program_cache->load(*program)) {
+            Scanner scanner(program->source.view());
+            Parser parser(scanner, *program);
+            parser.parseTokens();
+            if (program_cache && !had_error)
+                program_cache->store(*program);
+        }
+        if (had_error)
+            return nullptr;
+        Resolver().resolve_program(*program);
+        if (had_error)
+            return nullptr;
+        if (optimization_level > 0)
+            Optimizer(*program).optimize_program();
+        if (engine == Engine::CLOSURES) {
+            program->closure_code = ClosureCompiler(*program).compile_program(*program);
+            program->has_closure_code = true;
+        }
+        return program;
+    }
+
+    std::shared_ptr<const Program> Isolate::compile(Source source) {
+        CurrentIsolate current(this);
+        had_error = had_runtime_error = false;
+        return compile(std::move(source), nullptr);
+    }
+
+    void Isolate::execute(const Program &program, bool print_expressions) {
+        if (engine == Engine::VM) {
+            vm->interpret(program, print_expressions);
+            return;
+        }
+        interpreter->set_quickening(optimization_level >= 2);
+        interpreter->set_iterative(engine == Engine::STACK);
+        if (engine == Engine::CLOSURES) {
+            NodeList<const CompiledStmt *> code = program.closure_code;
+            if (!program.has_closure_code) {
+                auto itr = closure_code.find(program.id);
+                if (itr == closure_code.end())
+                    itr = closure_code.emplace(program.id, ClosureCompiler(*closure_arena).compile_program(program)).first;
+                code = itr->second;
+            }
+            ClosureCompiler::run(*interpreter, program, code, print_expressions);
+        } else {
+            interpreter->interpret(program, print_expressions);
+        }
+        // a script isn't done before the threads it spawned are, their errors are its own
+        for (auto &error: interpreter->join_spawned())
+            runtime_error(error);
+    }
+
+    Isolate::Status Isolate::status() const {
+        if (had_error)
+            return Status::COMPILE_ERROR;
+        return had_runtime_error ? Status::RUNTIME_ERROR : Status::OK;
+    }
+
+    Isolate::Status Isolate::run(const std::shared_ptr<const Program> &program, bool print_expressions) {
+        CurrentIsolate current(this);
+        had_error = had_runtime_error = false;
+        programs.emplace(program->id, program);
+        execute(*program, print_expressions);
+        return status();
+    }
+
+    Isolate::Status Isolate::run(Source source, bool print_expressions) {
+        std::shared_ptr<const Program> program = compile(std::move(source));
+        return program ? run(program, print_expressions) : Status::COMPILE_ERROR;
+    }
+
+    Isolate::Status Isolate::run_file(const std::string &path) {
+        std::optional<Source> source = path == "-" ? Source::from_file(path) : Source::open(path);
+        if (!source) {
+            err << "Cannot open input file " << path << std::endl;
+            return Status::NO_INPUT;
+        }
+        std::shared_ptr<const Program> program;
+        {
+            CurrentIsolate current(this);
+            had_error = had_runtime_error = false;
+            program = compile(std::move(*source), cache);
+        }
+        return program ? run(program) : Status::COMPILE_ERROR;
+    }
+
+    void Isolate::report(int line, const std::string &where, const std::string &message) {
+        err << "[line " << line << "] Error" << where << ": " << message << std::endl;
+        had_error = true;
+    }
+
+    void Isolate::runtime_error(RuntimeException &e) {
+        err << e.what() << "\n[line " << e.token.line << "]\n";
+        had_runtime_error = true;
+    }
+
+} // Lox
@@ -0,0 +1,574 @@
+#include <iostream>
+#include <stdexcept>
+#include <typeinfo>
+#include "interpreter.h"
+#include "LoxExceptions.h"
+#include "LoxFunction.h"
+#include "LoxClass.h"
+#include "utils.h"
+
+// Iterative evaluation for the Interpreter. Nodes are dispatched on their kind, operands live on `stack` and what is
+// left to do after a child finishes is a Task on `tasks`, so the native stack stays flat however deep the
+// expressions and calls nest. Break and return pop tasks up to the loop or call they leave.
+namespace Lox {
+
+    Object Interpreter::evaluate_iteratively(Expr *expr) {
+        size_t floor = tasks.size();
+        descend(expr);
+        run_tasks(floor);
+        Object value = stack.back();
+        stack.pop_back();
+        return value;
+    }
+
+    void Interpreter::execute_iteratively(Stmt *stmt) {
+        size_t floor = tasks.size();
+        exec(stmt);
+        run_tasks(floor);
+    }
+
+    void Interpreter::run_tasks(size_t floor) {
+        while (tasks.size() > floor) {
+            Task task = tasks.back();
+            tasks.pop_back();
+            switch (task.op) {
+                case Task::EVAL:
+                    descend(static_cast<Expr *>(task.node));
+                    break;
+                case Task::BINARY_RIGHT: {
+                    auto binary = static_cast<Binary *>(task.node);
+                    if (push_leaf(binary->right)) {
+                        apply_binary(binary);
+                    } else {
+                        tasks.push_back({Task::BINARY, 0, binary});
+                        descend(binary->right);
+                    }
+                    break;
+                }
+                case Task::BINARY:
+                    apply_binary(static_cast<Binary *>(task.node));
+                    break;
+                case Task::UNARY: {
+                    auto unary = static_cast<Unary *>(task.node);
+                    Object &right = stack.back();
+                    if (unary->oper.type == MINUS) {
+                        check_number_operand(unary->oper, right);
+                        right = -right.as_number();
+                    } else {
+                        right = !isTruthy(right);
+                    }
+                    break;
+                }
+                case Task::LOGICAL: {
+                    auto logical = static_cast<Logical *>(task.node);
+                    // `or` keeps a truthy left operand and `and` a falsy one
+                    if (isTruthy(stack.back()) != (logical->oper.type == OR)) {
+                        stack.pop_back();
+                        descend(logical->right);
+                    }
+                    break;
+                }
+                case Task::TERNARY: {
+                    auto ternary = static_cast<Ternary *>(task.node);
+                    bool condition = isTruthy(stack.back());
+                    stack.pop_back();
+                    descend(condition ? ternary->left : ternary->right);
+                    break;
+                }
+                case Task::ASSIGN: {
+                    auto assignment = static_cast<Assign *>(task.node);
+                    if (assignment->slot.is_global())
+                        assign(assignment->name, assignment->slot, stack.back());
+                    else
+                        environment->assign(assignment->slot.depth, assignment->slot.index, stack.back());
+                    // count is set for an assignment statement, whose value isn't used
+                    if (task.count)
+                        stack.pop_back();
+                    break;
+                }
+                case Task::CALL:
+                    enter_call(static_cast<Call *>(task.node), task.count);
+                    break;
+                case Task::INVOKE:
+                    enter_invoke(static_cast<Call *>(task.node), task.count);
+                    break;
+                case Task::GET: {
+                    auto get = static_cast<Get *>(task.node);
+                    // the object stays on the stack while a bound method is allocated
+                    Object result = LoxInstance::receiver(stack.back(), get->name)->get(heap, get->name, feedback->caches[get->cache]);
+                    stack.back() = result;
+                    break;
+                }
+                case Task::SET: {
+                    auto set = static_cast<Set *>(task.node);
+                    Object result = stack.back();
+                    stack.pop_back();
+                    LoxInstance::target(stack.back(), set->name)->set(set->name, feedback->caches[set->cache], result);
+                    stack.back() = result;
+                    break;
+                }
+                case Task::EXEC:
+                    exec(static_cast<Stmt *>(task.node));
+                    break;
+                case Task::POP:
+                    stack.pop_back();
+                    break;
+                case Task::PRINT:
+                    print(stack.back());
+                    stack.pop_back();
+                    break;
+                case Task::DEFINE:
+                    define(static_cast<Var *>(task.node)->slot, stack.back());
+                    stack.pop_back();
+                    break;
+                case Task::IF:
+                    branch(static_cast<If *>(task.node));
+                    break;
+                case Task::LOOP:
+                    loop(static_cast<While *>(task.node));
+                    break;
+                case Task::LOOP_TEST:
+                    loop_test(static_cast<While *>(task.node));
+                    break;
+                case Task::BLOCK_EXIT:
+                    leave_block(static_cast<Block *>(task.node));
+                    break;
+                case Task::RETURN:
+                    // the value stays on the stack as the result of the call
+                    unwind(Task::FRAME);
+                    break;
+                case Task::TAIL_CALL:
+                    tail_call(static_cast<Call *>(task.node));
+                    break;
+                case Task::TAIL_BRANCH:
+                    tail_branch(static_cast<Ternary *>(task.node));
+                    break;
+                case Task::FRAME:
+                    // the body ran to its end
+                    stack.emplace_back();
+                    leave_call(static_cast<FunctionExpr *>(task.node), task.count);
+                    break;
+            }
+        }
+    }
+
+    void Interpreter::descend(Expr *expr) {
+        while (true) {
+            switch (expr->kind) {
+                case ExprKind::Literal:
+                case ExprKind::Variable:
+                case ExprKind::This:
+                    push_leaf(expr);
+                    return;
+                case ExprKind::Grouping:
+                    expr = static_cast<Grouping *>(expr)->expression;
+                    break;
+                case ExprKind::Binary: {
+                    auto binary = static_cast<Binary *>(expr);
+                    if (!push_leaf(binary->left)) {
+                        tasks.push_back({Task::BINARY_RIGHT, 0, binary});
+                        expr = binary->left;
+                        break;
+                    }
+                    if (push_leaf(binary->right)) {
+                        apply_binary(binary);
+                        return;
+                    }
+                    tasks.push_back({Task::BINARY, 0, binary});
+                    expr = binary->right;
+                    break;
+                }
+                case ExprKind::Unary: {
+                    auto unary = static_cast<Unary *>(expr);
+                    tasks.push_back({Task::UNARY, 0, unary});
+                    expr = unary->right;
+                    break;
+                }
+                case ExprKind::Logical: {
+                    auto logical = static_cast<Logical *>(expr);
+                    tasks.push_back({Task::LOGICAL, 0, logical});
+                    expr = logical->left;
+                    break;
+                }
+                case ExprKind::Ternary: {
+                    auto ternary = static_cast<Ternary *>(expr);
+                    tasks.push_back({Task::TERNARY, 0, ternary});
+                    expr = ternary->condition;
+                    break;
+                }
+                case ExprKind::Assign: {
+                    auto assignment = static_cast<Assign *>(expr);
+                    tasks.push_back({Task::ASSIGN, 0, assignment});
+                    expr = assignment->value;
+                    break;
+                }
+                case ExprKind::Call: {
+                    auto call = static_cast<Call *>(expr);
+                    uint32_t count = call->arguments.size();
+                    if (call->callee->kind == ExprKind::Get) {
+                        // a method call, the method is looked up once the arguments are ready
+                        Expr *object = static_cast<Get *>(call->callee)->object;
+                        if (!push_call_operands(call, object, {Task::INVOKE, count, call}))
+                            enter_invoke(call, count);
+                        return;
+                    }
+                    if (!push_call_operands(call, call->callee, {Task::CALL, count, call}))
+                        enter_call(call, count);
+                    return;
+                }
+                case ExprKind::Get: {
+                    auto get = static_cast<Get *>(expr);
+                    tasks.push_back({Task::GET, 0, get});
+                    expr = get->object;
+                    break;
+                }
+                case ExprKind::Set: {
+                    auto set = static_cast<Set *>(expr);
+                    tasks.push_back({Task::SET, 0, set});
+                    tasks.push_back({Task::EVAL, 0, set->value});
+                    expr = set->object;
+                    break;
+                }
+                case ExprKind::Super:
+                    stack.push_back(bind_super(static_cast<Super *>(expr)));
+                    return;
+                case ExprKind::FunctionExpr: {
+                    Callable *fn = heap.allocate<LoxFunction>(static_cast<FunctionExpr *>(expr), environment, feedback);
+                    stack.push_back(fn);
+                    return;
+                }
+                case ExprKind::Nothing:
+                    throw std::runtime_error("Runtime error");
+            }
+        }
+    }
+
+    void Interpreter::exec(Stmt *stmt) {
+        switch (stmt->kind) {
+            case StmtKind::Expression: {
+                Expr *expression = static_cast<Expression *>(stmt)->expression;
+                if (expression->kind == ExprKind::Assign) {
+                    tasks.push_back({Task::ASSIGN, 1, expression});
+                    descend(static_cast<Assign *>(expression)->value);
+                    break;
+                }
+                tasks.push_back({Task::POP, 0, nullptr});
+                descend(expression);
+                break;
+            }
+            case StmtKind::Print:
+                tasks.push_back({Task::PRINT, 0, nullptr});
+                descend(static_cast<Print *>(stmt)->expression);
+                break;
+            case StmtKind::Var: {
+                auto var = static_cast<Var *>(stmt);
+                if (!var->initializer) {
+                    define(var->slot, Object::uninitialized());
+                    break;
+                }
+                tasks.push_back({Task::DEFINE, 0, var});
+                descend(var->initializer);
+                break;
+            }
+            case StmtKind::Block: {
+                auto block = static_cast<Block *>(stmt);
+                if (block->num_slots > 0) {
+                    Environment *env = new_environment(environment, block->num_slots);
+                    environments.push_back(environment);
+                    environment = env;
+                    tasks.push_back({Task::BLOCK_EXIT, 0, block});
+                }
+                push_statements(block->statements);
+                break;
+            }
+            case StmtKind::If: {
+                auto stmt_if = static_cast<If *>(stmt);
+                tasks.push_back({Task::IF, 0, stmt_if});
+                descend(stmt_if->condition);
+                if (tasks.back().node == stmt_if) {
+                    // the condition is already on the stack
+                    tasks.pop_back();
+                    branch(stmt_if);
+                }
+                break;
+            }
+            case StmtKind::While:
+                loop(static_cast<While *>(stmt));
+                break;
+            case StmtKind::Break:
+                unwind(Task::LOOP);
+                break;
+            case StmtKind::Return: {
+                auto ret = static_cast<class Return *>(stmt);
+                if (ret->value) {
+                    return_value_of(ret->value);
+                } else {
+                    stack.emplace_back();
+                    unwind(Task::FRAME);
+                }
+                break;
+            }
+            case StmtKind::Function: {
+                auto function = static_cast<Function *>(stmt);
+                Callable *fn = heap.allocate<LoxFunction>(function->name, function->fn_expr, environment, feedback);
+                define(function->slot, fn);
+                break;
+            }
+            case StmtKind::Class: {
+                auto klass = static_cast<Class *>(stmt);
+                Object superclass;
+                if (klass->superclass) {
+                    push_leaf(klass->superclass);
+                    superclass = stack.back();
+                    stack.pop_back();
+                }
+                define_class(klass, superclass);
+                break;
+            }
+        }
+    }
+
+    bool Interpreter::push_leaf(Expr *expr) {
+        if (expr->kind == ExprKind::Literal) {
+            stack.push_back(static_cast<Literal *>(expr)->value);
+            return true;
+        }
+        if (expr->kind == ExprKind::Variable) {
+            auto variable = static_cast<Variable *>(expr);
+            if (variable->slot.is_global())
+                stack.push_back(lookup(variable->name, variable->slot));
+            else
+                stack.push_back(environment->get(variable->name, variable->slot.depth, variable->slot.index));
+            return true;
+        }
+        if (expr->kind == ExprKind::This) {
+            auto self = static_cast<This *>(expr);
+            stack.push_back(environment->get(self->keyword, self->slot.depth, self->slot.index));
+            return true;
+        }
+        return false;
+    }
+
+    void Interpreter::apply_binary(Binary *binary) {
+        size_t top = stack.size();
+        Object &left = stack[top - 2], &right = stack[top - 1];
+        if (left.is_number() && right.is_number()) {
+            double a = left.as_number(), b = right.as_number();
+            switch (binary->oper.type) {
+                case PLUS: left = a + b; stack.pop_back(); return;
+                case MINUS: left = a - b; stack.pop_back(); return;
+                case STAR: left = a * b; stack.pop_back(); return;
+                case LESS: left = a < b; stack.pop_back(); return;
+                case LESS_EQUAL: left = a <= b; stack.pop_back(); return;
+                case GREATER: left = a > b; stack.pop_back(); return;
+                case GREATER_EQUAL: left = a >= b; stack.pop_back(); return;
+                default: break;
+            }
+        }
+        // both operands stay on the stack while a concatenation allocates
+        Object result = binary_operation(binary->oper, left, right);
+        stack.pop_back();
+        stack.back() = result;
+    }
+
+    bool Interpreter::push_call_operands(Call *call, Expr *first, Task then) {
+        uint32_t count = call->arguments.size(), ready = 0;
+        Expr *next = first;
+        if (push_leaf(first)) {
+            while (ready < count && push_leaf(call->arguments[ready]))
+                ready++;
+            if (ready == count)
+                return false;
+            next = call->arguments[ready++];
+        }
+        tasks.push_back(then);
+        for (uint32_t i = count; i-- > ready;)
+            tasks.push_back({Task::EVAL, 0, call->arguments[i]});
+        descend(next);
+        return true;
+    }
+
+    void Interpreter::tail_call(Call *call) {
+        // the callee and arguments are on the stack, the frame they replace is left first
+        unwind(Task::FRAME);
+        enter_call(call, call->arguments.size());
+    }
+
+    void Interpreter::return_value_of(Expr *value) {
+        if (value->kind == ExprKind::Ternary) {
+            auto ternary = static_cast<Ternary *>(value);
+            tasks.push_back({Task::TAIL_BRANCH, 0, ternary});
+            descend(ternary->condition);
+            if (tasks.back().op == Task::TAIL_BRANCH && tasks.back().node == ternary) {
+                // the condition is already on the stack
+                tasks.pop_back();
+                tail_branch(ternary);
+            }
+        } else if (value->kind == ExprKind::Call) {
+            auto call = static_cast<Call *>(value);
+            if (!push_call_operands(call, call->callee, {Task::TAIL_CALL, 0, call}))
+                tail_call(call);
+        } else {
+            tasks.push_back({Task::RETURN, 0, value});
+            descend(value);
+        }
+    }
+
+    void Interpreter::tail_branch(Ternary *ternary) {
+        bool condition = isTruthy(stack.back());
+        stack.pop_back();
+        return_value_of(condition ? ternary->left : ternary->right);
+    }
+
+    void Interpreter::push_statements(NodeList<Stmt *> statements) {
+        if (statements.empty())
+            return;
+        for (uint32_t i = statements.size(); --i > 0;)
+            tasks.push_back({Task::EXEC, 0, statements[i]});
+        // nests only as deep as the blocks in the source
+        exec(statements[0]);
+    }
+
+    void Interpreter::branch(If *stmt) {
+        bool condition = isTruthy(stack.back());
+        stack.pop_back();
+        if (condition)
+            exec(stmt->then_branch);
+        else if (stmt->else_branch)
+            exec(stmt->else_branch);
+    }
+
+    void Interpreter::loop(While *stmt) {
+        // the Optimizer drops conditions that are always true
+        if (!stmt->condition) {
+            tasks.push_back({Task::LOOP, 0, stmt});
+            exec(stmt->body);
+            return;
+        }
+        tasks.push_back({Task::LOOP_TEST, 0, stmt});
+        descend(stmt->condition);
+        if (tasks.back().node == stmt) {
+            tasks.pop_back();
+            loop_test(stmt);
+        }
+    }
+
+    void Interpreter::loop_test(While *stmt) {
+        bool condition = isTruthy(stack.back());
+        stack.pop_back();
+        if (condition) {
+            tasks.push_back({Task::LOOP, 0, stmt});
+            exec(stmt->body);
+        }
+    }
+
+    void Interpreter::enter_call(Call *expr, size_t arg_count) {
+        size_t base = stack.size() - arg_count - 1;
+        check_call(expr->paren, base);
+        Callable *callee = callee_at(base);
+        if (typeid(*callee) == typeid(LoxFunction)) {
+            enter_function(static_cast<LoxFunction *>(callee), expr->paren, base);
+            return;
+        }
+        if (typeid(*callee) == typeid(BoundMethod)) {
+            auto bound = static_cast<BoundMethod *>(callee);
+            if (typeid(*bound->method) == typeid(LoxFunction)) {
+                // the receiver's class keeps the method alive
+                stack[base] = bound->receiver;
+                enter_function(static_cast<LoxFunction *>(bound->method), expr->paren, base);
+                return;
+            }
+        }
+        if (typeid(*callee) == typeid(LoxClass)) {
+            auto klass = static_cast<LoxClass *>(callee);
+            Callable *init = klass->init();
+            if (!init || typeid(*init) == typeid(LoxFunction)) {
+                // the instance takes the place of its class, which it references
+                stack[base] = static_cast<Obj *>(heap.allocate<LoxInstance>(klass));
+                if (init)
+                    enter_function(static_cast<LoxFunction *>(init), expr->paren, base);
+                return;
+            }
+        }
+        Object result = call_at(expr->paren, callee, *this, arguments_at(base));
+        stack.resize(base);
+        stack.push_back(result);
+    }
+
+    void Interpreter::enter_invoke(Call *expr, size_t arg_count) {
+        size_t base = stack.size() - arg_count - 1;
+        auto get = static_cast<Get *>(expr->callee);
+        Object field;
+        Callable *method = LoxInstance::receiver(stack[base], get->name)->method(get->name, feedback->caches[get->cache], field);
+        if (!method) {
+            stack[base] = field;
+            enter_call(expr, arg_count);
+            return;
+        }
+        check_arity(expr->paren, method, arg_count);
+        if (typeid(*method) == typeid(LoxFunction)) {
+            enter_function(static_cast<LoxFunction *>(method), expr->paren, base);
+            return;
+        }
+        Object result = method->call_method(*this, stack[base], arguments_at(base));
+        stack.resize(base);
+        stack.push_back(result);
+    }
+
+    void Interpreter::enter_function(LoxFunction *function, const Token &paren, size_t base) {
+        if (depth >= max_depth)
+            throw RuntimeException(paren, "Stack overflow.");
+        FunctionExpr *definition = function->definition();
+        FunctionKind kind = function->function_kind();
+        // the arguments, and the receiver of a method, stay rooted on the stack until they are bound
+        Environment *env = new_environment(function->enclosing(), definition->num_slots);
+        size_t first = 0;
+        if (kind != FunctionKind::FUNCTION) {
+            env->define(0, stack[base]);
+            first = 1;
+        }
+        for (size_t i = base + 1; i < stack.size(); i++)
+            env->define((int) (i - base - 1 + first), stack[i]);
+        stack.resize(base);
+        environments.push_back(environment);
+        environment = env;
+        saved_feedback.push_back(feedback);
+        feedback = function->feedback();
+        depth++;
+        tasks.push_back({Task::FRAME, kind == FunctionKind::INITIALIZER, definition});
+        push_statements(definition->body);
+    }
+
+    void Interpreter::leave_call(FunctionExpr *function, bool initializer) {
+        if (initializer)
+            stack.back() = environment->at(0);
+        if (!function->captured)
+            release_environment(environment);
+        environment = environments.back();
+        environments.pop_back();
+        feedback = saved_feedback.back();
+        saved_feedback.pop_back();
+        depth--;
+    }
+
+    void Interpreter::leave_block(Block *block) {
+        if (!block->captured)
+            release_environment(environment);
+        environment = environments.back();
+        environments.pop_back();
+    }
+
+    void Interpreter::unwind(Task::Op op) {
+        while (true) {
+            Task task = tasks.back();
+            tasks.pop_back();
+            if (task.op == Task::BLOCK_EXIT)
+                leave_block(static_cast<Block *>(task.node));
+            else if (task.op == Task::FRAME)
+                leave_call(static_cast<FunctionExpr *>(task.node), task.count);
+            if (task.op == op)
+                return;
+        }
+    }
+
+} // Lox
@@ -0,0 +1,143 @@
+#include "LoxClass.h"
+#include <algorithm>
+#include "LoxExceptions.h"
+#include "Concurrency.h"
+
+namespace Lox {
+
+    LoxClass::LoxClass(std::string name, LoxClass *superclass) : name(std::move(name)), superclass(superclass) {
+        if (superclass) {
+            methods = superclass->methods;
+            initializer = superclass->initializer;
+            field_hint = superclass->field_hint;
+        }
+    }
+
+    LoxClass *LoxClass::superclass_of(const Object &value, const Token &name) {
+        auto klass = value.is_callable() ? dynamic_cast<LoxClass *>(value.as_callable()) : nullptr;
+        if (!klass)
+            throw RuntimeException(name, "Superclass must be a class.");
+        return klass;
+    }
+
+    void LoxClass::add_method(LoxString *method_name, Callable *method) {
+        methods[method_name] = method;
+        if (method_name->chars == "init")
+            initializer = method;
+    }
+
+    Callable *LoxClass::super_method(const Token &method_name, PropertyCache &cache) {
+        // entries have no shape, the method only depends on the class
+        if (const PropertyCache::Entry *hit = cache.find(nullptr, id))
+            return static_cast<Callable *>(hit->method);
+        if (!cache.name)
+            cache.name = constant_string(std::string(method_name.lexeme));
+        Callable *method = find_method(cache.name);
+        if (!method)
+            throw RuntimeException(method_name, "Undefined property '" + std::string(method_name.lexeme) + "'.");
+        if (!cache.megamorphic)
+            cache.remember({nullptr, nullptr, id, method, 0});
+        return method;
+    }
+
+    Object LoxClass::call(Interpreter &interpreter, Arguments arguments) {
+        Object instance = static_cast<Obj *>(interpreter.heap.allocate<LoxInstance>(this));
+        if (!initializer)
+            return instance;
+        return initializer->call_method(interpreter, instance, arguments);
+    }
+
+    void LoxClass::trace(Heap &heap) {
+        heap.mark_object(superclass);
+        for (auto &method: methods)
+            heap.mark_object(method.second);
+    }
+
+    Obj *LoxClass::copy(ObjectCopier &copier) const {
+        auto *klass = copier.target.heap.allocate<LoxClass>(name, copier.copy(superclass));
+        copier.remember(this, klass);
+        klass->field_hint = field_hint;
+        // method names are constants shared by every heap
+        for (auto &[method_name, method]: methods)
+            klass->add_method(method_name, copier.copy(method));
+        return klass;
+    }
+
+    bool LoxInstance::resolve_miss(const Token &name, PropertyCache &cache, PropertyCache::Entry &entry) {
+        if (!cache.name)
+            cache.name = constant_string(std::string(name.lexeme));
+        // a field shadows a method of the same name
+        const Shape *shape = fields.shape;
+        int slot = shape->find(cache.name);
+        if (slot >= 0) {
+            entry = {shape, shape, 0, nullptr, (uint32_t) slot};
+        } else if (Callable *method = klass->find_method(cache.name)) {
+            entry = {shape, shape, klass->id, method, 0};
+        } else {
+            return false;
+        }
+        if (!cache.megamorphic)
+            cache.remember(entry);
+        return true;
+    }
+
+    void LoxInstance::undefined(const Token &name) {
+        throw RuntimeException(name, "Undefined property '" + std::string(name.lexeme) + "'.");
+    }
+
+    LoxInstance *LoxInstance::receiver(const Object &value, const Token &name) {
+        if (!value.is_obj() || value.as_obj()->type != ObjType::INSTANCE)
+            throw RuntimeException(name, "Only instances have properties.");
+        return static_cast<LoxInstance *>(value.as_obj());
+    }
+
+    LoxInstance *LoxInstance::target(const Object &value, const Token &name) {
+        if (!value.is_obj() || value.as_obj()->type != ObjType::INSTANCE)
+            throw RuntimeException(name, "Only instances have fields.");
+        return static_cast<LoxInstance *>(value.as_obj());
+    }
+
+    Object LoxInstance::get(Heap &heap, const Token &name, PropertyCache &cache) {
+        PropertyCache::Entry entry{};
+        if (!resolve(name, cache, entry))
+            undefined(name);
+        if (!entry.method)
+            return fields.values[entry.slot];
+        Callable *bound = heap.allocate<BoundMethod>(static_cast<Obj *>(this), static_cast<Callable *>(entry.method));
+        return bound;
+    }
+
+    void LoxInstance::set(const Token &name, PropertyCache &cache, Object value) {
+        if (!cache.name)
+            cache.name = constant_string(std::string(name.lexeme));
+        if (fields.set(cache, value))
+            klass->field_hint = std::max(klass->field_hint, fields.shape->field_count());
+    }
+
+    void LoxInstance::trace(Heap &heap) {
+        heap.mark_object(klass);
+        for (auto &field: fields.values)
+            heap.mark_value(field);
+    }
+
+    Obj *LoxInstance::copy(ObjectCopier &copier) const {
+        auto *instance = copier.target.heap.allocate<LoxInstance>(copier.copy(klass));
+        copier.remember(this, instance);
+        // shapes are shared by every heap too
+        instance->fields.shape = fields.shape;
+        for (auto &field: fields.values)
+            instance->fields.values.push_back(copier.copy(field));
+        return instance;
+    }
+
+    void BoundMethod::trace(Heap &heap) {
+        heap.mark_value(receiver);
+        heap.mark_object(method);
+    }
+
+    Obj *BoundMethod::copy(ObjectCopier &copier) const {
+        Object receiver_copy = copier.copy(receiver);
+        return copier.target.heap.allocate<BoundMethod>(receiver_copy, copier.copy(method));
+    }
+
+} // Lox
@@ -3,35 +3,104 @@
 //
 
 #include "LoxFunction.h"
-#include "LoxExceptions.h"
+#include "LoxClass.h"
+#include "Concurrency.h"
 
 namespace Lox {
-    Object LoxFunction::call(Interpreter &interpreter, std::vector<Object> arguments) {
-        Environment *env = new Environment(closure);
-        for (int i = 0; i < function_definition->params.size(); i++) {
-            env->define(function_definition->params[i].lexeme, arguments[i]);
-        }
-        try {
-            interpreter.execute_block(function_definition->body, env);
-        }
-        catch (const ReturnException &e) {
-            return e.value;
+    Object LoxFunction::call(Interpreter &interpreter, Arguments arguments) {
+        return run(interpreter, {}, arguments);
+    }
+
+    Object LoxFunction::call_method(Interpreter &interpreter, Object receiver, Arguments arguments) {
+        return run(interpreter, receiver, arguments);
+    }
+
+    Object LoxFunction::run(Interpreter &interpreter, Object receiver, Arguments arguments) {
+        LoxFunction *function = this;
+        bool tail_call = false;
+        size_t base = 0;
+        Feedback *caller_feedback = interpreter.feedback;
+        // each iteration runs one function, a tail call replaces it with the callee instead of nesting
+        while (true) {
+            // a tail call drops the callee from the stack before its body runs, after which nothing keeps
+            // `function` alive, so only what is copied out of it here may be used past that point
+            FunctionExpr *definition = function->function_definition;
+            FunctionKind kind = function->kind;
+            Feedback *function_feedback = function->function_feedback;
+            int first = kind == FunctionKind::FUNCTION ? 0 : 1;
+            Environment *env;
+            if (first) {
+                // a new instance is only referenced from here until it is in slot 0
+                interpreter.heap.pause_collection();
+                env = interpreter.new_environment(function->closure, definition->num_slots);
+                interpreter.heap.resume_collection();
+                env->define(0, receiver);
+            } else {
+                env = interpreter.new_environment(function->closure, definition->num_slots);
+            }
+            for (int i = 0; i < definition->params.size(); i++) {
+                env->define(i + first, arguments[i]);
+            }
+            if (tail_call)
+                interpreter.drop_call(base);
+            interpreter.feedback = function_feedback;
+            Completion completion = interpreter.execute_block(definition->body, env);
+            interpreter.feedback = caller_feedback;
+            if (!definition->captured)
+                interpreter.release_environment(env);
+            if (kind == FunctionKind::INITIALIZER) {
+                // the Resolver only allows a bare `return;` in an initializer
+                if (completion == Completion::RETURN)
+                    interpreter.take_return_value();
+                return receiver;
+            }
+            if (completion == Completion::RETURN)
+                return interpreter.take_return_value();
+            if (completion != Completion::TAIL_CALL)
+                return {};//return nil
+            base = interpreter.take_tail_call();
+            arguments = interpreter.arguments_at(base);
+            Callable *callee = interpreter.callee_at(base);
+            receiver = Object();
+            if (auto bound = dynamic_cast<BoundMethod *>(callee)) {
+                receiver = bound->receiver;
+                callee = bound->method;
+            }
+            auto *next = dynamic_cast<LoxFunction *>(callee);
+            if (!next) {
+                Object result = call_at(interpreter.tail_call_site(), interpreter.callee_at(base), interpreter, arguments);
+                interpreter.drop_call(base);
+                return result;
+            }
+            function = next;
+            tail_call = true;
         }
-        return {};//return nil
+    }
 
+    Obj *LoxFunction::copy(ObjectCopier &copier) const {
+        Heap &heap = copier.target.heap;
+        Feedback *feedback = copier.copy_feedback(function_feedback);
+        auto *function = name ? heap.allocate<LoxFunction>(*name, function_definition, nullptr, feedback, kind)
+                              : heap.allocate<LoxFunction>(function_definition, nullptr, feedback);
+        copier.remember(this, function);
+        function->closure = copier.copy(closure);
+        return function;
+    }
+
+    void LoxFunction::trace(Heap &heap) {
+        heap.mark_object(closure);
     }
 
     int LoxFunction::arity() {
         return function_definition->params.size();
     }
 
-    LoxFunction::LoxFunction(FunctionExpr *ptr, Environment *closure) : function_definition(
+    LoxFunction::LoxFunction(FunctionExpr *ptr, Environment *closure, Feedback *feedback) : function_definition(
             ptr),
-                                                                        closure(closure) {}
+                                                                        closure(closure), function_feedback(feedback) {}
 
-    LoxFunction::LoxFunction(Token name_token, FunctionExpr *ptr, Environment *closure) : function_definition(
-            ptr),
-                                                                                          closure(closure),
-                                                                                          name(name_token) {
+    LoxFunction::LoxFunction(Token name_token, FunctionExpr *ptr, Environment *closure, Feedback *feedback,
+                             FunctionKind kind)
+            : function_definition(ptr), closure(closure), function_feedback(feedback), name(name_token), kind(kind) {
     }
 } // Lox
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "Obj.h"
+
+namespace Lox {
+
+    std::string ObjFunction::to_string() const {
+        if (name.empty())
+            return "<fn anonymous>";
+        return "<fn " + name + ">";
+    }
+
+    void ObjFunction::trace(Heap &heap) {
+        for (auto &constant: chunk.constants)
+            heap.mark_value(constant);
+    }
+
+    void ObjClosure::trace(Heap &heap) {
+        heap.mark_object(function);
+        for (auto upvalue: upvalues)
+            heap.mark_object(upvalue);
+    }
+
+    std::string ObjNative::to_string() const {
+        return "<native fn>";
+    }
+
+    std::string ObjUpvalue::to_string() const {
+        return "upvalue";
+    }
+
+    std::string ObjClosure::to_string() const {
+        return function->to_string();
+    }
+
+    ObjClosure *ObjClass::super_method(PropertyCache &cache) {
+        // entries have no shape, the method only depends on the class
+        if (const PropertyCache::Entry *hit = cache.find(nullptr, id))
+            return static_cast<ObjClosure *>(hit->method);
+        ObjClosure *method = find_method(cache.name);
+        if (method && !cache.megamorphic)
+            cache.remember({nullptr, nullptr, id, method, 0});
+        return method;
+    }
+
+    void ObjClass::trace(Heap &heap) {
+        for (auto &method: methods)
+            heap.mark_object(method.second);
+    }
+
+    const PropertyCache::Entry *ObjInstance::resolve_miss(PropertyCache &cache, PropertyCache::Entry &miss) {
+        // a field shadows a method of the same name
+        const Shape *shape = fields.shape;
+        int slot = shape->find(cache.name);
+        if (slot >= 0) {
+            miss = {shape, shape, 0, nullptr, (uint32_t) slot};
+        } else if (ObjClosure *method = klass->find_method(cache.name)) {
+            miss = {shape, shape, klass->id, method, 0};
+        } else {
+            return nullptr;
+        }
+        if (!cache.megamorphic)
+            cache.remember(miss);
+        return &miss;
+    }
+
+    void ObjInstance::trace(Heap &heap) {
+        heap.mark_object(klass);
+        for (auto &field: fields.values)
+            heap.mark_value(field);
+    }
+
+    void ObjBoundMethod::trace(Heap &heap) {
+        heap.mark_value(receiver);
+        heap.mark_object(method);
+    }
+
+} // Lox
@@ -0,0 +1,296 @@
+#include "Optimizer.h"
+#include "Heap.h"
+#include "utils.h"
+
+namespace Lox {
+
+    void Optimizer::optimize_program() {
+        // folding first, so that assignments in branches that never run don't count
+        finding_assignments = true;
+        program.statements = optimize(program.statements);
+        finding_assignments = false;
+        program.statements = optimize(program.statements);
+    }
+
+    // a visit replaces its node by setting expr_result (stmt_result), which nested calls restore before returning
+    Expr *Optimizer::optimize(Expr *expr) {
+        if (!expr)
+            return nullptr;
+        Expr *enclosing = expr_result;
+        expr_result = expr;
+        expr->accept(*this);
+        Expr *result = expr_result;
+        expr_result = enclosing;
+        return result;
+    }
+
+    Stmt *Optimizer::optimize(Stmt *stmt) {
+        if (!stmt)
+            return nullptr;
+        Stmt *enclosing = stmt_result;
+        stmt_result = stmt;
+        stmt->accept(*this);
+        Stmt *result = stmt_result;
+        stmt_result = enclosing;
+        return result;
+    }
+
+    NodeList<Stmt *> Optimizer::optimize(NodeList<Stmt *> statements) {
+        std::vector<Stmt *> kept;
+        kept.reserve(statements.size());
+        for (auto &stmt: statements) {
+            stmt = optimize(stmt);
+            if (stmt)
+                kept.push_back(stmt);
+        }
+        if (kept.size() == statements.size())
+            return statements;
+        return program.arena.make_list(kept);
+    }
+
+    Stmt *Optimizer::empty_block() {
+        return program.arena.make<Block>(NodeList<Stmt *>());
+    }
+
+    void Optimizer::optimize_function(FunctionExpr *function) {
+        // parameters and the body share a scope, as in the Resolver
+        scopes.emplace_back();
+        for (auto &param: function->params)
+            declare(param, nullptr);
+        function->body = optimize(function->body);
+        scopes.pop_back();
+    }
+
+    void Optimizer::declare(const Token &name, Var *var) {
+        if (scopes.empty())
+            return;
+        auto &scope = scopes.back();
+        auto itr = scope.find(name.lexeme);
+        // a redeclaration reuses the slot, so closures over the first declaration see the second value
+        if (itr != scope.end() && itr->second)
+            assigned.insert(itr->second);
+        scope[name.lexeme] = var;
+    }
+
+    Var *Optimizer::lookup(const Token &name) {
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+            auto itr = scope->find(name.lexeme);
+            if (itr != scope->end())
+                return itr->second;
+        }
+        return nullptr;
+    }
+
+    Literal *Optimizer::literal(Expr *expr) {
+        return dynamic_cast<Literal *>(expr);
+    }
+
+    Expr *Optimizer::fold_binary(Binary *expr, const Object &left, const Object &right) {
+        auto make = [this](Object value) { return program.arena.make<Literal>(value); };
+        switch (expr->oper.type) {
+            case EQUAL_EQUAL:
+                return make(values_equal(left, right));
+            case BANG_EQUAL:
+                return make(!values_equal(left, right));
+            case PLUS:
+                if (left.is_string() && right.is_string())
+                    return make(program.constant_string(left.as_string() + right.as_string()));
+                if (left.is_string() && right.is_number())
+                    return make(program.constant_string(left.as_string() + to_string(right.as_number())));
+                if (left.is_number() && right.is_string())
+                    return make(program.constant_string(to_string(left.as_number()) + right.as_string()));
+                break;
+            default:
+                break;
+        }
+        // everything else needs two numbers, other operands are a runtime error that has to stay
+        if (!left.is_number() || !right.is_number())
+            return expr;
+        double a = left.as_number(), b = right.as_number();
+        switch (expr->oper.type) {
+            case PLUS:
+                return make(a + b);
+            case MINUS:
+                return make(a - b);
+            case STAR:
+                return make(a * b);
+            case SLASH:
+                if (b == 0)
+                    return expr;
+                return make(a / b);
+            case GREATER:
+                return make(a > b);
+            case GREATER_EQUAL:
+                return make(a >= b);
+            case LESS:
+                return make(a < b);
+            case LESS_EQUAL:
+                return make(a <= b);
+            default:
+                return expr;
+        }
+    }
+
+    void Optimizer::visit(Expression *stmt) {
+        stmt->expression = optimize(stmt->expression);
+    }
+
+    void Optimizer::visit(Print *stmt) {
+        stmt->expression = optimize(stmt->expression);
+    }
+
+    void Optimizer::visit(Block *stmt) {
+        scopes.emplace_back();
+        stmt->statements = optimize(stmt->statements);
+        scopes.pop_back();
+    }
+
+    void Optimizer::visit(Var *stmt) {
+        // the initializer is looked up before the name is declared, `var a = a;` reads the outer a
+        stmt->initializer = optimize(stmt->initializer);
+        if (scopes.empty())
+            return;
+        declare(stmt->name, stmt);
+        Literal *initializer = literal(stmt->initializer);
+        if (!finding_assignments && initializer && !assigned.count(stmt))
+            constants[stmt] = initializer->value;
+    }
+
+    void Optimizer::visit(If *stmt) {
+        stmt->condition = optimize(stmt->condition);
+        stmt->then_branch = optimize(stmt->then_branch);
+        stmt->else_branch = optimize(stmt->else_branch);
+        if (Literal *condition = literal(stmt->condition)) {
+            stmt_result = is_truthy(condition->value) ? stmt->then_branch : stmt->else_branch;
+            return;
+        }
+        if (!stmt->then_branch)
+            stmt->then_branch = empty_block();
+    }
+
+    void Optimizer::visit(While *stmt) {
+        stmt->condition = optimize(stmt->condition);
+        stmt->body = optimize(stmt->body);
+        if (!stmt->body)
+            stmt->body = empty_block();
+        Literal *condition = literal(stmt->condition);
+        if (!condition)
+            return;
+        if (is_truthy(condition->value))
+            stmt->condition = nullptr;
+        else
+            stmt_result = nullptr;
+    }
+
+    void Optimizer::visit(Break *stmt) {
+    }
+
+    void Optimizer::visit(Return *stmt) {
+        stmt->value = optimize(stmt->value);
+    }
+
+    void Optimizer::visit(Function *stmt) {
+        declare(stmt->name, nullptr);
+        optimize_function(stmt->fn_expr);
+    }
+
+    void Optimizer::visit(Class *stmt) {
+        declare(stmt->name, nullptr);
+        for (auto method: stmt->methods)
+            optimize_function(method->fn_expr);
+    }
+
+    void Optimizer::visit(Binary *expr) {
+        expr->left = optimize(expr->left);
+        expr->right = optimize(expr->right);
+        Literal *left = literal(expr->left), *right = literal(expr->right);
+        if (expr->oper.type == COMMA) {
+            if (left)
+                expr_result = expr->right;
+            return;
+        }
+        if (left && right)
+            expr_result = fold_binary(expr, left->value, right->value);
+    }
+
+    void Optimizer::visit(Grouping *expr) {
+        expr_result = optimize(expr->expression);
+    }
+
+    void Optimizer::visit(Ternary *expr) {
+        expr->condition = optimize(expr->condition);
+        expr->left = optimize(expr->left);
+        expr->right = optimize(expr->right);
+        if (Literal *condition = literal(expr->condition))
+            expr_result = is_truthy(condition->value) ? expr->left : expr->right;
+    }
+
+    void Optimizer::visit(Literal *expr) {
+    }
+
+    void Optimizer::visit(Unary *expr) {
+        expr->right = optimize(expr->right);
+        Literal *right = literal(expr->right);
+        if (!right)
+            return;
+        if (expr->oper.type == BANG)
+            expr_result = program.arena.make<Literal>(!is_truthy(right->value));
+        else if (expr->oper.type == MINUS && right->value.is_number())
+            expr_result = program.arena.make<Literal>(-right->value.as_number());
+    }
+
+    void Optimizer::visit(Nothing *expr) {
+    }
+
+    void Optimizer::visit(Variable *expr) {
+        if (finding_assignments)
+            return;
+        auto itr = constants.find(lookup(expr->name));
+        if (itr != constants.end())
+            expr_result = program.arena.make<Literal>(itr->second);
+    }
+
+    void Optimizer::visit(Logical *expr) {
+        expr->left = optimize(expr->left);
+        expr->right = optimize(expr->right);
+        Literal *left = literal(expr->left);
+        if (!left)
+            return;
+        // `or` keeps a truthy left operand and `and` a falsy one, otherwise the result is the right operand
+        bool keeps_left = is_truthy(left->value) == (expr->oper.type == OR);
+        expr_result = keeps_left ? expr->left : expr->right;
+    }
+
+    void Optimizer::visit(Assign *expr) {
+        expr->value = optimize(expr->value);
+        if (finding_assignments)
+            if (Var *var = lookup(expr->name))
+                assigned.insert(var);
+    }
+
+    void Optimizer::visit(Call *expr) {
+        expr->callee = optimize(expr->callee);
+        for (auto &argument: expr->arguments)
+            argument = optimize(argument);
+    }
+
+    void Optimizer::visit(FunctionExpr *expr) {
+        optimize_function(expr);
+    }
+
+    void Optimizer::visit(Get *expr) {
+        expr->object = optimize(expr->object);
+    }
+
+    void Optimizer::visit(Set *expr) {
+        expr->object = optimize(expr->object);
+        expr->value = optimize(expr->value);
+    }
+
+    void Optimizer::visit(This *expr) {
+    }
+
+    void Optimizer::visit(Super *expr) {
+    }
+
+} // Lox
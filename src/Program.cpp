@@ -0,0 +1,17 @@
+#include "Program.h"
+#include <atomic>
+#include "Value.h"
+
+namespace Lox {
+
+    static std::atomic<uint64_t> last_program_id{0};
+
+    Program::Program() : id(++last_program_id) {}
+
+    LoxString *Program::constant_string(std::string chars) {
+        auto *string = arena.make<LoxString>(std::move(chars));
+        string->permanent = true;
+        return string;
+    }
+
+} // Lox
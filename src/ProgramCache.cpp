@@ -0,0 +1,619 @@
+#include "ProgramCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <thread>
+#include <unistd.h>
+#include "Expr.hpp"
+#include "Stmt.hpp"
+#include "Heap.h"
+
+namespace Lox {
+
+    namespace {
+        constexpr char MAGIC[4] = {'L', 'O', 'X', 'C'};
+
+        enum class ExprTag : uint8_t {
+            NONE, BINARY, GROUPING, TERNARY, LITERAL, UNARY, NOTHING, VARIABLE, LOGICAL, ASSIGN, CALL, FUNCTION, GET,
+            SET, THIS, SUPER
+        };
+
+        enum class StmtTag : uint8_t {
+            NONE, EXPRESSION, PRINT, BLOCK, VAR, IF, WHILE, BREAK, RETURN, FUNCTION, CLASS
+        };
+
+        enum class LiteralTag : uint8_t {
+            NIL, FALSE, TRUE, NUMBER, STRING
+        };
+
+        uint64_t zigzag(int64_t value) {
+            return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+        }
+
+        int64_t unzigzag(uint64_t value) {
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        // Fixed size values are written in the host's byte order, the cache is not meant to be shared between
+        // machines. Counts and token positions are LEB128 varints, positions as the difference to the previous token
+        // so most of them fit in a byte.
+        class Writer : public ExprVisitor, public StmtVisitor {
+            std::string_view source;
+            uint64_t last_offset = 0;
+            int64_t last_line = 0;
+
+            template<typename T>
+            void put(T value) {
+                out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+            }
+
+            void put_varint(uint64_t value) {
+                while (value >= 0x80) {
+                    out.push_back(static_cast<char>(value | 0x80));
+                    value >>= 7;
+                }
+                out.push_back(static_cast<char>(value));
+            }
+
+            void put_string(std::string_view text) {
+                put_varint(text.size());
+                out.append(text);
+            }
+
+            void put_token(const Token &token) {
+                uint64_t offset = token.lexeme.data() - source.data();
+                put<uint8_t>(token.type);
+                put_varint(zigzag(token.line - last_line));
+                put_varint(zigzag(static_cast<int64_t>(offset - last_offset)));
+                put_varint(token.lexeme.size());
+                last_line = token.line;
+                last_offset = offset;
+            }
+
+            void put_expr(Expr *expr) {
+                if (expr)
+                    expr->accept(*this);
+                else
+                    put(ExprTag::NONE);
+            }
+
+            void put_function(FunctionExpr *fn) {
+                put_varint(fn->params.size());
+                for (auto &param: fn->params)
+                    put_token(param);
+                put_statements(fn->body);
+            }
+
+        public:
+            std::string out;
+
+            explicit Writer(std::string_view source) : source(source) {};
+
+            void put_stmt(Stmt *stmt) {
+                if (stmt)
+                    stmt->accept(*this);
+                else
+                    put(StmtTag::NONE);
+            }
+
+            void put_statements(const NodeList<Stmt *> &statements) {
+                put_varint(statements.size());
+                for (auto stmt: statements)
+                    put_stmt(stmt);
+            }
+
+            void visit(Binary *expr) override {
+                put(ExprTag::BINARY);
+                put_expr(expr->left);
+                put_token(expr->oper);
+                put_expr(expr->right);
+            }
+
+            void visit(Grouping *expr) override {
+                put(ExprTag::GROUPING);
+                put_expr(expr->expression);
+            }
+
+            void visit(Ternary *expr) override {
+                put(ExprTag::TERNARY);
+                put_expr(expr->condition);
+                put_expr(expr->left);
+                put_expr(expr->right);
+            }
+
+            void visit(Literal *expr) override {
+                put(ExprTag::LITERAL);
+                const Object &value = expr->value;
+                if (value.is_bool()) {
+                    put(value.as_bool() ? LiteralTag::TRUE : LiteralTag::FALSE);
+                } else if (value.is_number()) {
+                    put(LiteralTag::NUMBER);
+                    put(value.as_number());
+                } else if (value.is_string()) {
+                    put(LiteralTag::STRING);
+                    put_string(value.as_string());
+                } else {
+                    put(LiteralTag::NIL);
+                }
+            }
+
+            void visit(Unary *expr) override {
+                put(ExprTag::UNARY);
+                put_token(expr->oper);
+                put_expr(expr->right);
+            }
+
+            void visit(Nothing *expr) override {
+                put(ExprTag::NOTHING);
+                put_string(expr->nothing);
+            }
+
+            void visit(Variable *expr) override {
+                put(ExprTag::VARIABLE);
+                put_token(expr->name);
+            }
+
+            void visit(Logical *expr) override {
+                put(ExprTag::LOGICAL);
+                put_expr(expr->left);
+                put_token(expr->oper);
+                put_expr(expr->right);
+            }
+
+            void visit(Assign *expr) override {
+                put(ExprTag::ASSIGN);
+                put_token(expr->name);
+                put_expr(expr->value);
+            }
+
+            void visit(Call *expr) override {
+                put(ExprTag::CALL);
+                put_expr(expr->callee);
+                put_token(expr->paren);
+                put_varint(expr->arguments.size());
+                for (auto argument: expr->arguments)
+                    put_expr(argument);
+            }
+
+            void visit(FunctionExpr *expr) override {
+                put(ExprTag::FUNCTION);
+                put_function(expr);
+            }
+
+            void visit(Get *expr) override {
+                put(ExprTag::GET);
+                put_expr(expr->object);
+                put_token(expr->name);
+            }
+
+            void visit(Set *expr) override {
+                put(ExprTag::SET);
+                put_expr(expr->object);
+                put_token(expr->name);
+                put_expr(expr->value);
+            }
+
+            void visit(This *expr) override {
+                put(ExprTag::THIS);
+                put_token(expr->keyword);
+            }
+
+            void visit(Super *expr) override {
+                put(ExprTag::SUPER);
+                put_token(expr->keyword);
+                put_token(expr->method);
+            }
+
+            void visit(Expression *stmt) override {
+                put(StmtTag::EXPRESSION);
+                put_expr(stmt->expression);
+            }
+
+            void visit(Print *stmt) override {
+                put(StmtTag::PRINT);
+                put_expr(stmt->expression);
+            }
+
+            void visit(Block *stmt) override {
+                put(StmtTag::BLOCK);
+                put_statements(stmt->statements);
+            }
+
+            void visit(Var *stmt) override {
+                put(StmtTag::VAR);
+                put_token(stmt->name);
+                put_expr(stmt->initializer);
+            }
+
+            void visit(If *stmt) override {
+                put(StmtTag::IF);
+                put_expr(stmt->condition);
+                put_stmt(stmt->then_branch);
+                put_stmt(stmt->else_branch);
+            }
+
+            void visit(While *stmt) override {
+                put(StmtTag::WHILE);
+                put_expr(stmt->condition);
+                put_stmt(stmt->body);
+            }
+
+            void visit(Break *stmt) override {
+                put(StmtTag::BREAK);
+            }
+
+            void visit(Return *stmt) override {
+                put(StmtTag::RETURN);
+                put_token(stmt->keyword);
+                put_expr(stmt->value);
+            }
+
+            void visit(Function *stmt) override {
+                put(StmtTag::FUNCTION);
+                put_token(stmt->name);
+                put_function(stmt->fn_expr);
+            }
+
+            void visit(Class *stmt) override {
+                put(StmtTag::CLASS);
+                put_token(stmt->name);
+                put_expr(stmt->superclass);
+                put_varint(stmt->methods.size());
+                for (auto method: stmt->methods) {
+                    put_token(method->name);
+                    put_function(method->fn_expr);
+                }
+            }
+
+            void put_header(uint64_t hash) {
+                out.append(MAGIC, sizeof(MAGIC));
+                put<uint32_t>(ProgramCache::FORMAT_VERSION);
+                put<uint32_t>(T_EOF);
+                put<uint64_t>(source.size());
+                put<uint64_t>(hash);
+            }
+        };
+
+        // every read is bounds checked, a truncated or corrupt file throws Malformed
+        class Reader {
+            std::string_view data;
+            size_t position = 0;
+            Program &program;
+            std::string_view source;
+            uint64_t last_offset = 0;
+            int64_t last_line = 0;
+
+            template<typename T>
+            T get() {
+                T value;
+                std::memcpy(&value, take(sizeof(T)), sizeof(T));
+                return value;
+            }
+
+            const char *take(size_t size) {
+                if (data.size() - position < size)
+                    throw Malformed();
+                const char *bytes = data.data() + position;
+                position += size;
+                return bytes;
+            }
+
+            // a list can't have more entries than there are bytes left, which keeps a corrupt count from
+            // reserving gigabytes
+            uint64_t get_varint() {
+                uint64_t value = 0;
+                for (int shift = 0; shift < 64; shift += 7) {
+                    auto byte = get<uint8_t>();
+                    value |= uint64_t(byte & 0x7F) << shift;
+                    if (!(byte & 0x80))
+                        return value;
+                }
+                throw Malformed();
+            }
+
+            uint32_t get_count() {
+                auto count = get_varint();
+                if (count > data.size() - position)
+                    throw Malformed();
+                return count;
+            }
+
+            std::string get_string() {
+                auto size = get_count();
+                return {take(size), size};
+            }
+
+            Token get_token() {
+                auto type = get<uint8_t>();
+                int64_t line = last_line + unzigzag(get_varint());
+                uint64_t offset = last_offset + unzigzag(get_varint());
+                uint64_t size = get_varint();
+                if (type > T_EOF || offset > source.size() || size > source.size() - offset)
+                    throw Malformed();
+                last_line = line;
+                last_offset = offset;
+                return {static_cast<token_type>(type), source.substr(offset, size), static_cast<int>(line)};
+            }
+
+            // a token of one of `types`, the only ones the parser puts in the node being read
+            Token get_token(std::initializer_list<token_type> types) {
+                Token token = get_token();
+                if (std::find(types.begin(), types.end(), token.type) == types.end())
+                    throw Malformed();
+                return token;
+            }
+
+            Token get_name() {
+                return get_token({IDENTIFIER});
+            }
+
+            template<typename T, typename... Args>
+            T *make(Args &&... args) {
+                return program.arena.make<T>(std::forward<Args>(args)...);
+            }
+
+            FunctionExpr *get_function() {
+                auto params = program.arena.make_list<Token>(get_count(), [&] { return get_name(); });
+                return make<FunctionExpr>(params, get_statements());
+            }
+
+            Object get_literal() {
+                switch (get<LiteralTag>()) {
+                    case LiteralTag::NIL:
+                        return {};
+                    case LiteralTag::FALSE:
+                        return false;
+                    case LiteralTag::TRUE:
+                        return true;
+                    case LiteralTag::NUMBER:
+                        return get<double>();
+                    case LiteralTag::STRING:
+                        return program.constant_string(get_string());
+                }
+                throw Malformed();
+            }
+
+            // operands are read into locals first so they are taken from the stream in order
+            Expr *get_expr() {
+                switch (get<ExprTag>()) {
+                    case ExprTag::NONE:
+                        return nullptr;
+                    case ExprTag::BINARY: {
+                        auto left = get_required_expr();
+                        auto oper = get_token({COMMA, BANG_EQUAL, EQUAL_EQUAL, GREATER, GREATER_EQUAL, LESS,
+                                               LESS_EQUAL, MINUS, PLUS, SLASH, STAR});
+                        return make<Binary>(left, oper, get_required_expr());
+                    }
+                    case ExprTag::GROUPING:
+                        return make<Grouping>(get_required_expr());
+                    case ExprTag::TERNARY: {
+                        auto condition = get_required_expr();
+                        auto left = get_required_expr();
+                        return make<Ternary>(condition, left, get_required_expr());
+                    }
+                    case ExprTag::LITERAL:
+                        return make<Literal>(get_literal());
+                    case ExprTag::UNARY: {
+                        auto oper = get_token({BANG, MINUS});
+                        return make<Unary>(oper, get_required_expr());
+                    }
+                    case ExprTag::NOTHING:
+                        return make<Nothing>(get_string());
+                    case ExprTag::VARIABLE:
+                        return make<Variable>(get_name());
+                    case ExprTag::LOGICAL: {
+                        auto left = get_required_expr();
+                        auto oper = get_token({AND, OR});
+                        return make<Logical>(left, oper, get_required_expr());
+                    }
+                    case ExprTag::ASSIGN: {
+                        auto name = get_name();
+                        return make<Assign>(name, get_required_expr());
+                    }
+                    case ExprTag::CALL: {
+                        auto callee = get_required_expr();
+                        auto paren = get_token({RIGHT_PAREN});
+                        auto arguments = program.arena.make_list<Expr *>(get_count(), [&] {
+                            return get_required_expr();
+                        });
+                        return make<Call>(callee, paren, arguments);
+                    }
+                    case ExprTag::FUNCTION:
+                        return get_function();
+                    case ExprTag::GET: {
+                        auto object = get_required_expr();
+                        return make<Get>(object, get_name());
+                    }
+                    case ExprTag::SET: {
+                        auto object = get_required_expr();
+                        auto name = get_name();
+                        return make<Set>(object, name, get_required_expr());
+                    }
+                    case ExprTag::THIS:
+                        return make<This>(get_token({THIS}));
+                    case ExprTag::SUPER: {
+                        auto keyword = get_token({SUPER});
+                        return make<Super>(keyword, get_name());
+                    }
+                }
+                throw Malformed();
+            }
+
+            // an expression the parser never leaves out, such as an operand
+            Expr *get_required_expr() {
+                Expr *expr = get_expr();
+                if (!expr)
+                    throw Malformed();
+                return expr;
+            }
+
+            Stmt *get_stmt() {
+                switch (get<StmtTag>()) {
+                    case StmtTag::NONE:
+                        return nullptr;
+                    case StmtTag::EXPRESSION:
+                        return make<Expression>(get_required_expr());
+                    case StmtTag::PRINT:
+                        return make<Print>(get_required_expr());
+                    case StmtTag::BLOCK:
+                        return make<Block>(get_statements());
+                    case StmtTag::VAR: {
+                        auto name = get_name();
+                        return make<Var>(name, get_expr());
+                    }
+                    case StmtTag::IF: {
+                        auto condition = get_required_expr();
+                        auto then_branch = get_required_stmt();
+                        return make<If>(condition, then_branch, get_stmt());
+                    }
+                    case StmtTag::WHILE: {
+                        auto condition = get_required_expr();
+                        return make<While>(condition, get_required_stmt());
+                    }
+                    case StmtTag::BREAK:
+                        return make<Break>("placeholder");
+                    case StmtTag::RETURN: {
+                        auto keyword = get_token({RETURN});
+                        return make<Return>(keyword, get_expr());
+                    }
+                    case StmtTag::FUNCTION: {
+                        auto name = get_name();
+                        return make<Function>(name, get_function());
+                    }
+                    case StmtTag::CLASS: {
+                        auto name = get_name();
+                        auto superclass = get_expr();
+                        // the interpreters read the superclass as a variable
+                        if (superclass && superclass->kind != ExprKind::Variable)
+                            throw Malformed();
+                        auto methods = program.arena.make_list<Function *>(get_count(), [&] {
+                            auto method_name = get_name();
+                            return make<Function>(method_name, get_function());
+                        });
+                        return make<Class>(name, superclass, methods);
+                    }
+                }
+                throw Malformed();
+            }
+
+            Stmt *get_required_stmt() {
+                Stmt *stmt = get_stmt();
+                if (!stmt)
+                    throw Malformed();
+                return stmt;
+            }
+
+        public:
+            struct Malformed {
+            };
+
+            Reader(std::string_view data, Program &program) : data(data), program(program),
+                                                              source(program.source.view()) {};
+
+            NodeList<Stmt *> get_statements() {
+                return program.arena.make_list<Stmt *>(get_count(), [&] { return get_required_stmt(); });
+            }
+
+            bool check_header() {
+                return std::memcmp(take(sizeof(MAGIC)), MAGIC, sizeof(MAGIC)) == 0 &&
+                       get<uint32_t>() == ProgramCache::FORMAT_VERSION &&
+                       get<uint32_t>() == T_EOF &&
+                       get<uint64_t>() == source.size() &&
+                       get<uint64_t>() == ProgramCache::hash_source(source);
+            }
+
+            bool at_end() const { return position == data.size(); }
+        };
+    }
+
+    std::string ProgramCache::default_directory() {
+        if (const char *dir = std::getenv("LOX_CACHE_DIR"))
+            return dir;
+        if (const char *dir = std::getenv("XDG_CACHE_HOME"))
+            return std::string(dir) + "/lox";
+        if (const char *home = std::getenv("HOME"))
+            return std::string(home) + "/.cache/lox";
+        return "";
+    }
+
+    // not cryptographic, only has to tell apart the versions of a script that are run
+    uint64_t ProgramCache::hash_source(std::string_view source) {
+        constexpr uint64_t K1 = 0x9E3779B97F4A7C15ull, K2 = 0xC2B2AE3D27D4EB4Full;
+        uint64_t hash = source.size() * K2;
+        size_t i = 0;
+        for (; i + 8 <= source.size(); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, source.data() + i, 8);
+            hash = (hash ^ (word * K1));
+            hash = ((hash << 31) | (hash >> 33)) * K2;
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, source.data() + i, source.size() - i);
+        hash ^= tail * K1;
+        hash ^= hash >> 29;
+        hash *= K1;
+        return hash ^ (hash >> 32);
+    }
+
+    std::string ProgramCache::path_for(std::string_view source) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.loxc", static_cast<unsigned long long>(hash_source(source)));
+        return directory + "/" + name;
+    }
+
+    std::string ProgramCache::serialize(const Program &program) {
+        Writer writer(program.source.view());
+        writer.put_header(hash_source(program.source.view()));
+        writer.put_statements(program.statements);
+        return std::move(writer.out);
+    }
+
+    bool ProgramCache::deserialize(std::string_view data, Program &program) {
+        Reader reader(data, program);
+        try {
+            if (!reader.check_header())
+                return false;
+            auto statements = reader.get_statements();
+            if (!reader.at_end())
+                return false;
+            program.statements = statements;
+            return true;
+        } catch (Reader::Malformed &) {
+            return false;
+        }
+    }
+
+    bool ProgramCache::load(Program &program) const {
+        if (directory.empty())
+            return false;
+        std::optional<Source> file = Source::open(path_for(program.source.view()));
+        return file && deserialize(file->view(), program);
+    }
+
+    void ProgramCache::store(const Program &program) const {
+        if (directory.empty())
+            return;
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        std::string path = path_for(program.source.view());
+        // written under a temporary name and renamed, so a concurrent run never maps half a file. Isolates on
+        // other threads of this process may be storing the same script
+        std::string temporary = path + "." + std::to_string(getpid()) + "." +
+                                std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary);
+            std::string data = serialize(program);
+            if (!out.write(data.data(), data.size()))
+                error = std::make_error_code(std::errc::io_error);
+        }
+        if (!error)
+            std::filesystem::rename(temporary, path, error);
+        if (error)
+            std::filesystem::remove(temporary, error);
+    }
+
+} // Lox
@@ -0,0 +1,269 @@
+#include "Resolver.h"
+#include "lox.h"
+#include "utils.h"
+
+namespace Lox {
+
+    void Resolver::resolve_program(Program &program_) {
+        program = &program_;
+        resolve(program->statements);
+    }
+
+    void Resolver::resolve(Stmt *stmt) {
+        if (stmt)stmt->accept(*this);
+    }
+
+    void Resolver::resolve(Expr *expr) {
+        if (expr)expr->accept(*this);
+    }
+
+    void Resolver::resolve(NodeList<Stmt *> statements) {
+        for (auto stmt: statements) {
+            resolve(stmt);
+        }
+    }
+
+    void Resolver::resolve_function(FunctionExpr *function, FunctionType type) {
+        FunctionType enclosing_function = current_function;
+        current_function = type;
+        int functions_before = ++functions_resolved;
+        // parameters and the top level statements of the body share the environment created by the call
+        scopes.emplace_back();
+        // methods find their receiver in slot 0, before the parameters
+        if (type == FunctionType::METHOD || type == FunctionType::INITIALIZER) {
+            declare(Token(THIS, "this", 0));
+        }
+        for (auto &param: function->params) {
+            declare(param);
+        }
+        resolve(function->body);
+        function->num_slots = (int) scopes.back().size();
+        function->captured = functions_resolved != functions_before;
+        scopes.pop_back();
+        current_function = enclosing_function;
+    }
+
+    Slot Resolver::declare(const Token &name) {
+        if (scopes.empty()) {
+            return global(name);
+        }
+        auto &scope = scopes.back();
+        // redeclaring a name in the same scope reuses its slot, matching the old define() semantics
+        auto itr = scope.find(name.lexeme);
+        if (itr != scope.end()) {
+            return {0, itr->second};
+        }
+        int index = (int) scope.size();
+        scope.emplace(name.lexeme, index);
+        return {0, index};
+    }
+
+    Slot Resolver::resolve_local(const Token &name) {
+        for (int i = (int) scopes.size() - 1; i >= 0; i--) {
+            auto itr = scopes[i].find(name.lexeme);
+            if (itr != scopes[i].end()) {
+                return {(int) scopes.size() - 1 - i, itr->second};
+            }
+        }
+        return global(name);
+    }
+
+    Slot Resolver::global(const Token &name) {
+        auto itr = globals.find(name.lexeme);
+        if (itr != globals.end())
+            return {-1, itr->second};
+        int index = (int) program->global_names.size();
+        globals.emplace(name.lexeme, index);
+        program->global_names.emplace_back(name.lexeme);
+        return {-1, index};
+    }
+
+    bool Resolver::has_tail_call(Expr *value) {
+        if (value->kind == ExprKind::Ternary) {
+            auto ternary = static_cast<Ternary *>(value);
+            return has_tail_call(ternary->left) || has_tail_call(ternary->right);
+        }
+        return value->kind == ExprKind::Call;
+    }
+
+    bool Resolver::declares_variables(NodeList<Stmt *> statements) {
+        for (auto stmt: statements) {
+            if (instanceof<Var>(stmt) || instanceof<Function>(stmt) || instanceof<Class>(stmt))
+                return true;
+        }
+        return false;
+    }
+
+    void Resolver::visit(Expression *stmt) {
+        resolve(stmt->expression);
+    }
+
+    void Resolver::visit(Print *stmt) {
+        resolve(stmt->expression);
+    }
+
+    void Resolver::visit(Block *stmt) {
+        int functions_before = functions_resolved;
+        // blocks that declare nothing get no environment at runtime, so they get no scope here either
+        if (!declares_variables(stmt->statements)) {
+            stmt->num_slots = 0;
+            resolve(stmt->statements);
+        } else {
+            scopes.emplace_back();
+            resolve(stmt->statements);
+            stmt->num_slots = (int) scopes.back().size();
+            scopes.pop_back();
+        }
+        stmt->captured = functions_resolved != functions_before;
+    }
+
+    void Resolver::visit(Var *stmt) {
+        // resolve the initializer first so that `var a = a;` refers to the outer a
+        resolve(stmt->initializer);
+        stmt->slot = declare(stmt->name);
+    }
+
+    void Resolver::visit(If *stmt) {
+        resolve(stmt->condition);
+        resolve(stmt->then_branch);
+        resolve(stmt->else_branch);
+    }
+
+    void Resolver::visit(While *stmt) {
+        resolve(stmt->condition);
+        resolve(stmt->body);
+    }
+
+    void Resolver::visit(Break *stmt) {
+    }
+
+    void Resolver::visit(Return *stmt) {
+        if (current_function == FunctionType::NONE) {
+            Lox::error(stmt->keyword, "Can't return from top-level code.");
+        }
+        if (current_function == FunctionType::INITIALIZER && stmt->value) {
+            Lox::error(stmt->keyword, "Can't return a value from an initializer.");
+        }
+        // nothing runs in the returning function after the call, so the callee can take over its frame
+        stmt->tail_call = stmt->value && has_tail_call(stmt->value);
+        resolve(stmt->value);
+    }
+
+    void Resolver::visit(Function *stmt) {
+        // declare before resolving the body so the function can refer to itself recursively
+        stmt->slot = declare(stmt->name);
+        resolve_function(stmt->fn_expr, FunctionType::FUNCTION);
+    }
+
+    void Resolver::visit(Class *stmt) {
+        ClassType enclosing_class = current_class;
+        current_class = ClassType::CLASS;
+        stmt->slot = declare(stmt->name);
+        auto superclass = static_cast<Variable *>(stmt->superclass);
+        if (superclass) {
+            if (superclass->name.lexeme == stmt->name.lexeme) {
+                Lox::error(superclass->name, "A class can't inherit from itself.");
+            }
+            current_class = ClassType::SUBCLASS;
+            resolve(superclass);
+            // the methods of a subclass close over an environment holding the superclass
+            scopes.emplace_back();
+            declare(Token(SUPER, "super", 0));
+        }
+        for (auto method: stmt->methods) {
+            bool initializer = method->name.lexeme == "init";
+            resolve_function(method->fn_expr, initializer ? FunctionType::INITIALIZER : FunctionType::METHOD);
+        }
+        if (superclass) {
+            scopes.pop_back();
+        }
+        current_class = enclosing_class;
+    }
+
+    void Resolver::visit(Binary *expr) {
+        resolve(expr->left);
+        resolve(expr->right);
+        expr->specialization = program->specialization_count++;
+    }
+
+    void Resolver::visit(Grouping *expr) {
+        resolve(expr->expression);
+    }
+
+    void Resolver::visit(Ternary *expr) {
+        resolve(expr->condition);
+        resolve(expr->left);
+        resolve(expr->right);
+    }
+
+    void Resolver::visit(Literal *expr) {
+    }
+
+    void Resolver::visit(Unary *expr) {
+        resolve(expr->right);
+        expr->specialization = program->specialization_count++;
+    }
+
+    void Resolver::visit(Nothing *expr) {
+    }
+
+    void Resolver::visit(Variable *expr) {
+        expr->slot = resolve_local(expr->name);
+        expr->specialization = program->specialization_count++;
+    }
+
+    void Resolver::visit(Logical *expr) {
+        resolve(expr->left);
+        resolve(expr->right);
+    }
+
+    void Resolver::visit(Assign *expr) {
+        resolve(expr->value);
+        expr->slot = resolve_local(expr->name);
+    }
+
+    void Resolver::visit(Call *expr) {
+        resolve(expr->callee);
+        for (auto argument: expr->arguments) {
+            resolve(argument);
+        }
+    }
+
+    void Resolver::visit(FunctionExpr *expr) {
+        resolve_function(expr, FunctionType::FUNCTION);
+    }
+
+    void Resolver::visit(Get *expr) {
+        resolve(expr->object);
+        expr->cache = program->cache_count++;
+    }
+
+    void Resolver::visit(Set *expr) {
+        resolve(expr->object);
+        resolve(expr->value);
+        expr->cache = program->cache_count++;
+    }
+
+    void Resolver::visit(This *expr) {
+        if (current_class == ClassType::NONE) {
+            Lox::error(expr->keyword, "Can't use 'this' outside of a class.");
+            return;
+        }
+        expr->slot = resolve_local(expr->keyword);
+    }
+
+    void Resolver::visit(Super *expr) {
+        if (current_class == ClassType::NONE) {
+            Lox::error(expr->keyword, "Can't use 'super' outside of a class.");
+            return;
+        }
+        if (current_class != ClassType::SUBCLASS) {
+            Lox::error(expr->keyword, "Can't use 'super' in a class with no superclass.");
+            return;
+        }
+        expr->slot = resolve_local(expr->keyword);
+        expr->this_slot = resolve_local(Token(THIS, "this", expr->keyword.line));
+        expr->cache = program->cache_count++;
+    }
+
+} // Lox
@@ -0,0 +1,133 @@
+#include "ScanKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LOX_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+    bool is_whitespace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    const char *skip_whitespace_scalar(const char *p, const char *end, int &lines) {
+        for (; p < end && is_whitespace(*p); p++)
+            lines += *p == '\n';
+        return p;
+    }
+
+    const char *find_char_scalar(const char *p, const char *end, char c, int &lines) {
+        for (; p < end && *p != c; p++)
+            lines += *p == '\n';
+        return p;
+    }
+
+#ifdef LOX_SCAN_X86
+
+    // `stop` has a bit set for every byte that ends the scan; newlines in front of the first one are counted
+    template<typename Mask>
+    inline bool stop_in_block(Mask stop, Mask newlines, const char *&p, int &lines) {
+        if (!stop) {
+            lines += __builtin_popcountll(newlines);
+            return false;
+        }
+        unsigned index = __builtin_ctzll(stop);
+        lines += __builtin_popcountll(newlines & ((Mask(1) << index) - 1));
+        p += index;
+        return true;
+    }
+
+    const char *skip_whitespace_sse2(const char *p, const char *end, int &lines) {
+        const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+        const __m128i cr = _mm_set1_epi8('\r'), newline = _mm_set1_epi8('\n');
+        for (; end - p >= 16; p += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i nl = _mm_cmpeq_epi8(block, newline);
+            __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+                                      _mm_or_si128(_mm_cmpeq_epi8(block, cr), nl));
+            unsigned stop = ~unsigned(_mm_movemask_epi8(ws)) & 0xFFFFu;
+            if (stop_in_block<unsigned>(stop, _mm_movemask_epi8(nl), p, lines))
+                return p;
+        }
+        return skip_whitespace_scalar(p, end, lines);
+    }
+
+    const char *find_char_sse2(const char *p, const char *end, char c, int &lines) {
+        const __m128i target = _mm_set1_epi8(c), newline = _mm_set1_epi8('\n');
+        for (; end - p >= 16; p += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            unsigned stop = _mm_movemask_epi8(_mm_cmpeq_epi8(block, target));
+            if (stop_in_block<unsigned>(stop, _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)), p, lines))
+                return p;
+        }
+        return find_char_scalar(p, end, c, lines);
+    }
+
+    __attribute__((target("avx2")))
+    const char *skip_whitespace_avx2(const char *p, const char *end, int &lines) {
+        const __m256i space = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t');
+        const __m256i cr = _mm256_set1_epi8('\r'), newline = _mm256_set1_epi8('\n');
+        for (; end - p >= 32; p += 32) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            __m256i nl = _mm256_cmpeq_epi8(block, newline);
+            __m256i ws = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(block, cr), nl));
+            unsigned stop = ~unsigned(_mm256_movemask_epi8(ws));
+            if (stop_in_block<unsigned long long>(stop, unsigned(_mm256_movemask_epi8(nl)), p, lines))
+                return p;
+        }
+        return skip_whitespace_sse2(p, end, lines);
+    }
+
+    __attribute__((target("avx2")))
+    const char *find_char_avx2(const char *p, const char *end, char c, int &lines) {
+        const __m256i target = _mm256_set1_epi8(c), newline = _mm256_set1_epi8('\n');
+        for (; end - p >= 32; p += 32) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            unsigned stop = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, target));
+            unsigned nl = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline));
+            if (stop_in_block<unsigned long long>(stop, nl, p, lines))
+                return p;
+        }
+        return find_char_sse2(p, end, c, lines);
+    }
+
+#endif
+
+    const Lox::ScanKernels KERNELS[] = {
+            {Lox::SimdLevel::SCALAR, "scalar", skip_whitespace_scalar, find_char_scalar},
+#ifdef LOX_SCAN_X86
+            {Lox::SimdLevel::SSE2,   "sse2",   skip_whitespace_sse2,   find_char_sse2},
+            {Lox::SimdLevel::AVX2,   "avx2",   skip_whitespace_avx2,   find_char_avx2},
+#endif
+    };
+}
+
+Lox::SimdLevel Lox::detect_simd_level() {
+#ifdef LOX_SCAN_X86
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return SimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse2"))
+            return SimdLevel::SSE2;
+        return SimdLevel::SCALAR;
+    }();
+    return level;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+const Lox::ScanKernels &Lox::scan_kernels(SimdLevel level) {
+    if (level > detect_simd_level())
+        level = detect_simd_level();
+    return KERNELS[static_cast<int>(level)];
+}
+
+const Lox::ScanKernels &Lox::scan_kernels() {
+    static const ScanKernels &kernels = scan_kernels(detect_simd_level());
+    return kernels;
+}
@@ -0,0 +1,316 @@
+#include "Server.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "ProgramCache.h"
+
+namespace Lox {
+
+    static bool read_all(int fd, void *data, size_t size) {
+        auto *bytes = static_cast<char *>(data);
+        while (size > 0) {
+            ssize_t n = ::read(fd, bytes, size);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            bytes += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    // MSG_NOSIGNAL, a peer that went away is an error return rather than SIGPIPE
+    static bool write_all(int fd, const void *data, size_t size) {
+        auto *bytes = static_cast<const char *>(data);
+        while (size > 0) {
+            ssize_t n = ::send(fd, bytes, size, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            bytes += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    static bool read_string(int fd, std::string &string, uint32_t max) {
+        uint32_t size;
+        if (!read_all(fd, &size, sizeof size) || size > max)
+            return false;
+        string.resize(size);
+        return read_all(fd, string.data(), size);
+    }
+
+    static bool write_string(int fd, const std::string &string) {
+        auto size = (uint32_t) string.size();
+        return write_all(fd, &size, sizeof size) && write_all(fd, string.data(), size);
+    }
+
+    static bool unix_address(const std::string &path, sockaddr_un &address) {
+        if (path.size() >= sizeof address.sun_path) {
+            errno = ENAMETOOLONG;
+            return false;
+        }
+        std::memset(&address, 0, sizeof address);
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+
+    Server::Server(std::string socket_path, BatchOptions options) : socket_path(std::move(socket_path)),
+                                                                    options(options) {}
+
+    Server::~Server() {
+        if (listener >= 0) {
+            ::close(listener);
+            ::unlink(socket_path.c_str());
+        }
+        for (int fd: wake) {
+            if (fd >= 0)
+                ::close(fd);
+        }
+    }
+
+    bool Server::listen() {
+        sockaddr_un address{};
+        if (!unix_address(socket_path, address))
+            return false;
+        if (wake[0] < 0 && ::pipe2(wake, O_CLOEXEC | O_NONBLOCK) < 0)
+            return false;
+        listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if (listener < 0)
+            return false;
+        ::unlink(socket_path.c_str());
+        if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof address) < 0 ||
+            ::listen(listener, SOMAXCONN) < 0) {
+            int error = errno;
+            ::close(listener);
+            listener = -1;
+            errno = error;
+            return false;
+        }
+        return true;
+    }
+
+    void Server::serve() {
+        unsigned jobs = job_count(options);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < jobs; t++)
+            workers.emplace_back([this] { work(); });
+        // connections between requests, polled together with the listener and the wake pipe
+        std::vector<int> idle;
+        std::vector<pollfd> polled;
+        while (true) {
+            polled.assign({{listener, POLLIN, 0}, {wake[0], POLLIN, 0}});
+            for (int connection: idle)
+                polled.push_back({connection, POLLIN, 0});
+            if (::poll(polled.data(), polled.size(), -1) < 0) {
+                if (errno == EINTR)
+                    continue;
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+                break;
+            }
+            char drained[64];
+            while (::read(wake[0], drained, sizeof drained) > 0);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping)
+                break;
+            // a connection that has a request, or was closed, goes to a worker, which finds out which
+            idle.clear();
+            for (size_t i = 2; i < polled.size(); i++) {
+                if (polled[i].revents) {
+                    connections.push_back(polled[i].fd);
+                    connection_ready.notify_one();
+                } else {
+                    idle.push_back(polled[i].fd);
+                }
+            }
+            idle.insert(idle.end(), returned.begin(), returned.end());
+            returned.clear();
+            if (polled[0].revents) {
+                int connection;
+                while ((connection = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+                    timeval timeout{REQUEST_TIMEOUT_SECONDS, 0};
+                    ::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+                    ::setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+                    idle.push_back(connection);
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED &&
+                    errno != EMFILE && errno != ENFILE) {
+                    stopping = true;
+                    break;
+                }
+            }
+        }
+        connection_ready.notify_all();
+        for (auto &worker: workers)
+            worker.join();
+        for (auto *list: {&idle, &returned}) {
+            for (int connection: *list)
+                ::close(connection);
+            list->clear();
+        }
+        for (int connection: connections)
+            ::close(connection);
+        connections.clear();
+    }
+
+    void Server::stop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        // wakes serve from poll, and the workers from reading the rest of a request
+        wake_serve();
+        for (int connection: active)
+            ::shutdown(connection, SHUT_RD);
+        connection_ready.notify_all();
+    }
+
+    void Server::wake_serve() {
+        char byte = 0;
+        // the pipe being full already wakes serve
+        while (::write(wake[1], &byte, 1) < 0 && errno == EINTR);
+    }
+
+    void Server::work() {
+        std::ostringstream out, err;
+        Isolate isolate(out, err);
+        configure(isolate, options);
+        while (true) {
+            int connection;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                connection_ready.wait(lock, [&] { return stopping || !connections.empty(); });
+                if (stopping)
+                    return;
+                connection = connections.front();
+                connections.pop_front();
+                active.push_back(connection);
+            }
+            bool open = handle(connection, isolate, out, err);
+            std::lock_guard<std::mutex> lock(mutex);
+            active.erase(std::find(active.begin(), active.end(), connection));
+            if (open && !stopping) {
+                returned.push_back(connection);
+                wake_serve();
+            } else {
+                ::close(connection);
+            }
+        }
+    }
+
+    bool Server::handle(int connection, Isolate &isolate, std::ostringstream &out, std::ostringstream &err) {
+        char kind;
+        std::string payload;
+        if (!read_all(connection, &kind, 1) || !read_string(connection, payload, MAX_REQUEST))
+            return false;
+        auto start = std::chrono::steady_clock::now();
+        Isolate::Status status = Isolate::Status::NO_INPUT;
+        std::optional<Source> source;
+        if (kind == 's')
+            source = Source(std::move(payload));
+        else if (kind == 'p')
+            source = Source::open(payload);
+        else
+            return false;
+        if (!source) {
+            err << "Cannot open input file " << payload << std::endl;
+        } else if (auto program = program_for(std::move(*source), isolate)) {
+            status = isolate.run(program);
+        } else {
+            status = Isolate::Status::COMPILE_ERROR;
+        }
+        // the next request starts from fresh globals, whatever this one left behind
+        isolate.reset();
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        auto status_byte = (uint8_t) status;
+        auto micros = (uint32_t) std::min(elapsed.count(), 4e9);
+        bool sent = write_all(connection, &status_byte, 1) && write_all(connection, &micros, sizeof micros) &&
+                    write_string(connection, out.str()) && write_string(connection, err.str());
+        out.str("");
+        err.str("");
+        return sent;
+    }
+
+    std::shared_ptr<const Program> Server::program_for(Source source, Isolate &isolate) {
+        uint64_t hash = ProgramCache::hash_source(source.view());
+        {
+            std::lock_guard<std::mutex> lock(programs_mutex);
+            auto itr = programs.find(hash);
+            if (itr != programs.end() && itr->second->source.view() == source.view())
+                return itr->second;
+        }
+        std::shared_ptr<const Program> program = isolate.compile(std::move(source));
+        if (program) {
+            std::lock_guard<std::mutex> lock(programs_mutex);
+            if (programs.size() >= MAX_PROGRAMS)
+                programs.clear();
+            programs[hash] = program;
+        }
+        return program;
+    }
+
+    Client::~Client() {
+        if (socket >= 0)
+            ::close(socket);
+    }
+
+    bool Client::connect(const std::string &socket_path) {
+        sockaddr_un address{};
+        if (!unix_address(socket_path, address))
+            return false;
+        socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (socket < 0)
+            return false;
+        if (::connect(socket, reinterpret_cast<sockaddr *>(&address), sizeof address) < 0) {
+            int error = errno;
+            ::close(socket);
+            socket = -1;
+            errno = error;
+            return false;
+        }
+        return true;
+    }
+
+    std::optional<ScriptResult> Client::request(char kind, const std::string &payload) {
+        ScriptResult result;
+        uint8_t status;
+        uint32_t micros;
+        if (!write_all(socket, &kind, 1) || !write_string(socket, payload) || !read_all(socket, &status, 1) ||
+            !read_all(socket, &micros, sizeof micros) || !read_string(socket, result.out, UINT32_MAX) ||
+            !read_string(socket, result.err, UINT32_MAX))
+            return std::nullopt;
+        result.status = static_cast<Isolate::Status>(status);
+        result.milliseconds = micros / 1000.0;
+        return result;
+    }
+
+    std::optional<ScriptResult> Client::run(const std::string &source) {
+        return request('s', source);
+    }
+
+    std::optional<ScriptResult> Client::run_file(const std::string &path) {
+        std::string absolute = path;
+        if (path.empty() || path[0] != '/') {
+            char directory[4096];
+            if (::getcwd(directory, sizeof directory))
+                absolute = std::string(directory) + "/" + path;
+        }
+        auto result = request('p', absolute);
+        if (result)
+            result->path = path;
+        return result;
+    }
+
+} // Lox
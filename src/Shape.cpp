@@ -0,0 +1,42 @@
+#include "Shape.h"
+#include <atomic>
+
+namespace Lox {
+
+    const Shape *Shape::empty() {
+        static const Shape *root = new Shape();
+        return root;
+    }
+
+    const Shape *Shape::add(LoxString *name) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &next = transitions[name];
+        if (!next) {
+            next.reset(new Shape());
+            next->names = names;
+            next->names.push_back(name);
+        }
+        return next.get();
+    }
+
+    bool Fields::set_miss(PropertyCache &cache, Value value) {
+        int slot = shape->find(cache.name);
+        PropertyCache::Entry entry{shape, shape, 0, nullptr, (uint32_t) slot};
+        if (slot < 0)
+            entry = {shape, shape->add(cache.name), 0, nullptr, shape->field_count()};
+        if (!cache.megamorphic)
+            cache.remember(entry);
+        if (slot >= 0) {
+            values[slot] = value;
+            return false;
+        }
+        add(entry.next, value);
+        return true;
+    }
+
+    uint64_t next_class_id() {
+        static std::atomic<uint64_t> last_id{0};
+        return ++last_id;
+    }
+
+} // Lox
@@ -0,0 +1,81 @@
+#include "Source.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include "utils.h"
+
+namespace Lox {
+
+    static std::string read_all(int fd) {
+        std::string text;
+        char buffer[64 * 1024];
+        while (true) {
+            ssize_t count = read(fd, buffer, sizeof(buffer));
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count <= 0)
+                break;
+            text.append(buffer, count);
+        }
+        return text;
+    }
+
+    Source Source::from_file(const std::string &path) {
+        if (path == "-")
+            return Source(read_all(STDIN_FILENO));
+        std::optional<Source> source = open(path);
+        if (!source)
+            Lox::error("Cannot open input file", path);
+        return std::move(*source);
+    }
+
+    std::optional<Source> Source::open(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return std::nullopt;
+        Source source;
+        struct stat info{};
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                // scripts are scanned front to back once
+                madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+                source.mapping = mapping;
+                source.mapping_size = info.st_size;
+                close(fd);
+                return source;
+            }
+        }
+        source.text = read_all(fd);
+        close(fd);
+        return source;
+    }
+
+    Source::Source(Source &&other) noexcept: text(std::move(other.text)), mapping(other.mapping),
+                                             mapping_size(other.mapping_size) {
+        other.mapping = nullptr;
+        other.mapping_size = 0;
+    }
+
+    Source &Source::operator=(Source &&other) noexcept {
+        if (this != &other) {
+            unmap();
+            text = std::move(other.text);
+            mapping = std::exchange(other.mapping, nullptr);
+            mapping_size = std::exchange(other.mapping_size, 0);
+        }
+        return *this;
+    }
+
+    void Source::unmap() {
+        if (mapping)
+            munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+    }
+
+} // Lox
@@ -0,0 +1,644 @@
+#include "VM.h"
+#include <iostream>
+#include "Clock.h"
+#include "Compiler.h"
+#include "lox.h"
+#include "utils.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LOX_COMPUTED_GOTO
+#endif
+
+namespace Lox {
+
+    VM::VM(std::ostream &out) : stack(new Value[STACK_MAX]), frames(new CallFrame[FRAMES_MAX]), out(out) {
+        stack_top = stack.get();
+        define_natives();
+    }
+
+    VM::~VM() = default;
+
+    void VM::define_natives() {
+        define_native("clock", clock_native, 0);
+    }
+
+    void VM::reset_globals() {
+        globals.clear();
+        global_names.clear();
+        global_defined.clear();
+        global_slots.clear();
+        reset_stack();
+        define_natives();
+        heap.collect();
+    }
+
+    void VM::reset_stack() {
+        while (stack_top > stack.get()) *--stack_top = Value();
+        frame_count = 0;
+        open_upvalues = nullptr;
+    }
+
+    int VM::global_slot(std::string_view name) {
+        std::string key(name);
+        auto itr = global_slots.find(key);
+        if (itr != global_slots.end())
+            return itr->second;
+        int slot = (int) globals.size();
+        global_slots.emplace(key, slot);
+        globals.push_back(Value::uninitialized());
+        global_names.push_back(key);
+        global_defined.push_back(false);
+        return slot;
+    }
+
+    ObjFunction *VM::new_function() {
+        return heap.allocate<ObjFunction>();
+    }
+
+    void VM::mark_roots(Heap &heap) {
+        for (Value *slot = stack.get(); slot < stack_top; slot++)
+            heap.mark_value(*slot);
+        for (int i = 0; i < frame_count; i++)
+            heap.mark_object(frames[i].closure);
+        for (ObjUpvalue *upvalue = open_upvalues; upvalue; upvalue = upvalue->next_open)
+            heap.mark_object(upvalue);
+        for (auto &global: globals)
+            heap.mark_value(global);
+    }
+
+    void VM::define_native(const std::string &name, NativeFn function, int arity) {
+        int slot = global_slot(name);
+        globals[slot] = Value((Obj *) heap.allocate<ObjNative>(function, arity));
+        global_defined[slot] = true;
+    }
+
+    void VM::interpret(const Program &program, bool print_expressions) {
+        // the functions being compiled aren't reachable from any root until the script closure is on the stack
+        heap.pause_collection();
+        Compiler compiler(*this, print_expressions);
+        ObjFunction *script = compiler.compile(program.statements);
+        if (!script) {
+            heap.resume_collection();
+            return;
+        }
+        ObjClosure *closure = heap.allocate<ObjClosure>(script);
+        *stack_top++ = Value((Obj *) closure);
+        heap.resume_collection();
+        try {
+            call(closure, 0);
+            run();
+        }
+        catch (RuntimeException &e) {
+            Lox::runtime_error(e);
+            reset_stack();
+        }
+    }
+
+    RuntimeException VM::error(const std::string &message) {
+        CallFrame &frame = frames[frame_count - 1];
+        const Chunk &chunk = frame.closure->function->chunk;
+        int line = chunk.get_line(frame.ip - chunk.code.data() - 1);
+        return RuntimeException(Token(T_EOF, "", line), message);
+    }
+
+    void VM::call(ObjClosure *closure, int arg_count) {
+        if (arg_count != closure->function->arity) {
+            throw error("Expected " + to_string(closure->function->arity) + " arguments but got " +
+                        to_string(arg_count) + ".");
+        }
+        if (frame_count == FRAMES_MAX) {
+            throw error("Stack overflow.");
+        }
+        CallFrame &frame = frames[frame_count++];
+        frame.closure = closure;
+        frame.ip = closure->function->chunk.code.data();
+        frame.slots = stack_top - arg_count - 1;
+    }
+
+    void VM::call_value(const Value &callee, int arg_count) {
+        if (callee.is_obj()) {
+            Obj *object = callee.as_obj();
+            if (object->type == ObjType::CLOSURE) {
+                call((ObjClosure *) object, arg_count);
+                return;
+            }
+            if (object->type == ObjType::BOUND_METHOD) {
+                auto *bound = (ObjBoundMethod *) object;
+                // the receiver takes the callee's slot, its class keeps the method alive
+                stack_top[-arg_count - 1] = bound->receiver;
+                call(bound->method, arg_count);
+                return;
+            }
+            if (object->type == ObjType::CLASS) {
+                auto *klass = (ObjClass *) object;
+                // the instance replaces its class, which it references
+                stack_top[-arg_count - 1] = Value((Obj *) heap.allocate<ObjInstance>(klass));
+                if (klass->initializer) {
+                    call(klass->initializer, arg_count);
+                } else if (arg_count != 0) {
+                    throw error("Expected 0 arguments but got " + to_string(arg_count) + ".");
+                }
+                return;
+            }
+            if (object->type == ObjType::NATIVE) {
+                auto *native = (ObjNative *) object;
+                if (arg_count != native->arity) {
+                    throw error("Expected " + to_string(native->arity) + " arguments but got " +
+                                to_string(arg_count) + ".");
+                }
+                Value result = native->function(arg_count, stack_top - arg_count);
+                Value *callee_slot = stack_top - arg_count - 1;
+                while (stack_top > callee_slot) *--stack_top = Value();
+                *stack_top++ = std::move(result);
+                return;
+            }
+        }
+        throw error("Can only call functions and classes.");
+    }
+
+    ObjUpvalue *VM::capture_upvalue(Value *local) {
+        // open upvalues are sorted by stack slot, innermost first
+        ObjUpvalue *previous = nullptr;
+        ObjUpvalue *upvalue = open_upvalues;
+        while (upvalue && upvalue->location > local) {
+            previous = upvalue;
+            upvalue = upvalue->next_open;
+        }
+        if (upvalue && upvalue->location == local)
+            return upvalue;
+        ObjUpvalue *created = heap.allocate<ObjUpvalue>(local);
+        created->next_open = upvalue;
+        if (previous) {
+            previous->next_open = created;
+        } else {
+            open_upvalues = created;
+        }
+        return created;
+    }
+
+    void VM::close_upvalues(Value *last) {
+        while (open_upvalues && open_upvalues->location >= last) {
+            ObjUpvalue *upvalue = open_upvalues;
+            upvalue->closed = std::move(*upvalue->location);
+            upvalue->location = &upvalue->closed;
+            open_upvalues = upvalue->next_open;
+        }
+    }
+
+    void VM::run() {
+        CallFrame *frame;
+        uint8_t *ip;
+        Value *slots;
+        const Value *constants;
+        PropertyCache *caches;
+        Value *global_values = globals.data();
+
+#define READ_BYTE() (*ip++)
+#define READ_SHORT() (ip += 2, (uint16_t) ((ip[-2] << 8) | ip[-1]))
+#define LOAD_FRAME() do { \
+            frame = &frames[frame_count - 1]; \
+            ip = frame->ip; \
+            slots = frame->slots; \
+            constants = frame->closure->function->chunk.constants.data(); \
+            caches = frame->closure->function->chunk.caches.data(); \
+        } while (false)
+#define PUSH(value) (*stack_top++ = (value))
+#define DROP() (*--stack_top = Value())
+#define RUNTIME_ERROR(message) do { frame->ip = ip; throw error(message); } while (false)
+#define NUMBER_OPERANDS() do { \
+            if (!stack_top[-1].is_number() || !stack_top[-2].is_number()) \
+                RUNTIME_ERROR("Operands must be numbers"); \
+        } while (false)
+#define BINARY_OP(op) do { \
+            NUMBER_OPERANDS(); \
+            stack_top[-2] = Value(stack_top[-2].as_number() op stack_top[-1].as_number()); \
+            stack_top--; \
+        } while (false)
+
+#ifdef LOX_COMPUTED_GOTO
+        static void *dispatch_table[] = {
+                &&op_OP_CONSTANT, &&op_OP_NIL, &&op_OP_TRUE, &&op_OP_FALSE, &&op_OP_UNINITIALIZED, &&op_OP_POP,
+                &&op_OP_GET_LOCAL, &&op_OP_SET_LOCAL, &&op_OP_GET_GLOBAL, &&op_OP_DEFINE_GLOBAL, &&op_OP_SET_GLOBAL,
+                &&op_OP_GET_UPVALUE, &&op_OP_SET_UPVALUE, &&op_OP_EQUAL, &&op_OP_NOT_EQUAL, &&op_OP_GREATER,
+                &&op_OP_GREATER_EQUAL, &&op_OP_LESS, &&op_OP_LESS_EQUAL, &&op_OP_ADD, &&op_OP_SUBTRACT,
+                &&op_OP_MULTIPLY, &&op_OP_DIVIDE, &&op_OP_NOT, &&op_OP_NEGATE, &&op_OP_PRINT, &&op_OP_JUMP,
+                &&op_OP_JUMP_IF_FALSE, &&op_OP_JUMP_IF_TRUE, &&op_OP_LOOP, &&op_OP_CALL, &&op_OP_CLOSURE,
+                &&op_OP_CLOSE_UPVALUE, &&op_OP_CLASS, &&op_OP_INHERIT, &&op_OP_METHOD, &&op_OP_GET_PROPERTY,
+                &&op_OP_SET_PROPERTY, &&op_OP_INVOKE, &&op_OP_GET_SUPER, &&op_OP_SUPER_INVOKE, &&op_OP_RETURN,
+                &&op_OP_TAIL_CALL,
+        };
+        static_assert(sizeof(dispatch_table) / sizeof(dispatch_table[0]) == OP_TAIL_CALL + 1,
+                      "dispatch table out of sync with OpCode");
+#define DISPATCH() goto *dispatch_table[READ_BYTE()]
+#define TARGET(op) op_##op
+#else
+#define DISPATCH() break
+#define TARGET(op) case op
+#endif
+
+        LOAD_FRAME();
+#ifdef LOX_COMPUTED_GOTO
+        DISPATCH();
+#else
+        for (;;) {
+            switch (READ_BYTE()) {
+#endif
+        TARGET(OP_CONSTANT):
+        {
+            PUSH(constants[READ_SHORT()]);
+            DISPATCH();
+        }
+        TARGET(OP_NIL):
+        {
+            PUSH(Value());
+            DISPATCH();
+        }
+        TARGET(OP_TRUE):
+        {
+            PUSH(Value(true));
+            DISPATCH();
+        }
+        TARGET(OP_FALSE):
+        {
+            PUSH(Value(false));
+            DISPATCH();
+        }
+        TARGET(OP_UNINITIALIZED):
+        {
+            PUSH(Value::uninitialized());
+            DISPATCH();
+        }
+        TARGET(OP_POP):
+        {
+            DROP();
+            DISPATCH();
+        }
+        TARGET(OP_GET_LOCAL):
+        {
+            const Value &value = slots[READ_BYTE()];
+            if (value.is_uninitialized())
+                RUNTIME_ERROR("Can't access undefined variable");
+            PUSH(value);
+            DISPATCH();
+        }
+        TARGET(OP_SET_LOCAL):
+        {
+            slots[READ_BYTE()] = stack_top[-1];
+            DISPATCH();
+        }
+        TARGET(OP_GET_GLOBAL):
+        {
+            uint16_t slot = READ_SHORT();
+            const Value &value = global_values[slot];
+            if (value.is_uninitialized()) {
+                if (!global_defined[slot])
+                    RUNTIME_ERROR("Undefined variable '" + global_names[slot] + "'.");
+                RUNTIME_ERROR("Can't access undefined variable");
+            }
+            PUSH(value);
+            DISPATCH();
+        }
+        TARGET(OP_DEFINE_GLOBAL):
+        {
+            uint16_t slot = READ_SHORT();
+            global_values[slot] = std::move(*--stack_top);
+            global_defined[slot] = true;
+            DISPATCH();
+        }
+        TARGET(OP_SET_GLOBAL):
+        {
+            uint16_t slot = READ_SHORT();
+            if (!global_defined[slot])
+                RUNTIME_ERROR("Undefined variable " + global_names[slot] + ".");
+            global_values[slot] = stack_top[-1];
+            DISPATCH();
+        }
+        TARGET(OP_GET_UPVALUE):
+        {
+            const Value &value = *frame->closure->upvalues[READ_BYTE()]->location;
+            if (value.is_uninitialized())
+                RUNTIME_ERROR("Can't access undefined variable");
+            PUSH(value);
+            DISPATCH();
+        }
+        TARGET(OP_SET_UPVALUE):
+        {
+            *frame->closure->upvalues[READ_BYTE()]->location = stack_top[-1];
+            DISPATCH();
+        }
+        TARGET(OP_EQUAL):
+        {
+            bool equal = values_equal(stack_top[-2], stack_top[-1]);
+            DROP();
+            stack_top[-1] = Value(equal);
+            DISPATCH();
+        }
+        TARGET(OP_NOT_EQUAL):
+        {
+            bool equal = values_equal(stack_top[-2], stack_top[-1]);
+            DROP();
+            stack_top[-1] = Value(!equal);
+            DISPATCH();
+        }
+        TARGET(OP_GREATER):
+        {
+            BINARY_OP(>);
+            DISPATCH();
+        }
+        TARGET(OP_GREATER_EQUAL):
+        {
+            BINARY_OP(>=);
+            DISPATCH();
+        }
+        TARGET(OP_LESS):
+        {
+            BINARY_OP(<);
+            DISPATCH();
+        }
+        TARGET(OP_LESS_EQUAL):
+        {
+            BINARY_OP(<=);
+            DISPATCH();
+        }
+        TARGET(OP_ADD):
+        {
+            Value &left = stack_top[-2];
+            Value &right = stack_top[-1];
+            if (left.is_number() && right.is_number()) {
+                left = Value(left.as_number() + right.as_number());
+                stack_top--;
+                DISPATCH();
+            }
+            if (left.is_string() && right.is_string()) {
+                left = Value(heap.make_string(left.as_string() + right.as_string()));
+            } else if (left.is_string() && right.is_number()) {
+                left = Value(heap.make_string(left.as_string() + to_string(right.as_number())));
+            } else if (left.is_number() && right.is_string()) {
+                left = Value(heap.make_string(to_string(left.as_number()) + right.as_string()));
+            } else {
+                RUNTIME_ERROR("Operands must be numbers");
+            }
+            DROP();
+            DISPATCH();
+        }
+        TARGET(OP_SUBTRACT):
+        {
+            BINARY_OP(-);
+            DISPATCH();
+        }
+        TARGET(OP_MULTIPLY):
+        {
+            BINARY_OP(*);
+            DISPATCH();
+        }
+        TARGET(OP_DIVIDE):
+        {
+            NUMBER_OPERANDS();
+            if (stack_top[-1].as_number() == 0)
+                RUNTIME_ERROR("Division by 0 error");
+            BINARY_OP(/);
+            DISPATCH();
+        }
+        TARGET(OP_NOT):
+        {
+            stack_top[-1] = Value(!is_truthy(stack_top[-1]));
+            DISPATCH();
+        }
+        TARGET(OP_NEGATE):
+        {
+            if (!stack_top[-1].is_number())
+                RUNTIME_ERROR("Operand must be a number");
+            stack_top[-1] = Value(-stack_top[-1].as_number());
+            DISPATCH();
+        }
+        TARGET(OP_PRINT):
+        {
+            out << get_string_repr(stack_top[-1]) << std::endl;
+            DROP();
+            DISPATCH();
+        }
+        TARGET(OP_JUMP):
+        {
+            uint16_t offset = READ_SHORT();
+            ip += offset;
+            DISPATCH();
+        }
+        TARGET(OP_JUMP_IF_FALSE):
+        {
+            uint16_t offset = READ_SHORT();
+            if (!is_truthy(stack_top[-1])) ip += offset;
+            DISPATCH();
+        }
+        TARGET(OP_JUMP_IF_TRUE):
+        {
+            uint16_t offset = READ_SHORT();
+            if (is_truthy(stack_top[-1])) ip += offset;
+            DISPATCH();
+        }
+        TARGET(OP_LOOP):
+        {
+            uint16_t offset = READ_SHORT();
+            ip -= offset;
+            DISPATCH();
+        }
+        TARGET(OP_CALL):
+        {
+            int arg_count = READ_BYTE();
+            frame->ip = ip;
+            call_value(stack_top[-1 - arg_count], arg_count);
+            LOAD_FRAME();
+            DISPATCH();
+        }
+        TARGET(OP_CLOSURE):
+        {
+            auto *function = (ObjFunction *) constants[READ_SHORT()].as_obj();
+            ObjClosure *closure = heap.allocate<ObjClosure>(function);
+            PUSH(Value((Obj *) closure));
+            for (int i = 0; i < function->upvalue_count; i++) {
+                uint8_t is_local = READ_BYTE();
+                uint8_t index = READ_BYTE();
+                closure->upvalues[i] = is_local ? capture_upvalue(slots + index)
+                                                : frame->closure->upvalues[index];
+            }
+            DISPATCH();
+        }
+        TARGET(OP_CLOSE_UPVALUE):
+        {
+            close_upvalues(stack_top - 1);
+            DROP();
+            DISPATCH();
+        }
+        TARGET(OP_CLASS):
+        {
+            auto *name = (LoxString *) constants[READ_SHORT()].as_obj();
+            PUSH(Value((Obj *) heap.allocate<ObjClass>(name->chars)));
+            DISPATCH();
+        }
+        TARGET(OP_INHERIT):
+        {
+            // the superclass stays below as the local `super`
+            const Value &superclass = stack_top[-2];
+            if (!superclass.is_obj() || superclass.as_obj()->type != ObjType::CLASS)
+                RUNTIME_ERROR("Superclass must be a class.");
+            auto *parent = (ObjClass *) superclass.as_obj();
+            auto *klass = (ObjClass *) stack_top[-1].as_obj();
+            klass->methods = parent->methods;
+            klass->initializer = parent->initializer;
+            klass->field_hint = parent->field_hint;
+            DROP();
+            DISPATCH();
+        }
+        TARGET(OP_METHOD):
+        {
+            auto *name = (LoxString *) constants[READ_SHORT()].as_obj();
+            auto *method = (ObjClosure *) stack_top[-1].as_obj();
+            auto *klass = (ObjClass *) stack_top[-2].as_obj();
+            klass->methods[name] = method;
+            if (name->chars == "init")
+                klass->initializer = method;
+            DROP();
+            DISPATCH();
+        }
+        TARGET(OP_GET_PROPERTY):
+        {
+            PropertyCache &cache = caches[READ_SHORT()];
+            Value &object = stack_top[-1];
+            if (!object.is_obj() || object.as_obj()->type != ObjType::VM_INSTANCE)
+                RUNTIME_ERROR("Only instances have properties.");
+            auto *instance = (ObjInstance *) object.as_obj();
+            PropertyCache::Entry miss;
+            const PropertyCache::Entry *entry = instance->resolve(cache, miss);
+            if (!entry)
+                RUNTIME_ERROR("Undefined property '" + cache.name->chars + "'.");
+            if (!entry->method) {
+                object = instance->fields.values[entry->slot];
+                DISPATCH();
+            }
+            // the instance stays on the stack while the bound method is allocated
+            frame->ip = ip;
+            auto *bound = heap.allocate<ObjBoundMethod>(object, (ObjClosure *) entry->method);
+            stack_top[-1] = Value((Obj *) bound);
+            DISPATCH();
+        }
+        TARGET(OP_SET_PROPERTY):
+        {
+            PropertyCache &cache = caches[READ_SHORT()];
+            const Value &object = stack_top[-2];
+            if (!object.is_obj() || object.as_obj()->type != ObjType::VM_INSTANCE)
+                RUNTIME_ERROR("Only instances have fields.");
+            ((ObjInstance *) object.as_obj())->set(cache, stack_top[-1]);
+            stack_top[-2] = stack_top[-1];
+            DROP();
+            DISPATCH();
+        }
+        TARGET(OP_INVOKE):
+        {
+            PropertyCache &cache = caches[READ_SHORT()];
+            int arg_count = READ_BYTE();
+            Value &receiver = stack_top[-1 - arg_count];
+            if (!receiver.is_obj() || receiver.as_obj()->type != ObjType::VM_INSTANCE)
+                RUNTIME_ERROR("Only instances have properties.");
+            auto *instance = (ObjInstance *) receiver.as_obj();
+            PropertyCache::Entry miss;
+            const PropertyCache::Entry *entry = instance->resolve(cache, miss);
+            if (!entry)
+                RUNTIME_ERROR("Undefined property '" + cache.name->chars + "'.");
+            frame->ip = ip;
+            if (entry->method) {
+                call((ObjClosure *) entry->method, arg_count);
+            } else {
+                // a field holding something callable
+                receiver = instance->fields.values[entry->slot];
+                call_value(receiver, arg_count);
+            }
+            LOAD_FRAME();
+            DISPATCH();
+        }
+        TARGET(OP_GET_SUPER):
+        {
+            PropertyCache &cache = caches[READ_SHORT()];
+            auto *superclass = (ObjClass *) stack_top[-1].as_obj();
+            ObjClosure *method = superclass->super_method(cache);
+            if (!method)
+                RUNTIME_ERROR("Undefined property '" + cache.name->chars + "'.");
+            DROP();
+            // the receiver stays on the stack while the bound method is allocated
+            frame->ip = ip;
+            auto *bound = heap.allocate<ObjBoundMethod>(stack_top[-1], method);
+            stack_top[-1] = Value((Obj *) bound);
+            DISPATCH();
+        }
+        TARGET(OP_SUPER_INVOKE):
+        {
+            PropertyCache &cache = caches[READ_SHORT()];
+            int arg_count = READ_BYTE();
+            auto *superclass = (ObjClass *) stack_top[-1].as_obj();
+            ObjClosure *method = superclass->super_method(cache);
+            if (!method)
+                RUNTIME_ERROR("Undefined property '" + cache.name->chars + "'.");
+            DROP();
+            frame->ip = ip;
+            call(method, arg_count);
+            LOAD_FRAME();
+            DISPATCH();
+        }
+        TARGET(OP_RETURN):
+        {
+            Value result = std::move(*--stack_top);
+            close_upvalues(slots);
+            frame_count--;
+            while (stack_top > slots) DROP();
+            if (frame_count == 0)
+                return;
+            PUSH(std::move(result));
+            LOAD_FRAME();
+            DISPATCH();
+        }
+        TARGET(OP_TAIL_CALL):
+        {
+            int arg_count = READ_BYTE();
+            frame->ip = ip;
+            Value *callee = stack_top - 1 - arg_count;
+            ObjClosure *closure = nullptr;
+            if (callee->is_obj() && callee->as_obj()->type == ObjType::CLOSURE)
+                closure = (ObjClosure *) callee->as_obj();
+            else if (callee->is_obj() && callee->as_obj()->type == ObjType::BOUND_METHOD)
+                closure = ((ObjBoundMethod *) callee->as_obj())->method;
+            // anything else, or a wrong number of arguments, is an OP_CALL that reports its errors here. The
+            // OP_RETURN after it returns the result
+            if (!closure || closure->function->arity != arg_count) {
+                call_value(*callee, arg_count);
+                LOAD_FRAME();
+                DISPATCH();
+            }
+            // the receiver takes the callee's slot, its class keeps the method alive
+            if (callee->as_obj()->type == ObjType::BOUND_METHOD)
+                *callee = ((ObjBoundMethod *) callee->as_obj())->receiver;
+            // the callee and its arguments replace the frame of the function returning
+            close_upvalues(slots);
+            for (int i = 0; i <= arg_count; i++)
+                slots[i] = std::move(callee[i]);
+            while (stack_top > slots + arg_count + 1) DROP();
+            frame->closure = closure;
+            frame->ip = closure->function->chunk.code.data();
+            LOAD_FRAME();
+            DISPATCH();
+        }
+#ifndef LOX_COMPUTED_GOTO
+            }
+        }
+#endif
+
+#undef READ_BYTE
+#undef READ_SHORT
+#undef LOAD_FRAME
+#undef PUSH
+#undef DROP
+#undef RUNTIME_ERROR
+#undef NUMBER_OPERANDS
+#undef BINARY_OP
+#undef DISPATCH
+#undef TARGET
+    }
+
+} // Lox
@@ -47,10 +47,10 @@ inline bool starts_with(std::string to_find_in, std::string to_find) {
 }
 
 bool store_as_copy(string type) {
-    return type == "Token" || type == "std::any" || type == "std::string" || starts_with(type, "Lox::VecUniquePtr") ||
-           starts_with(type, "std::vector<Token>");
+    return type == "Token" || type == "Lox::Object" || type == "std::string" || starts_with(type, "Lox::NodeList");
 }
 
+// child nodes are plain pointers into the Program's arena, which owns them
 bool store_as_pointer(string type) {
     return type == "Expr" || type == "Stmt"||type=="FunctionExpr";
 }
@@ -60,8 +60,13 @@ bool store_as_pointer(string type) {
 //    return
 //}
 
+// fields after a ';' are not constructor arguments, they are filled in by later passes (e.g. the resolver)
 void define_type(ofstream &writer, string basename, string class_name, string field_list) {
-    vector<string> fields = split(field_list, ", ");
+    vector<string> parts = split(field_list, ";");
+    string ctor_fields = parts[0], resolved_fields = parts.size() > 1 ? parts[1] : "";
+    trim(ctor_fields);
+    trim(resolved_fields);
+    vector<string> fields = split(ctor_fields, ", ");
     writer << "class " << class_name << ": public " << basename << "{\n";
     writer << "   public:\n";
     string type, name;
@@ -72,7 +77,14 @@ void define_type(ofstream &writer, string basename, string class_name, string fi
             writer << "   " << type + " " + name << ";" << std::endl;
         } else if (store_as_pointer(type)) {
             writer << "   "
-                   << "std::unique_ptr<" + type + " > " + name << ";" << std::endl;
+                   << type + " *" + name << ";" << std::endl;
+        }
+    }
+    if (!resolved_fields.empty()) {
+        for (auto field: split(resolved_fields, ", ")) {
+            std::istringstream stream(field);
+            stream >> type >> name;
+            writer << "   " << type + " " + name << "{};" << std::endl;
         }
     }
     writer << "   public:\n";
@@ -84,7 +96,7 @@ void define_type(ofstream &writer, string basename, string class_name, string fi
         if (store_as_copy(type)) {
             writer << type + " " + name;
         } else if (store_as_pointer(type)) {
-            writer << "std::unique_ptr<" + type + " >& " + name;
+            writer << type + " *" + name;
         } else {
             std::cout << "WARNING: undefined storage type: " << type << std::endl;
         }
@@ -92,16 +104,17 @@ void define_type(ofstream &writer, string basename, string class_name, string fi
             writer << ",";
         }
     }
-    writer << "):";
+    writer << "):" << basename << "(" << basename << "Kind::" << class_name << ")";
     for (int i = 0; i < fields.size(); i++) {
+        if (i == 0) {
+            writer << ",";
+        }
         auto &field = fields[i];
         string name, type;
         std::istringstream stream(field);
         stream >> type >> name;
-        if (store_as_copy(type)) {
+        if (store_as_copy(type) || store_as_pointer(type)) {
             writer << name << "(" << name << ")";
-        } else if (store_as_pointer(type)) {
-            writer << name << "(std::move(" << name << "))";
         }
         // std::cout<<name<<std::endl;
         if (i != fields.size() - 1) {
@@ -142,13 +155,30 @@ void define_visitor(ofstream &writer, string base_name, vector<string> types) {
     writer << "};\n";
 }
 
+// a tag per node class, lets passes that can't recurse through accept() switch on the node type
+void define_kinds(ofstream &writer, string base_name, vector<string> types) {
+    writer << "enum class " << base_name << "Kind : uint8_t {\n";
+    for (auto type: types) {
+        std::istringstream ss(type);
+        std::string class_name;
+        std::getline(ss, class_name, ':');
+        trim(class_name);
+        writer << "   " << class_name << ",\n";
+    }
+    writer << "};\n";
+}
+
 void define_baseclass(ofstream &writer, string base_name) {
     writer << "class " << base_name << "{\n public:\n";
+    writer << "   const " << base_name << "Kind kind;\n";
 //    writer << "template<typename T>\n";
     writer << "   virtual void accept(" + base_name + "Visitor& visitor)=0;\n";
-    writer << "   virtual ~" + base_name + "()=default;\n";
     writer << "#define MAKE_VISITABLE_" + base_name + " virtual void accept(" + base_name +
               "Visitor& vis) override { vis.visit(this);}\n";
+    // nodes are released with their arena, never deleted through a base pointer
+    writer << " protected:\n";
+    writer << "   explicit " << base_name << "(" << base_name << "Kind kind):kind(kind){};\n";
+    writer << "   ~" + base_name + "()=default;\n";
     writer << "};\n";
 }
 
@@ -197,8 +227,7 @@ void define_ast(string output_dir, string basename, vector<string> types, vector
         exit(1);
     }
     writer << "#pragma once\n";
-    writer << "#include<any>\n";
-    writer << "#include<memory>\n";
+    writer << "#include \"Arena.h\"\n";
     writer << "#include \"types.h\"\n";
     writer << "#include \"token.h\"\n";
 
@@ -211,6 +240,7 @@ void define_ast(string output_dir, string basename, vector<string> types, vector
     ofstream writer_forward_decl(forward_decl_path);
     forward_decl_classes(writer_forward_decl, basename, types);
     define_visitor(writer, basename, types);
+    define_kinds(writer, basename, types);
     define_baseclass(writer, basename);
 
 
@@ -231,26 +261,31 @@ int main(int argc, char **argv) {
         exit(EX_USAGE);
     }
     string output_dir(argv[1]);
-    define_ast(output_dir, "Expr", {"Binary   : Expr left, Token oper, Expr right", "Grouping : Expr expression",
-                                    "Ternary: Expr condition, Expr left, Expr right", "Literal  : std::any value",
-                                    "Unary    : Token oper, Expr right",
+    define_ast(output_dir, "Expr", {"Binary   : Expr left, Token oper, Expr right; uint32_t specialization", "Grouping : Expr expression",
+                                    "Ternary: Expr condition, Expr left, Expr right", "Literal  : Lox::Object value",
+                                    "Unary    : Token oper, Expr right; uint32_t specialization",
                                     "Nothing: std::string nothing",
-                                    "Variable: Token name",
+                                    "Variable: Token name; Lox::Slot slot, uint32_t specialization",
                                     "Logical: Expr left, Token oper, Expr right",
-                                    "Assign: Token name, Expr value",
-                                    "Call: Expr callee, Token paren, Lox::VecUniquePtr<Expr> arguments",
-                                    "FunctionExpr: std::vector<Token> params, Lox::VecUniquePtr<Stmt> body"
+                                    "Assign: Token name, Expr value; Lox::Slot slot",
+                                    "Call: Expr callee, Token paren, Lox::NodeList<Expr*> arguments",
+                                    "FunctionExpr: Lox::NodeList<Token> params, Lox::NodeList<Stmt*> body; int num_slots, bool captured",
+                                    "Get: Expr object, Token name; uint32_t cache",
+                                    "Set: Expr object, Token name, Expr value; uint32_t cache",
+                                    "This: Token keyword; Lox::Slot slot",
+                                    "Super: Token keyword, Token method; Lox::Slot slot, Lox::Slot this_slot, uint32_t cache"
     }, {"#include \"Expr.fwd.hpp\"\n", "#include \"Stmt.fwd.hpp\"\n"});
     define_ast(output_dir, "Stmt", {
             "Expression : Expr expression",
             "Print      : Expr expression",
-            "Block: Lox::VecUniquePtr<Stmt> statements",
-            "Var : Token name, Expr initializer",
+            "Block: Lox::NodeList<Stmt*> statements; int num_slots, bool captured",
+            "Var : Token name, Expr initializer; Lox::Slot slot",
             "If : Expr condition, Stmt then_branch, Stmt else_branch",
             "While : Expr condition, Stmt body",
             "Break : std::string placeholder",
-            "Return : Token keyword, Expr value",
-            "Function: Token name, FunctionExpr fn_expr"
+            "Return : Token keyword, Expr value; bool tail_call",
+            "Function: Token name, FunctionExpr fn_expr; Lox::Slot slot",
+            "Class: Token name, Expr superclass, Lox::NodeList<Function*> methods; Lox::Slot slot"
 
     }, {"#include \"Expr.fwd.hpp\"\n", "#include \"Stmt.fwd.hpp\"\n"});
 
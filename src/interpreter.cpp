@@ -2,6 +2,7 @@
 // Created by Dipin Garg on 30-01-2023.
 //
 #include "interpreter.h"
+#include "Concurrency.h"
 #include <string>
 #include "LoxExceptions.h"
 #include <stdexcept>
@@ -15,6 +16,7 @@
 #include "Callable.h"
 #include "Clock.h"
 #include "LoxFunction.h"
+#include "LoxClass.h"
 
 using std::unique_ptr;
 namespace Lox {
@@ -25,105 +27,127 @@ namespace Lox {
         return get_expr_value();
     }
 
-    Object Interpreter::get_expr_value() {
-        Object obj = *value;
-        value.reset();
-//            std::cout<<"RESETTING Value "<<get_string_repr(obj)<<std::endl;
-        return obj;
-    }
-
-    void Interpreter::Return(Object value_) {
-//            std::cout<<"SETTING Value "<<get_string_repr(value_)<<std::endl;
-        value = std::make_unique<Object>(value_);
-    }
-
-    void Interpreter::interpret(VecUniquePtr<Stmt> &statements, bool print_expressions) {
+    void Interpreter::interpret(const Program &program, bool print_expressions) {
+        enter_program(program);
         try {
-            for (auto &stmt: statements.get()) {
-                execute(stmt.get());
-                if (print_expressions && value) {
+            for (auto stmt: program.statements) {
+                if (iterative) {
+                    auto expression = dynamic_cast<Expression *>(stmt);
+                    if (print_expressions && expression)
+                        print(evaluate_iteratively(expression->expression));
+                    else
+                        execute_iteratively(stmt);
+                    continue;
+                }
+                execute(stmt);
+                if (print_expressions && has_value) {
                     auto val = get_expr_value();
-                    std::cout << get_string_repr(val) << std::endl;
+                    print(val);
                 }
             }
 
 
         }
         catch (RuntimeException &e) {
+            reset_after_error();
             Lox::runtime_error(e);
         }
     }
 
+    void Interpreter::reset_after_error() {
+        environment = global;
+        environments.clear();
+        stack.clear();
+        tasks.clear();
+        saved_feedback.clear();
+        depth = 0;
+        completion = Completion::NORMAL;
+    }
+
     void Interpreter::visit(Var *stmt) {
-        Object value;
+        Object value = Object::uninitialized();
         if (stmt->initializer) {
-            value = evaluate(stmt->initializer.get());
+            value = evaluate(stmt->initializer);
         }
-        environment->define(stmt->name.lexeme, value);
+        define(stmt->slot, std::move(value));
 
     }
 
     void Interpreter::visit(While *stmt) {
-        try {
-            while (isTruthy(evaluate(stmt->condition.get()))) {
-                execute(stmt->body.get());
+        // the Optimizer drops conditions that are always true
+        while (!stmt->condition || isTruthy(evaluate(stmt->condition))) {
+            if (execute(stmt->body) != Completion::NORMAL) {
+                // a break is consumed here, a return keeps unwinding to the call
+                if (completion == Completion::BREAK)
+                    completion = Completion::NORMAL;
+                return;
             }
         }
-        catch (BreakException &e) {
-
-        }
     }
 
     void Interpreter::visit(Logical *expr) {
-        Object left = evaluate(expr->left.get());
+        Object left = evaluate(expr->left);
         if (expr->oper.type == OR) {
             if (isTruthy(left)) {
-                RETURN(left);
+                RETURN(std::move(left));
             }
         } else {
             if (!isTruthy(left)) {
-                RETURN(left);
+                RETURN(std::move(left));
             }
         }
-        RETURN(evaluate(expr->right.get()));
+        RETURN(evaluate(expr->right));
 
     }
 
     void Interpreter::visit(If *stmt) {
 
-        auto condition = evaluate(stmt->condition.get());
+        auto condition = evaluate(stmt->condition);
         if (isTruthy(condition)) {
-            execute(stmt->then_branch.get());
+            execute(stmt->then_branch);
         } else {
-            if (stmt->else_branch)execute(stmt->else_branch.get());
+            if (stmt->else_branch)execute(stmt->else_branch);
         }
 
 
     }
 
     void Interpreter::visit(Break *stmt) {
-        throw BreakException();
+        completion = Completion::BREAK;
     }
 
     void Interpreter::visit(Variable *expr) {
-        Object val = environment->get(expr->name);
+        if (!quickening) {
+            RETURN(lookup(expr->name, expr->slot));
+        }
+        Specialization &specialization = feedback->specializations[expr->specialization];
+        if (specialization == Specialization::DEFINED_GLOBAL) {
+            // `var a;` makes a global uninitialized again, lookup raises the error for that
+            const Object &val = global_values[global_index(expr->slot)];
+            if (!val.is_uninitialized()) {
+                RETURN(val);
+            }
+        }
+        const Object &val = lookup(expr->name, expr->slot);
+        if (expr->slot.is_global())
+            specialization = Specialization::DEFINED_GLOBAL;
         RETURN(val);
 //            RETURN(environment->get(expr->name));
     }
 
     void Interpreter::visit(Assign *expr) {
-        Object value = evaluate(expr->value.get());
-        environment->assign(expr->name, value);
+        Object value = evaluate(expr->value);
+        assign(expr->name, expr->slot, value);
         RETURN(value);
     }
 
     void Interpreter::visit(Expression *expr) {
-        RETURN(evaluate(expr->expression.get()));
+        RETURN(evaluate(expr->expression));
     }
 
     void Interpreter::visit(Print *stmt) {
-        Object val = evaluate(stmt->expression.get());
-        std::cout << get_string_repr(val) << std::endl;
+        Object val = evaluate(stmt->expression);
+        print(val);
     }
 
     void Interpreter::visit(Literal *expr) {
@@ -131,19 +155,19 @@ namespace Lox {
     }
 
     void Interpreter::visit(Grouping *expr) {
-        RETURN(evaluate(expr->expression.get()));
+        RETURN(evaluate(expr->expression));
 
     }
 
     void Interpreter::visit(Ternary *expr) {
 
-        Object condition_object = evaluate(expr->condition.get());
+        Object condition_object = evaluate(expr->condition);
         bool condition = isTruthy(condition_object);
         if (condition) {
-            RETURN(evaluate(expr->left.get()));
+            RETURN(evaluate(expr->left));
 
         }
-        RETURN(evaluate(expr->right.get()));
+        RETURN(evaluate(expr->right));
 
     }
 
@@ -151,13 +175,13 @@ namespace Lox {
         throw std::runtime_error("Runtime error");
     }
 
-    void Interpreter::check_number_operand(Token operator_token, Object &operand) {
-        if (lox_object_type<double>(operand))return;
+    void Interpreter::check_number_operand(const Token &operator_token, Object &operand) {
+        if (operand.is_number())return;
         throw RuntimeException(operator_token, "Operand must be a number");
     }
 
-    void Interpreter::check_number_operands(Token operator_token, Object &left, Object &right) {
-        if (lox_object_type<double>(left) && lox_object_type<double>(right))return;
+    void Interpreter::check_number_operands(const Token &operator_token, Object &left, Object &right) {
+        if (left.is_number() && right.is_number())return;
         throw RuntimeException(operator_token, "Operands must be numbers");
     }
 
@@ -167,18 +191,30 @@ namespace Lox {
         // see Knuth section 4.2.2 pages 217-218
     }
 
-    void Interpreter::check_not_zero(Token operator_token, double d) {
+    void Interpreter::check_not_zero(const Token &operator_token, double d) {
         if (isEqual(d, 0.00)) {
             throw RuntimeException(operator_token, "Division by 0 error");
         };
     }
 
     void Interpreter::visit(Unary *expr) {
-        Object right = evaluate(expr->right.get());
+        Object right = evaluate(expr->right);
+        if (quickening) {
+            Specialization &specialization = feedback->specializations[expr->specialization];
+            if (specialization == Specialization::NUMBER_NEGATE) {
+                if (right.is_number()) {
+                    RETURN(-right.as_number());
+                }
+                specialization = Specialization::GENERIC;
+            } else if (specialization == Specialization::UNINITIALIZED) {
+                bool negates_number = expr->oper.type == MINUS && right.is_number();
+                specialization = negates_number ? Specialization::NUMBER_NEGATE : Specialization::GENERIC;
+            }
+        }
         switch (expr->oper.type) {
             case MINUS:
                 check_number_operand(expr->oper, right);
-                RETURN(-std::any_cast<double>(right));
+                RETURN(-right.as_number());
 
             case BANG:
             RETURN(!isTruthy(right));
@@ -187,209 +223,488 @@ namespace Lox {
     }
 
     void Interpreter::visit(Block *stmt) {
-        Environment *env = new Environment(this->environment);
+        if (stmt->num_slots == 0) {
+            for (auto inner: stmt->statements) {
+                if (execute(inner) != Completion::NORMAL)
+                    return;
+            }
+            return;
+        }
+        Environment *env = new_environment(this->environment, stmt->num_slots);
         execute_block(stmt->statements, env);
+        if (!stmt->captured)
+            release_environment(env);
     }
 
-    void Interpreter::execute_block(VecUniquePtr<Stmt> &statements, Environment *env) {
+    Completion Interpreter::execute_block(NodeList<Stmt *> statements, Environment *env) {
 //            std::cout<<"Executing block\n";
-        Environment *previous = this->environment;
-
-
+        environments.push_back(this->environment);
         this->environment = env;
 
 
-        try {
-            for (auto &stmt: statements.get()) {
-                execute(stmt.get());
-            }
-        }
-        catch (const BreakException &e) {
-            this->environment = previous;
-            throw e;
-        }
-        catch (const ReturnException &e) {
-            this->environment = previous;
-            throw e;
+        for (auto stmt: statements) {
+            if (execute(stmt) != Completion::NORMAL)
+                break;
         }
 
-        this->environment = previous;
+        this->environment = environments.back();
+        environments.pop_back();
 //            std::cout<<"Exiting block\n";
+        return completion;
+    }
+
+    Object Interpreter::take_return_value() {
+        completion = Completion::NORMAL;
+        return std::move(return_value);
     }
 
     void Interpreter::visit(Binary *expr) {
-        Object left = evaluate(expr->left.get());
-        Object right = evaluate(expr->right.get());
-        switch (expr->oper.type) {
+        Object left = evaluate(expr->left);
+        // the right operand may allocate and trigger a collection
+        bool root_left = left.is_heap_object();
+        if (root_left)
+            stack.push_back(left);
+        Object right = evaluate(expr->right);
+        if (root_left)
+            stack.pop_back();
+        Specialization *specialization = quickening ? &feedback->specializations[expr->specialization] : nullptr;
+        if (specialization && *specialization >= Specialization::NUMBER_ADD) {
+            if (left.is_number() && right.is_number()) {
+                double a = left.as_number(), b = right.as_number();
+                switch (*specialization) {
+                    case Specialization::NUMBER_ADD: RETURN(a + b);
+                    case Specialization::NUMBER_SUBTRACT: RETURN(a - b);
+                    case Specialization::NUMBER_MULTIPLY: RETURN(a * b);
+                    case Specialization::NUMBER_GREATER: RETURN(a > b);
+                    case Specialization::NUMBER_GREATER_EQUAL: RETURN(a >= b);
+                    case Specialization::NUMBER_LESS: RETURN(a < b);
+                    case Specialization::NUMBER_LESS_EQUAL: RETURN(a <= b);
+                    case Specialization::NUMBER_DIVIDE:
+                        // division by zero takes the generic path, which raises the error
+                        if (b != 0) {
+                            RETURN(a / b);
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            } else {
+                // deoptimize, the node has seen other types and stays generic
+                *specialization = Specialization::GENERIC;
+            }
+        } else if (specialization && *specialization == Specialization::UNINITIALIZED) {
+            *specialization = specialize(expr->oper.type, left, right);
+        }
+        RETURN(binary_operation(expr->oper, left, right));
+    }
+
+    Object Interpreter::binary_operation(const Token &oper, Object &left, Object &right) {
+        switch (oper.type) {
             case COMMA: {
-                RETURN(right);
+                return std::move(right);
 
             }
             case MINUS: {
-                check_number_operands(expr->oper, left, right);
-                RETURN(std::any_cast<double>(left) - std::any_cast<double>(right));
+                check_number_operands(oper, left, right);
+                return left.as_number() - right.as_number();
 
             }
             case SLASH: {
-                check_number_operands(expr->oper, left, right);
+                check_number_operands(oper, left, right);
 
-                double double_right = std::any_cast<double>(right);
-                check_not_zero(expr->oper, double_right);
-                RETURN(std::any_cast<double>(left) / double_right);
+                double double_right = right.as_number();
+                check_not_zero(oper, double_right);
+                return left.as_number() / double_right;
 
             }
             case STAR: {
-                check_number_operands(expr->oper, left, right);
-                RETURN(std::any_cast<double>(left) * std::any_cast<double>(right));
+                check_number_operands(oper, left, right);
+                return left.as_number() * right.as_number();
 
             }
             case GREATER: {
-                check_number_operands(expr->oper, left, right);
-                RETURN(std::any_cast<double>(left) > std::any_cast<double>(right));
+                check_number_operands(oper, left, right);
+                return left.as_number() > right.as_number();
 
             }
             case GREATER_EQUAL: {
-                check_number_operands(expr->oper, left, right);
-                RETURN(std::any_cast<double>(left) >= std::any_cast<double>(right));
+                check_number_operands(oper, left, right);
+                return left.as_number() >= right.as_number();
 
             }
             case LESS: {
-                check_number_operands(expr->oper, left, right);
-                RETURN(std::any_cast<double>(left) < std::any_cast<double>(right));
+                check_number_operands(oper, left, right);
+                return left.as_number() < right.as_number();
 
             }
             case LESS_EQUAL:
-                check_number_operands(expr->oper, left, right);
-                RETURN(std::any_cast<double>(left) <= std::any_cast<double>(right));
+                check_number_operands(oper, left, right);
+                return left.as_number() <= right.as_number();
 
             case BANG_EQUAL:
-            RETURN(!isEqual(left, right));
+            return !isEqual(left, right);
 
             case EQUAL_EQUAL:
-            RETURN(isEqual(left, right));
+            return isEqual(left, right);
 
             case PLUS: {
-                if (lox_object_type<std::string>(left)) {
-                    auto left_str = std::any_cast<std::string>(left);
-                    if (lox_object_type<std::string>(right)) {
-                        auto right_str = std::any_cast<std::string>(right);
-                        RETURN(left_str + right_str);
+                if (left.is_string()) {
+                    if (right.is_string()) {
+                        return heap.make_string(left.as_string() + right.as_string());
+                    }
+                    if (right.is_number()) {
+                        return heap.make_string(left.as_string() + to_string(right.as_number()));
                     }
-                    auto right_double = std::any_cast<double>(right);
-                    RETURN(left_str + to_string(right_double));
                 }
-                auto left_double = std::any_cast<double>(left);
-                if (lox_object_type<std::string>(right)) {
-                    auto right_str = std::any_cast<std::string>(right);
-                    RETURN(to_string(left_double) + right_str);
+                if (left.is_number() && right.is_string()) {
+                    return heap.make_string(to_string(left.as_number()) + right.as_string());
                 }
-                auto right_double = std::any_cast<double>(right);
-                RETURN(left_double + right_double);
+                check_number_operands(oper, left, right);
+                return left.as_number() + right.as_number();
             }
         }
 
-        RETURN({});
+        return {};
 
     }
 
-    bool Interpreter::isTruthy(Object val) {
-        if (!val.has_value())
-            return false;
-        try {
-            auto typed_val = std::any_cast<bool>(val);
-            return typed_val;
+    Specialization Interpreter::specialize(token_type oper, const Object &left, const Object &right) {
+        if (!left.is_number() || !right.is_number())
+            return Specialization::GENERIC;
+        switch (oper) {
+            case PLUS:
+                return Specialization::NUMBER_ADD;
+            case MINUS:
+                return Specialization::NUMBER_SUBTRACT;
+            case STAR:
+                return Specialization::NUMBER_MULTIPLY;
+            case SLASH:
+                return Specialization::NUMBER_DIVIDE;
+            case GREATER:
+                return Specialization::NUMBER_GREATER;
+            case GREATER_EQUAL:
+                return Specialization::NUMBER_GREATER_EQUAL;
+            case LESS:
+                return Specialization::NUMBER_LESS;
+            case LESS_EQUAL:
+                return Specialization::NUMBER_LESS_EQUAL;
+            default:
+                return Specialization::GENERIC;
         }
-        catch (const std::bad_any_cast &e) {
-        };
-        return true;
+    }
+
+    bool Interpreter::isTruthy(const Object &val) {
+        return is_truthy(val);
     }
 
     bool Interpreter::isEqual(Object &val1, Object &val2) {
-        if (isNull(val1) && isNull(val2))
-            return true;
-        if (isNull(val1))
-            return false;
-        if (!same_type(val1, val2))
-            return false;
-        if (lox_object_type<double>(val1)) {
-            return std::any_cast<double>(val1) == std::any_cast<double>(val2);
-        }
-        if (lox_object_type<bool>(val1)) {
-            return std::any_cast<bool>(val1) == std::any_cast<bool>(val2);
-        }
-        if (lox_object_type<std::string>(val1)) {
-            return std::any_cast<std::string>(val1) == std::any_cast<std::string>(val2);
-        }
-        throw std::runtime_error("Unexpected types");
+        return values_equal(val1, val2);
     }
 
     bool Interpreter::isNull(Object &obj) {
-        return !obj.has_value();
+        return obj.is_nil();
     }
 
     bool Interpreter::same_type(Object &obj1, Object &obj2) {
         return obj1.type() == obj2.type();
     }
 
-    void Interpreter::execute(Stmt *stmt) {
+    Completion Interpreter::execute(Stmt *stmt) {
         stmt->accept(*this);
+        return completion;
     }
 
-    Interpreter::Interpreter() {
-        global = new Environment();
+    Interpreter::Interpreter(std::ostream &out) : out(out) {
+        global = heap.allocate<Environment>();
         environment = global;
-        global_clock = (Callable *) (new Clock());
+        define_natives();
+    }
 
-        global->define("clock", global_clock);
+    void Interpreter::print(const Object &value) {
+        if (output_lock) {
+            std::lock_guard<std::mutex> lock(*output_lock);
+            out << get_string_repr(value) << std::endl;
+        } else {
+            out << get_string_repr(value) << std::endl;
+        }
     }
 
-    Interpreter::~Interpreter() {
-        delete global;
-        delete global_clock;
+    void Interpreter::mark_roots(Heap &heap) {
+        heap.mark_object(global);
+        heap.mark_object(environment);
+        for (auto env: environments)
+            heap.mark_object(env);
+        // a collection is the moment to give pooled environments back, so drop the pool rather than mark it
+        free_environments.clear();
+        for (auto &val: stack)
+            heap.mark_value(val);
+        for (auto &val: global_values)
+            heap.mark_value(val);
+        heap.mark_value(value);
+        heap.mark_value(return_value);
+    }
+
+    int Interpreter::global_slot(const std::string &name) {
+        auto itr = global_slots.find(name);
+        if (itr != global_slots.end())
+            return itr->second;
+        int slot = (int) global_values.size();
+        global_slots.emplace(name, slot);
+        global_values.push_back(Object::uninitialized());
+        global_defined.push_back(false);
+        return slot;
+    }
+
+    void Interpreter::define_global(const std::string &name, Object value) {
+        int slot = global_slot(name);
+        global_values[slot] = std::move(value);
+        global_defined[slot] = true;
+    }
+
+    void Interpreter::reset_globals() {
+        global_slots.clear();
+        global_values.clear();
+        global_defined.clear();
+        feedback_tables.clear();
+        feedback = nullptr;
+        free_environments.clear();
+        // nothing may hold on to the literals of the programs run so far, they go away with them
+        reset_after_error();
+        value = Object();
+        has_value = false;
+        return_value = Object();
+        define_natives();
+        heap.collect();
+    }
+
+    Feedback *Interpreter::feedback_like(const Feedback &other) {
+        auto &table = feedback_tables[other.program_id];
+        if (!table) {
+            table = std::make_unique<Feedback>(other.program_id, other.specializations.size(), other.caches.size());
+            // spawn gave this interpreter the global slots of the one `other` is from
+            table->global_slots = other.global_slots;
+        }
+        return table.get();
     }
 
-    void Interpreter::visit(Call *expr) {
-        Object callee = evaluate(expr->callee.get());
-        std::vector<Object> arguments;
-        for (auto &argument: expr->arguments.get()) {
-            arguments.push_back(evaluate(argument.get()));
+    void Interpreter::enter_program(const Program &program) {
+        auto &table = feedback_tables[program.id];
+        if (!table) {
+            table = std::make_unique<Feedback>(program);
+            table->global_slots.reserve(program.global_names.size());
+            for (auto &name: program.global_names)
+                table->global_slots.push_back(global_slot(name));
         }
-        try {
-            Callable *function = lox_object_cast<Callable *>(callee);
-            if (arguments.size() != function->arity()) {
-                throw RuntimeException(expr->paren, "Expected " +
-                                                    to_string(function->arity()) + " arguments but got " +
-                                                    to_string(arguments.size()) + ".");
-            }
+        feedback = table.get();
+    }
+
+    const Object &Interpreter::lookup(const Token &name, Slot slot) {
+        if (!slot.is_global())
+            return environment->get(name, slot.depth, slot.index);
+        int index = global_index(slot);
+        const Object &val = global_values[index];
+        if (val.is_uninitialized()) {
+            if (!global_defined[index])
+                throw RuntimeException(name,
+                                       "Undefined variable '" + std::string(name.lexeme) + "'.");
+            throw RuntimeException(name, "Can't access undefined variable");
+        }
+        return val;
+    }
 
-            RETURN(function->call(*this, arguments));
+    Environment *Interpreter::new_environment(Environment *enclosing, int num_slots) {
+        if (free_environments.empty())
+            return heap.allocate<Environment>(enclosing, num_slots);
+        Environment *env = free_environments.back();
+        free_environments.pop_back();
+        env->reset(enclosing, num_slots);
+        return env;
+    }
+
+    void Interpreter::release_environment(Environment *env) {
+        if (free_environments.size() >= MAX_FREE_ENVIRONMENTS)
+            return;
+        env->reset(nullptr, 0);
+        free_environments.push_back(env);
+    }
+
+    void Interpreter::define(Slot slot, Object value) {
+        if (!slot.is_global()) {
+            environment->define(slot.index, std::move(value));
+            return;
         }
-        catch (std::bad_any_cast &e) {
-            throw RuntimeException(expr->paren,
+        int index = global_index(slot);
+        global_values[index] = std::move(value);
+        global_defined[index] = true;
+    }
+
+    void Interpreter::assign(const Token &name, Slot slot, Object value) {
+        if (!slot.is_global()) {
+            environment->assign(slot.depth, slot.index, std::move(value));
+            return;
+        }
+        int index = global_index(slot);
+        if (!global_defined[index])
+            throw RuntimeException(name, "Undefined variable " + std::string(name.lexeme) + ".");
+        global_values[index] = std::move(value);
+    }
+
+    void Interpreter::visit(Call *expr) {
+        if (expr->callee->kind == ExprKind::Get) {
+            auto get = static_cast<Get *>(expr->callee);
+            size_t base = stack.size();
+            stack.push_back(evaluate(get->object));
+            for (auto argument: expr->arguments) {
+                stack.push_back(evaluate(argument));
+            }
+            Object result = invoke(get->name, feedback->caches[get->cache], expr->paren, base);
+            stack.resize(base);
+            RETURN(result);
+        }
+        // the callee and arguments stay on the stack until the call returns so a collection can't free them
+        size_t base = push_call(expr);
+        Object result = call_at(expr->paren, callee_at(base), *this, arguments_at(base));
+        stack.resize(base);
+        RETURN(result);
+    }
+
+    size_t Interpreter::push_call(Call *expr) {
+        size_t base = stack.size();
+        stack.push_back(evaluate(expr->callee));
+        for (auto argument: expr->arguments) {
+            stack.push_back(evaluate(argument));
+        }
+        check_call(expr->paren, base);
+        return base;
+    }
+
+    void Interpreter::check_call(const Token &paren, size_t base) {
+        Object callee = stack[base];
+        if (!callee.is_callable()) {
+            throw RuntimeException(paren,
                                    "Can only call functions and classes.");
+        }
+        check_arity(paren, callee.as_callable(), stack.size() - base - 1);
+    }
 
+    void Interpreter::check_arity(const Token &paren, Callable *callee, size_t arg_count) {
+        if (arg_count != callee->arity()) {
+            throw RuntimeException(paren, "Expected " +
+                                          to_string(callee->arity()) + " arguments but got " +
+                                          to_string(arg_count) + ".");
         }
+    }
 
+    Object Interpreter::invoke(const Token &name, PropertyCache &cache, const Token &paren, size_t base) {
+        LoxInstance *instance = LoxInstance::receiver(stack[base], name);
+        Object field;
+        Callable *method = instance->method(name, cache, field);
+        if (!method) {
+            // a field holding something callable, called like any other callee
+            stack[base] = field;
+            check_call(paren, base);
+            return call_at(paren, callee_at(base), *this, arguments_at(base));
+        }
+        check_arity(paren, method, stack.size() - base - 1);
+        return method->call_method(*this, stack[base], arguments_at(base));
+    }
 
+    Arguments Interpreter::arguments_at(size_t base) {
+        return {stack.data() + base + 1, stack.size() - base - 1};
     }
 
     void Interpreter::visit(Function *stmt) {
-        LoxFunction *fn = new LoxFunction(stmt->name, stmt->fn_expr.get(), environment);
-        Callable *callable_fn = (Callable *) fn;
-        environment->define(stmt->name.lexeme, callable_fn);
+        Callable *fn = heap.allocate<LoxFunction>(stmt->name, stmt->fn_expr, environment, feedback);
+        define(stmt->slot, fn);
     }
 
 
     void Interpreter::visit(FunctionExpr *expr) {
-        LoxFunction *expr_value = new LoxFunction(expr, environment);
-        Callable *fn = (Callable *) expr_value;
+        Callable *fn = heap.allocate<LoxFunction>(expr, environment, feedback);
         RETURN(fn);
     }
 
+    void Interpreter::visit(Class *stmt) {
+        define_class(stmt, stmt->superclass ? evaluate(stmt->superclass) : Object());
+    }
+
+    void Interpreter::define_class(Class *stmt, const Object &superclass_value) {
+        LoxClass *superclass = nullptr;
+        if (stmt->superclass)
+            superclass = LoxClass::superclass_of(superclass_value, static_cast<Variable *>(stmt->superclass)->name);
+        Callable *klass = heap.allocate<LoxClass>(std::string(stmt->name.lexeme), superclass);
+        // defining the class first keeps it alive while its methods are allocated
+        define(stmt->slot, klass);
+        // the methods of a subclass close over an environment holding `super`
+        Environment *closure = environment;
+        if (superclass) {
+            closure = new_environment(environment, 1);
+            closure->define(0, superclass);
+            stack.push_back(static_cast<Obj *>(closure));
+        }
+        for (auto method: stmt->methods) {
+            auto kind = method->name.lexeme == "init" ? FunctionKind::INITIALIZER : FunctionKind::METHOD;
+            Callable *fn = heap.allocate<LoxFunction>(method->name, method->fn_expr, closure, feedback, kind);
+            static_cast<LoxClass *>(klass)->add_method(constant_string(std::string(method->name.lexeme)), fn);
+        }
+        if (superclass)
+            stack.pop_back();
+    }
+
+    void Interpreter::visit(Get *expr) {
+        Object object = evaluate(expr->object);
+        LoxInstance *instance = LoxInstance::receiver(object, expr->name);
+        // binding a method allocates
+        stack.push_back(object);
+        Object result = instance->get(heap, expr->name, feedback->caches[expr->cache]);
+        stack.pop_back();
+        RETURN(result);
+    }
+
+    void Interpreter::visit(Set *expr) {
+        Object object = evaluate(expr->object);
+        stack.push_back(object);
+        Object result = evaluate(expr->value);
+        stack.pop_back();
+        LoxInstance::target(object, expr->name)->set(expr->name, feedback->caches[expr->cache], result);
+        RETURN(result);
+    }
+
+    void Interpreter::visit(This *expr) {
+        RETURN(lookup(expr->keyword, expr->slot));
+    }
+
+    void Interpreter::visit(Super *expr) {
+        RETURN(bind_super(expr));
+    }
+
+    Callable *Interpreter::bind_super(Super *expr) {
+        auto superclass = static_cast<LoxClass *>(lookup(expr->keyword, expr->slot).as_callable());
+        Callable *method = superclass->super_method(expr->method, feedback->caches[expr->cache]);
+        // the receiver stays in its environment while the bound method is allocated
+        return heap.allocate<BoundMethod>(environment->get(expr->keyword, expr->this_slot.depth,
+                                                                      expr->this_slot.index), method);
+    }
+
     void Interpreter::visit(class Return *stmt) {
-        Object value;
-        if (stmt->value)value = evaluate(stmt->value.get());
-        throw ReturnException(value);
+        Expr *value = stmt->value;
+        if (stmt->tail_call) {
+            // the conditions pick the branch being returned, a call there is made by the function being returned
+            // from, after this frame has unwound
+            while (value->kind == ExprKind::Ternary) {
+                auto ternary = static_cast<Ternary *>(value);
+                Object condition = evaluate(ternary->condition);
+                value = isTruthy(condition) ? ternary->left : ternary->right;
+            }
+            if (value->kind == ExprKind::Call) {
+                tail_call_base = push_call(static_cast<Call *>(value));
+                tail_call_paren = &static_cast<Call *>(value)->paren;
+                completion = Completion::TAIL_CALL;
+                return;
+            }
+        }
+        return_value = value ? evaluate(value) : Object();
+        completion = Completion::RETURN;
     }
 
 }
\ No newline at end of file
@@ -1,64 +1,80 @@
 #include <iostream>
 #include <utility>
 #include "lox.h"
-#include "utils.h"
-#include "parser.h"
-#include "token.h"
 #include <sysexits.h>
-#include <interpreter.h>
-#include "scanner.h"
-#include "LoxExceptions.h"
+#include "ProgramCache.h"
 
-#include<sstream>
+namespace Lox {
+    // where runFile keeps parsed scripts, none unless set_cache_directory was called
+    std::unique_ptr<ProgramCache> cache;
 
-std::string readTextFile(const std::string &path) {
-    std::ifstream file(path);
-    if (file.fail()) {
-        Lox::error("Cannot open input file", path);
+    static Isolate &isolate() {
+        static Isolate process_isolate;
+        return process_isolate;
     }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+}
 
+void Lox::set_cache_directory(std::string directory) {
+    if (directory.empty())
+        cache.reset();
+    else
+        cache = std::make_unique<ProgramCache>(std::move(directory));
+    isolate().set_cache(cache.get());
 }
 
-namespace Lox {
-    bool had_error = false;
-    bool had_runtime_error = false;
-    Interpreter interpreter;
+void Lox::set_optimization_level(int level) {
+    isolate().set_optimization_level(level);
+}
+
+void Lox::set_engine(Engine engine) {
+    isolate().set_engine(engine);
+}
+
+void Lox::set_max_depth(size_t depth) {
+    isolate().set_max_depth(depth);
+}
+
+const Lox::HeapStats &Lox::heap_stats() {
+    return isolate().heap_stats();
+}
+
+std::string Lox::heap_stats_report() {
+    return isolate().heap_stats_report();
 }
 
 void Lox::run(std::string input, bool print_expressions = false) {
-    Scanner scanner(std::move(input));
-    auto tokens = scanner.scanTokens();
-
-    Parser parser(tokens);
-    //    p.print();
-    //    print();
-    auto stmts = parser.parseTokens();
-    if (had_error)
-        return;
-    // std::cout << ASTPrinter().print(std::move(expression));
-    interpreter.interpret(stmts,print_expressions);
-    //
-    //    std::cout<<tokens.size()<<std::endl;
-
-    // for (auto token : tokens)
-    // {
-    //     std::cout << token;
-    // }
+    run(Source(std::move(input)), print_expressions);
+}
+
+void Lox::run(Source source, bool print_expressions) {
+    isolate().run(std::move(source), print_expressions);
 }
 
 void Lox::report(int line, const std::string &where, const std::string &message) {
-    std::cerr << "[line " << line << "] Error" << where << ": " << message<<std::endl;
-    had_error = true;
+    if (Isolate *current = Isolate::current())
+        current->report(line, where, message);
+    else
+        std::cerr << "[line " << line << "] Error" << where << ": " << message << std::endl;
+}
+
+int Lox::exit_code(Isolate::Status status) {
+    switch (status) {
+        case Isolate::Status::OK:
+            return EX_OK;
+        case Isolate::Status::COMPILE_ERROR:
+            return EX_DATAERR;
+        case Isolate::Status::RUNTIME_ERROR:
+            return EX_SOFTWARE;
+        case Isolate::Status::NO_INPUT:
+            return EX_NOINPUT;
+    }
+    return EX_SOFTWARE;
 }
 
 void Lox::runFile(std::string path) {
-    auto input_text = readTextFile(std::move(path));
-    run(input_text);
-    if (had_error)std::exit(EX_DATAERR);
-    if (had_runtime_error)std::exit(EX_SOFTWARE);
+    int code = exit_code(isolate().run_file(path));
+    if (code != EX_OK)
+        std::exit(code);
 }
 
 void Lox::runPrompt() {
@@ -69,7 +85,6 @@ void Lox::runPrompt() {
         if (current_line.empty())
             break;
         run(current_line, true);
-        had_error = false;
     }
 }
 
@@ -77,16 +92,17 @@ void Lox::error(int line, std::string message) {
     report(line, "", std::move(message));
 }
 
-void Lox::error(Token token, std::string message) {
+void Lox::error(const Token &token, const std::string &message) {
     if (token.type == T_EOF) {
         report(token.line, " at end", message);
     } else {
-        report(token.line, " at '" + token.lexeme + "'", message);
+        report(token.line, " at '" + std::string(token.lexeme) + "'", message);
     }
 }
 
 void Lox::runtime_error(Lox::RuntimeException &e) {
-    std::cerr << e.what() << "\n[line " << e.token.line << "]\n";
-    had_runtime_error = true;
-
+    if (Isolate *current = Isolate::current())
+        current->runtime_error(e);
+    else
+        std::cerr << e.what() << "\n[line " << e.token.line << "]\n";
 }
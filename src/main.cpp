@@ -1,13 +1,204 @@
 #include <sysexits.h>
+#include <csignal>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Batch.h"
 #include "lox.h"
+#include "ProgramCache.h"
+#include "Server.h"
+
+// runs the scripts of a batch, printing their output in order with a status line for each on stderr. Exits with
+// the code of the first script that failed
+static int run_batch(const std::vector<std::string> &paths, const Lox::BatchOptions &options) {
+    int code = EX_OK;
+    size_t failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    Lox::run_batch(paths, options, [&](const Lox::ScriptResult &result) {
+        std::cout << result.out << std::flush;
+        std::cerr << result.err << result.path << ": ";
+        int script_code = Lox::exit_code(result.status);
+        if (script_code == EX_OK)
+            std::cerr << "ok";
+        else
+            std::cerr << "exit " << script_code;
+        std::cerr << " in " << result.milliseconds << " ms" << std::endl;
+        if (script_code != EX_OK && failed++ == 0)
+            code = script_code;
+    });
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cerr << paths.size() << " scripts, " << failed << " failed, in " << elapsed.count() << " ms" << std::endl;
+    return code;
+}
+
+// serves requests on socket_path until SIGINT or SIGTERM
+static int serve(const std::string &socket_path, const Lox::BatchOptions &options) {
+    Lox::Server server(socket_path, options);
+    if (!server.listen()) {
+        std::cerr << "Cannot listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        return EX_UNAVAILABLE;
+    }
+    // blocked before any thread starts so they all inherit the mask, and handled by a thread of their own
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    std::thread stopper([&] {
+        int signal;
+        sigwait(&signals, &signal);
+        server.stop();
+    });
+    server.serve();
+    stopper.join();
+    return EX_OK;
+}
+
+// runs the script at `path`, or stdin if it's empty, on the server at socket_path
+static int run_on_server(const std::string &socket_path, const std::string &path) {
+    Lox::Client client;
+    if (!client.connect(socket_path)) {
+        std::cerr << "Cannot connect to " << socket_path << ": " << std::strerror(errno) << std::endl;
+        return EX_UNAVAILABLE;
+    }
+    std::optional<Lox::ScriptResult> result;
+    if (path.empty())
+        result = client.run(std::string(std::istreambuf_iterator<char>(std::cin), {}));
+    else
+        result = client.run_file(path);
+    if (!result) {
+        std::cerr << "Lost the connection to " << socket_path << std::endl;
+        return EX_UNAVAILABLE;
+    }
+    std::cout << result->out << std::flush;
+    std::cerr << result->err << std::flush;
+    return Lox::exit_code(result->status);
+}
+
+// the count `arg` gives after `flag`, exiting with EX_USAGE if it isn't a non negative number
+static unsigned long parse_count(const std::string &flag, const std::string &arg) {
+    std::string value = arg.substr(flag.size());
+    char *end = nullptr;
+    errno = 0;
+    unsigned long count = std::strtoul(value.c_str(), &end, 10);
+    if (value.empty() || !std::isdigit(static_cast<unsigned char>(value[0])) || *end != '\0' || errno == ERANGE) {
+        std::cout << "Invalid " << flag << "'" << value << "', expected a non negative number\n";
+        exit(EX_USAGE);
+    }
+    return count;
+}
 
 int main(int argc, char *argv[]) {
-    if (argc > 2) {
-        std::cout << "Usage: " << argv[0] << " [script]\n";
+    const std::string engine_flag = "--engine=";
+    const std::string max_depth_flag = "--max-depth=";
+    const std::string jobs_flag = "--jobs=";
+    const std::string manifest_flag = "--manifest=";
+    const std::string serve_flag = "--serve=";
+    const std::string client_flag = "--client=";
+    auto usage = [&] {
+        std::cout << "Usage: " << argv[0] << " [--gc-stats] [-O0|-O1|-O2] [--no-cache] [--engine=tree|closure|stack|vm] "
+                     "[--max-depth=N] [--jobs=N] [--serve=SOCKET | --client=SOCKET [script] | --manifest=FILE] [script...]\n";
         exit(EX_USAGE);
-    } else if (argc == 2) {
-        Lox::runFile(argv[1]);
+    };
+    Lox::BatchOptions options;
+    bool gc_stats = false;
+    bool use_cache = true;
+    // --jobs and --manifest run any number of scripts at once instead of one
+    bool batch = false;
+    std::optional<std::string> manifest, serve_socket, client_socket;
+    // flags come in any order before the scripts
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        std::string flag = argv[arg];
+        auto has_prefix = [&](const std::string &prefix) { return flag.rfind(prefix, 0) == 0; };
+        if (flag == "--gc-stats") {
+            gc_stats = true;
+        } else if (flag == "-O0" || flag == "-O1" || flag == "-O2") {
+            options.optimization_level = flag[2] - '0';
+        } else if (flag == "--no-cache") {
+            use_cache = false;
+        } else if (has_prefix(engine_flag)) {
+            std::string engine = flag.substr(engine_flag.size());
+            if (engine == "vm") {
+                options.engine = Lox::Engine::VM;
+            } else if (engine == "closure") {
+                options.engine = Lox::Engine::CLOSURES;
+            } else if (engine == "stack") {
+                options.engine = Lox::Engine::STACK;
+            } else if (engine == "tree") {
+                options.engine = Lox::Engine::TREE_WALKER;
+            } else {
+                std::cout << "Unknown engine '" << engine << "', expected 'tree', 'closure', 'stack' or 'vm'\n";
+                exit(EX_USAGE);
+            }
+        } else if (has_prefix(max_depth_flag)) {
+            options.max_depth = parse_count(max_depth_flag, flag);
+        } else if (has_prefix(jobs_flag)) {
+            unsigned long jobs = parse_count(jobs_flag, flag);
+            if (jobs > Lox::MAX_JOBS) {
+                std::cout << "Invalid " << jobs_flag << jobs << ", expected at most " << Lox::MAX_JOBS << "\n";
+                exit(EX_USAGE);
+            }
+            options.jobs = jobs;
+            batch = true;
+        } else if (has_prefix(manifest_flag)) {
+            manifest = flag.substr(manifest_flag.size());
+            batch = true;
+        } else if (has_prefix(serve_flag)) {
+            serve_socket = flag.substr(serve_flag.size());
+        } else if (has_prefix(client_flag)) {
+            client_socket = flag.substr(client_flag.size());
+        } else {
+            usage();
+        }
+    }
+    // --serve keeps isolates warm for the scripts --client sends it over a Unix domain socket
+    if (serve_socket) {
+        if (client_socket || manifest || arg != argc)
+            usage();
+        return serve(*serve_socket, options);
+    }
+    if (client_socket) {
+        if (manifest || argc - arg > 1)
+            usage();
+        return run_on_server(*client_socket, argc - arg == 1 ? argv[arg] : "");
+    }
+    std::vector<std::string> paths;
+    if (manifest) {
+        auto listed = Lox::read_manifest(*manifest);
+        if (!listed) {
+            std::cerr << "Cannot open manifest " << *manifest << std::endl;
+            exit(EX_NOINPUT);
+        }
+        paths = std::move(*listed);
+    }
+    if (!batch && argc - arg > 1)
+        usage();
+    std::string cache_directory = use_cache ? Lox::ProgramCache::default_directory() : "";
+    if (batch) {
+        paths.insert(paths.end(), argv + arg, argv + argc);
+        Lox::ProgramCache cache(cache_directory);
+        if (!cache_directory.empty())
+            options.cache = &cache;
+        return run_batch(paths, options);
+    }
+    Lox::set_engine(options.engine);
+    Lox::set_optimization_level(options.optimization_level);
+    if (options.max_depth)
+        Lox::set_max_depth(options.max_depth);
+    if (gc_stats)
+        std::atexit([] { std::cerr << Lox::heap_stats_report(); });
+    Lox::set_cache_directory(cache_directory);
+    if (argc - arg == 1) {
+        Lox::runFile(argv[arg]);
     } else {
         Lox::runPrompt();
     }
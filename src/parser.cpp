@@ -9,147 +9,152 @@
 #include "scanner.h"
 #include "lox.h"
 
-void Parser::check_missing_expr(Expr *expr, std::string error_message) {
+void Parser::check_missing_expr(Expr *expr, std::string_view error_message) {
     if (IsType<Nothing>(expr)) {
-        handled_parse_errors.push_back(HandledParseError(previous(), error_message));
+        handled_parse_errors.push_back(HandledParseError(previous(), std::string(error_message)));
     };
 }
 
 
-void Parser::check_invalid_token(token_type token, Token previous, std::string error_message) {
+void Parser::check_invalid_token(token_type token, const Token &previous, std::string_view error_message) {
     if (previous.type == token) {
-        handled_parse_errors.push_back(HandledParseError(previous, error_message));
+        handled_parse_errors.push_back(HandledParseError(previous, std::string(error_message)));
     }
 }
 
 
-unique_ptr<Expr> Parser::expression() {
+Expr *Parser::expression() {
     return comma();
 }
 
 
-unique_ptr<Expr> Parser::comma() {
+Expr *Parser::comma() {
 
     auto expr = assignment();
     while (match({COMMA})) {
-        check_missing_expr(expr.get(), "Binary operators must have a left and a right operand");
+        check_missing_expr(expr, "Binary operators must have a left and a right operand");
         Token operator_token = previous();
         auto right = assignment();
-        expr = std::make_unique<Binary>(expr, operator_token, right);
+        expr = make<Binary>(expr, operator_token, right);
     }
     return expr;
 }
 
 
-unique_ptr<Expr> Parser::ternary() {
+Expr *Parser::ternary() {
     auto expr = logical_or();
     if (match({QUESTION_MARK})) {
         auto if_match = comma();
         consume(COLON, "EXPECTED COLON");
         auto if_not_match = ternary();
-        return std::make_unique<Ternary>(expr, if_match, if_not_match);
+        return make<Ternary>(expr, if_match, if_not_match);
     }
     return expr;
 }
 
 
-unique_ptr<Expr> Parser::equality() {
+Expr *Parser::equality() {
     auto expr = comparison();
     while (match({BANG_EQUAL, EQUAL_EQUAL})) {
-        check_missing_expr(expr.get(), "Binary operators must have a left and a right operand");
+        check_missing_expr(expr, "Binary operators must have a left and a right operand");
         Token operator_token = previous();
         auto right = comparison();
 
         // expr = new Binary(expr, operator_token, right);
-        expr = std::make_unique<Binary>(expr, operator_token, right);
+        expr = make<Binary>(expr, operator_token, right);
     }
     return expr;
 }
 
 
-unique_ptr<Expr> Parser::comparison() {
+Expr *Parser::comparison() {
     auto expr = term();
     while (match({GREATER, GREATER_EQUAL, LESS, LESS_EQUAL})) {
-        check_missing_expr(expr.get(), "Binary operators must have a left and a right operand");
+        check_missing_expr(expr, "Binary operators must have a left and a right operand");
         Token operator_token = previous();
         auto right = term();
-        expr = std::make_unique<Binary>(expr, operator_token, right);
+        expr = make<Binary>(expr, operator_token, right);
         // expr = new Binary(expr, operator_token, right);
     }
     return expr;
 }
 
 
-unique_ptr<Expr> Parser::term() {
+Expr *Parser::term() {
     auto expr = factor();
     while (match({MINUS, PLUS})) {
-        check_missing_expr(expr.get(), "Binary operators must have a left and a right operand");
+        check_missing_expr(expr, "Binary operators must have a left and a right operand");
         Token operator_token = previous();
         auto right = factor();
         // expr = new Binary(expr, operator_token, right);
-        expr = std::make_unique<Binary>(expr, operator_token, right);
+        expr = make<Binary>(expr, operator_token, right);
     }
     return expr;
 }
 
 
-unique_ptr<Expr> Parser::factor() {
+Expr *Parser::factor() {
     auto expr = unary();
     while (match({SLASH, STAR})) {
-        check_missing_expr(expr.get(), "Binary operators must have a left and a right operand");
+        check_missing_expr(expr, "Binary operators must have a left and a right operand");
         Token operator_token = previous();
         auto right = unary();
         // expr = new Binary(expr, operator_token, right);
-        expr = std::make_unique<Binary>(expr, operator_token, right);
+        expr = make<Binary>(expr, operator_token, right);
     }
     return expr;
 }
 
 
-unique_ptr<Expr> Parser::unary() {
+Expr *Parser::unary() {
     if (match({BANG, MINUS})) {
         Token operator_token = previous();
         auto right = unary();
-        return std::make_unique<Unary>(operator_token, right);
+        return make<Unary>(operator_token, right);
         // return new Unary(operator_token, right);
     }
     return call();
 }
 
 
-unique_ptr<Expr> Parser::primary() {
+Expr *Parser::primary() {
     if (match({FALSE}))
-        return std::make_unique<Literal>(false);
+        return make<Literal>(false);
     if (match({TRUE}))
-        return std::make_unique<Literal>(true);
+        return make<Literal>(true);
     if (match({NIL}))
-        return std::make_unique<Literal>(std::any{});
+        return make<Literal>(Lox::Object{});
     check_invalid_token(DOT, peek(), "Values cannot begin with a dot.");
     if (match({NUMBER})) {
-        literal_type literal = previous().literal;
-        double val = std::get<double>(literal);
-        return std::make_unique<Literal>(val);
+        return make<Literal>(previous().number());
     }
 
     if (match({STRING})) {
-        literal_type literal = previous().literal;
-        std::string val = std::get<std::string>(literal);
-        return std::make_unique<Literal>(val);
+        return make<Literal>(program.constant_string(std::string(previous().string())));
     }
     if (match({LEFT_PAREN})) {
         auto expr = expression();
         consume(RIGHT_PAREN, "Expect ')' after expression");
-        return std::make_unique<Grouping>(expr);
+        return make<Grouping>(expr);
     }
     if (match({FUN})) {
         return function_body("anonymous fn");
     }
     if (match({IDENTIFIER})) {
-        return std::make_unique<Variable>(previous());
+        return make<Variable>(previous());
+    }
+    if (match({THIS})) {
+        return make<This>(previous());
+    }
+    if (match({SUPER})) {
+        Token keyword = previous();
+        consume(DOT, "Expect '.' after 'super'.");
+        Token method = consume(IDENTIFIER, "Expect superclass method name.");
+        return make<Super>(keyword, method);
     }
     throw error(peek(), "Expect Expression");
 //    advance(); // advance curr pointer to next so that rest of expr can be parsed because this fn will return Nothing
-//    return std::make_unique<Nothing >("Placeholder");
+//    return make<Nothing >("Placeholder");
 }
 
 //T->T?T:T,T
@@ -172,20 +177,29 @@ bool Parser::check(token_type t) {
 }
 
 
-Token Parser::advance() {
+const Token &Parser::advance() {
     if (!isAtEnd())
         current++;
     return previous();
 }
 
 
-Token Parser::previous() {
-    return tokens.at(current - 1);
+const Token &Parser::token_at(size_t position) {
+    while (scanned <= position) {
+        window[scanned % WINDOW_SIZE] = scanner.next_token();
+        scanned++;
+    }
+    return window[position % WINDOW_SIZE];
 }
 
 
-Token Parser::peek() {
-    return tokens.at(current);
+const Token &Parser::previous() {
+    return window[(current - 1) % WINDOW_SIZE];
+}
+
+
+const Token &Parser::peek() {
+    return token_at(current);
 }
 
 
@@ -194,17 +208,17 @@ bool Parser::isAtEnd() {
 }
 
 
-ParseError Parser::error(Token token, std::string message) {
-    Lox::error(std::move(token), std::move(message));
+ParseError Parser::error(const Token &token, const std::string &message) {
+    Lox::error(token, message);
     return {};
 }
 
 
-Token Parser::consume(token_type type, std::string message) {
+const Token &Parser::consume(token_type type, std::string_view message) {
     if (check(type)) {
         return advance();
     }
-    throw error(peek(), message);
+    throw error(peek(), std::string(message));
 }
 
 
@@ -239,8 +253,8 @@ void Parser::synchronise() {
 //     }
 // }
 
-Lox::VecUniquePtr<Stmt> Parser::parseTokens() {
-    Lox::VecUniquePtr<Stmt> statements;
+Lox::NodeList<Stmt *> Parser::parseTokens() {
+    std::vector<Stmt *> statements;
 
     while (!isAtEnd()) {
         statements.push_back(declaration());
@@ -249,16 +263,17 @@ Lox::VecUniquePtr<Stmt> Parser::parseTokens() {
     for (auto &error: handled_parse_errors) {
         Lox::error(error.token, error.message);
     }
-    return statements;
+    program.statements = program.arena.make_list(statements);
+    return program.statements;
 
 }
 
-unique_ptr<Stmt> Parser::statement() {
+Stmt *Parser::statement() {
     if (match({PRINT})) {
         return print_statement();
     }
     if (match({LEFT_BRACE})) {
-        return std::make_unique<Block>(block());
+        return make<Block>(block());
     }
     if (match({IF})) {
         return if_statement();
@@ -275,7 +290,7 @@ unique_ptr<Stmt> Parser::statement() {
         }
         consume(SEMICOLON, "Expect ';' after break statement.");
 
-        return std::make_unique<Break>("placeholder");
+        return make<Break>("placeholder");
     }
     if (match({RETURN})) {
         return return_statement();
@@ -283,23 +298,26 @@ unique_ptr<Stmt> Parser::statement() {
     return expression_statement();
 }
 
-unique_ptr<Print> Parser::print_statement() {
+Print *Parser::print_statement() {
     auto value = expression();
     consume(SEMICOLON, "Expected ';' after value");
-    return std::make_unique<Print>(value);
+    return make<Print>(value);
 }
 
-unique_ptr<Expression> Parser::expression_statement() {
+Expression *Parser::expression_statement() {
     auto value = expression();
     consume(SEMICOLON, "Expected ';' after expression");
-    return std::make_unique<Expression>(value);
+    return make<Expression>(value);
 }
 
-unique_ptr<Stmt> Parser::declaration() {
+Stmt *Parser::declaration() {
     try {
         if (match({VAR})) {
             return var_declaration();
         }
+        if (match({CLASS})) {
+            return class_declaration();
+        }
         if (check(FUN) && check_next(IDENTIFIER)) {
             consume(FUN, "");
             return function_decl("Function declaration");
@@ -313,24 +331,44 @@ unique_ptr<Stmt> Parser::declaration() {
     }
 }
 
-unique_ptr<Var> Parser::var_declaration() {
+Class *Parser::class_declaration() {
+    Token name = consume(IDENTIFIER, "Expect class name.");
+    Expr *superclass = nullptr;
+    if (match({LESS})) {
+        consume(IDENTIFIER, "Expect superclass name.");
+        superclass = make<Variable>(previous());
+    }
+    consume(LEFT_BRACE, "Expect '{' before class body.");
+    std::vector<Function *> methods;
+    while (!check(RIGHT_BRACE) && !isAtEnd()) {
+        methods.push_back(static_cast<Function *>(function_decl("method")));
+    }
+    consume(RIGHT_BRACE, "Expect '}' after class body.");
+    return make<Class>(name, superclass, program.arena.make_list(methods));
+}
+
+Var *Parser::var_declaration() {
     Token name = consume(IDENTIFIER, "Expect variable name");
-    std::unique_ptr<Expr> initializer;
+    Expr *initializer = nullptr;
     if (match({EQUAL})) {
         initializer = expression();
     }
     consume(SEMICOLON, "Expect ';' after variable declaration");
-    return std::make_unique<Var>(name, initializer);
+    return make<Var>(name, initializer);
 }
 
-unique_ptr<Expr> Parser::assignment() {
+Expr *Parser::assignment() {
     auto expr = ternary();
     if (match({EQUAL})) {
         Token equals = previous();
         auto value = assignment();
-        if (Lox::instanceof<Variable>(expr.get())) {
-            Token name = ((Variable *) expr.get())->name;
-            return std::make_unique<Assign>(name, value);
+        if (Lox::instanceof<Variable>(expr)) {
+            Token name = ((Variable *) expr)->name;
+            return make<Assign>(name, value);
+        }
+        if (Lox::instanceof<Get>(expr)) {
+            auto get = (Get *) expr;
+            return make<Set>(get->object, get->name, value);
         }
         error(equals, "Invalid assignment target");
 
@@ -339,56 +377,56 @@ unique_ptr<Expr> Parser::assignment() {
 
 }
 
-Lox::VecUniquePtr<Stmt> Parser::block() {
-    Lox::VecUniquePtr<Stmt> statements;
+Lox::NodeList<Stmt *> Parser::block() {
+    std::vector<Stmt *> statements;
     while (!check({RIGHT_BRACE}) && !isAtEnd()) {
-        statements.get().emplace_back(declaration());
+        statements.push_back(declaration());
     }
     consume(RIGHT_BRACE, "Expect '}' after block.");
-    return statements;
+    return program.arena.make_list(statements);
 }
 
-unique_ptr<If> Parser::if_statement() {
+If *Parser::if_statement() {
     consume(LEFT_PAREN, "Expect '(' after 'if'.");
     auto condition = expression();
     consume(RIGHT_PAREN, "Expect ')' after if condition.");
     auto then_branch = statement();
-    std::unique_ptr<Stmt> else_branch;
+    Stmt *else_branch = nullptr;
     if (match({ELSE})) {
         else_branch = statement();
     }
-    return std::make_unique<If>(condition, then_branch, else_branch);
+    return make<If>(condition, then_branch, else_branch);
 }
 
-unique_ptr<Expr> Parser::logical_or() {
+Expr *Parser::logical_or() {
     auto expr = logical_and();
     while (match({OR})) {
-        check_missing_expr(expr.get(), "Logical operators must have a left and a right operand");
+        check_missing_expr(expr, "Logical operators must have a left and a right operand");
         Token operator_token = previous();
         auto right = logical_and();
         // expr = new Binary(expr, operator_token, right);
-        expr = std::make_unique<Logical>(expr, operator_token, right);
+        expr = make<Logical>(expr, operator_token, right);
     }
     return expr;
-//    return unique_ptr<Expr>();
+//    return Expr *();
 }
 
-unique_ptr<Expr> Parser::logical_and() {
-//    return unique_ptr<Expr>();
+Expr *Parser::logical_and() {
+//    return Expr *();
     auto expr = equality();
     while (match({AND})) {
-        check_missing_expr(expr.get(), "Logical operators must have a left and a right operand");
+        check_missing_expr(expr, "Logical operators must have a left and a right operand");
         Token operator_token = previous();
         auto right = equality();
         // expr = new Binary(expr, operator_token, right);
-        expr = std::make_unique<Logical>(expr, operator_token, right);
+        expr = make<Logical>(expr, operator_token, right);
     }
     return expr;
 
 
 }
 
-unique_ptr<While> Parser::while_statement() {
+While *Parser::while_statement() {
 
     consume(LEFT_PAREN, "Expect '(' after 'while'.");
     auto condition = expression();
@@ -396,27 +434,27 @@ unique_ptr<While> Parser::while_statement() {
     nested_loops++;
     auto body = statement();
     nested_loops--;
-    return std::make_unique<While>(condition, body);
+    return make<While>(condition, body);
 }
 
 
-unique_ptr<Stmt> Parser::for_statement() {
+Stmt *Parser::for_statement() {
     consume(LEFT_PAREN, "Expect '(' after 'for'.");
-    Lox::VecUniquePtr<Stmt> new_block_statements;
-    std::unique_ptr<Stmt> initializer;
+    std::vector<Stmt *> new_block_statements;
+    Stmt *initializer = nullptr;
     if (match({SEMICOLON})) {}
     else {
         if (match({VAR})) {
             initializer = var_declaration();
         } else initializer = expression_statement();
-        new_block_statements.push_back(std::move(initializer));
+        new_block_statements.push_back(initializer);
     }
-    std::unique_ptr<Expr> condition;
-    if (!match({SEMICOLON})) {
+    Expr *condition = nullptr;
+    if (!check(SEMICOLON)) {
         condition = expression();
-    } else condition = std::make_unique<Literal>(true);
+    } else condition = make<Literal>(true);
     consume(SEMICOLON, "Expect ';' after loop condition.");
-    std::unique_ptr<Expr> increment;
+    Expr *increment = nullptr;
     if (!check(RIGHT_PAREN)) {
         increment = expression();
     }
@@ -424,21 +462,25 @@ unique_ptr<Stmt> Parser::for_statement() {
     nested_loops++;
     auto body = statement();
     nested_loops--;
-    Lox::VecUniquePtr<Stmt> while_block_statements;
-    while_block_statements.push_back(std::move(body));
-    while_block_statements.push_back(std::make_unique<Expression>(increment));
-    std::unique_ptr<Stmt> internal_block = std::make_unique<Block>(while_block_statements);
-    auto while_statement = std::make_unique<While>(condition, internal_block);
-    new_block_statements.push_back(std::move(while_statement));
-    return std::make_unique<Block>(new_block_statements);
+    std::vector<Stmt *> while_block_statements;
+    while_block_statements.push_back(body);
+    if (increment)
+        while_block_statements.push_back(make<Expression>(increment));
+    Stmt *internal_block = make<Block>(program.arena.make_list(while_block_statements));
+    auto while_statement = make<While>(condition, internal_block);
+    new_block_statements.push_back(while_statement);
+    return make<Block>(program.arena.make_list(new_block_statements));
 }
 
-unique_ptr<Expr> Parser::call() {
+Expr *Parser::call() {
     auto expr = primary();
 
     while (true) {
         if (match({LEFT_PAREN})) {
-            expr = finish_call(std::move(expr));
+            expr = finish_call(expr);
+        } else if (match({DOT})) {
+            Token name = consume(IDENTIFIER, "Expect property name after '.'.");
+            expr = make<Get>(expr, name);
         } else {
             break;
         }
@@ -448,11 +490,11 @@ unique_ptr<Expr> Parser::call() {
 
 }
 
-unique_ptr<Expr> Parser::finish_call(std::unique_ptr<Expr> callee) {
-    Lox::VecUniquePtr<Expr> arguments;
+Expr *Parser::finish_call(Expr *callee) {
+    std::vector<Expr *> arguments;
     if (!check(RIGHT_PAREN)) {
         do {
-            if (arguments.get().size() >= 255) {
+            if (arguments.size() >= 255) {
                 error(peek(), "Can't have more than 255 arguments.");
             }
             arguments.push_back(assignment());// do not using expression() since it parses comma too
@@ -462,30 +504,30 @@ unique_ptr<Expr> Parser::finish_call(std::unique_ptr<Expr> callee) {
     Token paren = consume(RIGHT_PAREN,
                           "Expect ')' after arguments.");
 
-    return std::make_unique<Call>(callee, paren, arguments);
+    return make<Call>(callee, paren, program.arena.make_list(arguments));
 
 }
 
-unique_ptr<Stmt> Parser::function_decl(std::string kind) {
+Stmt *Parser::function_decl(std::string kind) {
 
     Token name = consume(IDENTIFIER, "Expect " + kind + " name.");
     auto fn_expr = function_body(kind);
-    return std::make_unique<Function>(name, fn_expr);
+    return make<Function>(name, fn_expr);
 
 }
 
-unique_ptr<Return> Parser::return_statement() {
+Return *Parser::return_statement() {
     Token keyword = previous();
-    std::unique_ptr<Expr> value;
+    Expr *value = nullptr;
     if (!check({SEMICOLON})) {
         value = expression();
     }
     consume(SEMICOLON, "Expected ';' after return statement");
-    return std::make_unique<Return>(keyword, value);
+    return make<Return>(keyword, value);
 }
 
 
-unique_ptr<FunctionExpr> Parser::function_body(std::string kind) {
+FunctionExpr *Parser::function_body(std::string kind) {
     consume(LEFT_PAREN, "Expect '(' after " + kind + " name.");
     std::vector<Token> parameters;
     if (!check(RIGHT_PAREN)) {
@@ -500,14 +542,17 @@ unique_ptr<FunctionExpr> Parser::function_body(std::string kind) {
     }
     consume(RIGHT_PAREN, "Expect '(' after " + kind + " name.");
     consume(LEFT_BRACE, "Expect '{' before " + kind + " body.");
+    // a break can't reach a loop outside of the function it is in
+    int enclosing_loops = nested_loops;
+    nested_loops = 0;
     auto body = block();
-    return std::make_unique<FunctionExpr>(parameters, body);
+    nested_loops = enclosing_loops;
+    return make<FunctionExpr>(program.arena.make_list(parameters), body);
 }
 
 bool Parser::check_next(token_type t) {
     if (isAtEnd())return false;
-    if (tokens.at(current + 1).type == T_EOF)return false;
-    return tokens.at(current + 1).type == t;
+    return token_at(current + 1).type == t;
 }
 
 
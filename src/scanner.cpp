@@ -1,34 +1,29 @@
+#include <charconv>
 #include <iostream>
 #include "lox.h"
 #include "logger.h"
 #include "token.h"
 #include "scanner.h"
+#include "Keywords.h"
 loglevel_e loglevel = logERROR;
-std::unordered_map<std::string, token_type> Scanner::keywords = {{"and",    AND},
-                                                                 {"class",  CLASS},
-                                                                 {"else",   ELSE},
-                                                                 {"false",  FALSE},
-                                                                 {"for",    FOR},
-                                                                 {"fun",    FUN},
-                                                                 {"if",     IF},
-                                                                 {"nil",    NIL},
-                                                                 {"or",     OR},
-                                                                 {"print",  PRINT},
-                                                                 {"return", RETURN},
-                                                                 {"super",  SUPER},
-                                                                 {"this",   THIS},
-                                                                 {"true",   TRUE},
-                                                                 {"var",    VAR},
-                                                                 {"while",  WHILE},
-                                                                 {"break",  T_BREAK},
-};
 
-std::vector<Token> Scanner::scanTokens() {
-    while (!isAtEnd()) {
+Token Scanner::next_token() {
+    token_ready = false;
+    while (!token_ready) {
+        skip_whitespace();
+        if (isAtEnd())
+            return {T_EOF, source.substr(source.size()), line};
         start = current;
         scanToken();
     }
-    tokens.emplace_back(token_type::T_EOF, "", get_empty_literal(), line);
+    return token;
+}
+
+std::vector<Token> Scanner::scanTokens() {
+    std::vector<Token> tokens;
+    do {
+        tokens.push_back(next_token());
+    } while (tokens.back().type != T_EOF);
     return tokens;
 }
 
@@ -41,12 +36,8 @@ char Scanner::advance() {
 }
 
 void Scanner::addToken(token_type t) {
-    addToken(t, get_empty_literal());
-}
-
-void Scanner::addToken(token_type t, literal_type literal) {
-    std::string text = source.substr(start, current - start);
-    tokens.emplace_back(t, text, literal, line);
+    token = Token(t, source.substr(start, current - start), line);
+    token_ready = true;
 }
 
 bool Scanner::match(char expected) {
@@ -70,14 +61,20 @@ char Scanner::peekNext() {
     return source[current + 1];
 }
 
+void Scanner::skip_whitespace() {
+    const char *begin = source.data();
+    current = kernels.skip_whitespace(begin + current, begin + source.size(), line) - begin;
+}
+
 void Scanner::multiline_comment() {
-    bool found = false;
-    while (!found && !isAtEnd()) {
-        char c = advance();
-        if (c == '\n')line++;
-        else if (c == '*' && peek() == '/')found = true;
+    const char *begin = source.data(), *end = begin + source.size();
+    const char *p = begin + current;
+    while (true) {
+        p = kernels.find_char(p, end, '*', line);
+        if (p == end || ++p == end || *p == '/')
+            break;
     }
-    advance();
+    current = p == end ? source.size() : p - begin + 1;
 }
 
 void Scanner::scanToken() {
@@ -133,8 +130,10 @@ void Scanner::scanToken() {
             break;
         case '/': {
             if (match('/')) {
-                while (!isAtEnd() && peek() != '\n')
-                    advance();
+                // stops in front of the newline, which is counted when it is skipped as whitespace
+                int newlines = 0;
+                const char *begin = source.data();
+                current = kernels.find_char(begin + current, begin + source.size(), '\n', newlines) - begin;
             } else if (match('*')) {
                 multiline_comment();
             } else {
@@ -176,7 +175,7 @@ void Scanner::number() {
         while (isDigit(peek()))
             advance();
     }
-    addToken(NUMBER, stod(source.substr(start, current - start)));
+    addToken(NUMBER);
 }
 
 bool Scanner::isAlpha(char c) {
@@ -192,29 +191,22 @@ bool Scanner::isAlphaNumeric(char c) {
 void Scanner::identifier() {
     while (isAlphaNumeric(peek()))
         advance();
-    auto text = source.substr(start, current - start);
-    auto itr = keywords.find(text);
-    token_type token_t = IDENTIFIER;
-    if (itr != keywords.end()) {
-        token_t = itr->second;
-    }
-    addToken(token_t);
+    addToken(Lox::identifier_type(source.substr(start, current - start)));
 }
 
 void Scanner::string() {
-    while (peek() != '"' && !isAtEnd()) {
-        if (peek() == '\n')
-            line++;
-        advance();
-    }
+    const char *begin = source.data();
+    current = kernels.find_char(begin + current, begin + source.size(), '"', line) - begin;
     if (isAtEnd()) {
         Lox::error(line, "Unterminated String.");
+        return;
     }
     advance();
-    auto value = source.substr(start + 1, current - start - 2);
-    addToken(STRING, value);
+    addToken(STRING);
 }
 
-literal_type get_empty_literal() {
-    return std::monostate{};
+double Token::number() const {
+    double value = 0;
+    std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+    return value;
 }
\ No newline at end of file
@@ -1,7 +1,7 @@
 #include "utils.h"
 #include "types.h"
 #include "Callable.h"
-#include "LoxFunction.h"
+#include "Obj.h"
 
 namespace Lox {
     void error(std::string s1, std::string s2) {
@@ -9,32 +9,56 @@ namespace Lox {
         std::exit(1);
     }
 
-    std::string get_string_repr(Object &obj) {
-
-        if (!obj.has_value())return "nil";
-
-
-        if (lox_object_type<double>(obj)) {
-            return to_string(std::any_cast<double>(obj));
-        }
-        if (lox_object_type<bool>(obj)) {
-            bool bool_obj = std::any_cast<bool>(obj);
-            if (bool_obj)
-                return "True";
-            return "False";
-        }
-        if (lox_object_type<std::string>(obj)) {
-            return std::any_cast<std::string>(obj);
+    std::string get_string_repr(const Object &obj) {
+        switch (obj.type()) {
+            case ValueType::NIL:
+                return "nil";
+            case ValueType::NUMBER:
+                return to_string(obj.as_number());
+            case ValueType::BOOL:
+                if (obj.as_bool())
+                    return "True";
+                return "False";
+            case ValueType::STRING:
+                return obj.as_string();
+            case ValueType::CALLABLE:
+                return obj.as_callable()->to_string();
+            case ValueType::OBJ:
+                return obj.as_obj()->to_string();
+            default:
+                break;
         }
-        //TODO error handling when getting string repr of object
-        if (lox_object_type<Callable *>(obj)) {
-            Callable *ptr = std::any_cast<Callable *>(obj);
-            if (instanceof<LoxFunction>(ptr)) {
-                return ((LoxFunction *) ptr)->operator std::string();
-            };
+        throw std::runtime_error("Unable to cast lox object to string repr\n");
+    }
 
+    bool is_truthy(const Object &obj) {
+        if (obj.is_nil())
+            return false;
+        if (obj.is_bool())
+            return obj.as_bool();
+        return true;
+    }
+
+    bool values_equal(const Object &val1, const Object &val2) {
+        if (val1.type() != val2.type())
+            return false;
+        switch (val1.type()) {
+            case ValueType::NIL:
+                return true;
+            case ValueType::NUMBER:
+                return val1.as_number() == val2.as_number();
+            case ValueType::BOOL:
+                return val1.as_bool() == val2.as_bool();
+            case ValueType::STRING:
+                return val1.as_string() == val2.as_string();
+            case ValueType::CALLABLE:
+                return val1.as_callable() == val2.as_callable();
+            case ValueType::OBJ:
+                return val1.as_obj() == val2.as_obj();
+            default:
+                break;
         }
-        throw std::runtime_error("Unable to cast lox object to string repr\n");
+        throw std::runtime_error("Unexpected types");
     }
 
 }
@@ -0,0 +1,96 @@
+#include<gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "interpreter.h"
+#include "Resolver.h"
+#include "parser.h"
+#include "scanner.h"
+
+static std::atomic<bool> counting_allocations{false};
+static std::atomic<long> allocations{0};
+
+void *operator new(std::size_t size) {
+    if (counting_allocations) allocations++;
+    if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+TEST(AllocationTests, ArithmeticExpressionsDoNotAllocate) {
+    Scanner scanner{"(1 + 2) * 3 - 4 / 2 > 1 == !false and -(2 * 8) < 0;"};
+    Lox::Program program;
+    Parser parser(scanner, program);
+    auto statements = parser.parseTokens();
+    auto *statement = dynamic_cast<Expression *>(statements[0]);
+    ASSERT_NE(statement, nullptr);
+
+    Lox::Interpreter interpreter;
+    EXPECT_TRUE(interpreter.evaluate(statement->expression).as_bool());
+    allocations = 0;
+    counting_allocations = true;
+    for (int i = 0; i < 1000; i++) {
+        interpreter.evaluate(statement->expression);
+    }
+    counting_allocations = false;
+    EXPECT_EQ(allocations, 0);
+}
+
+TEST(AllocationTests, ScanningDoesNotAllocatePerToken) {
+    std::string source;
+    for (int i = 0; i < 2000; i++)
+        source += "var name" + std::to_string(i) + " = \"some string\" + 12.5 * other;\n";
+    allocations = 0;
+    counting_allocations = true;
+    Scanner scanner{source};
+    size_t count = 1;
+    while (scanner.next_token().type != T_EOF)
+        count++;
+    counting_allocations = false;
+    EXPECT_EQ(count, 2000 * 9 + 1);
+    EXPECT_EQ(allocations, 0);
+}
+
+TEST(AllocationTests, ParserStreamsTokens) {
+    std::string source;
+    for (int i = 0; i < 2000; i++)
+        source += "var name" + std::to_string(i) + " = 12.5 * other;\n";
+    Scanner scanner{source};
+    Lox::Program program;
+    allocations = 0;
+    counting_allocations = true;
+    Parser parser(scanner, program);
+    auto statements = parser.parseTokens();
+    counting_allocations = false;
+    EXPECT_EQ(statements.size(), 2000);
+    // arena blocks and the statement list, nothing per token
+    EXPECT_LT(allocations, program.arena.block_count() + 32);
+}
+
+TEST(AllocationTests, CallsReuseUncapturedEnvironments) {
+    Scanner scanner{"fun fib(n) { if (n < 2) return n; { var m = n - 1; return fib(m - 1) + fib(m); } }\n"
+                    "fib(15);"};
+    Lox::Program program;
+    Parser parser(scanner, program);
+    auto statements = parser.parseTokens();
+    Lox::Interpreter interpreter;
+    Lox::Resolver().resolve_program(program);
+    interpreter.enter_program(program);
+    interpreter.execute(statements[0]);
+    auto *call = dynamic_cast<Expression *>(statements[1]);
+    ASSERT_NE(call, nullptr);
+
+    EXPECT_EQ(interpreter.evaluate(call->expression).as_number(), 610);
+    allocations = 0;
+    counting_allocations = true;
+    interpreter.evaluate(call->expression);
+    counting_allocations = false;
+    EXPECT_EQ(allocations, 0);
+}
@@ -0,0 +1,62 @@
+#include<gtest/gtest.h>
+#include <cstdio>
+#include "Batch.h"
+#include "TestHelpers.h"
+
+TEST(BatchTests, ResultsComeInOrder) {
+    std::vector<std::string> paths;
+    for (int i = 0; i < 12; i++) {
+        // early scripts take longest, so they finish after the later ones
+        std::string script = "var x = \"global\"; fun fib(n) { if (n < 2) return n; return fib(n - 2) + fib(n - 1); }\n"
+                             "fib(" + std::to_string(20 - i) + "); print " + std::to_string(i) + ";";
+        if (i == 3)
+            script = "print x; var x = 1; print y;";
+        if (i == 5)
+            script = "print (;";
+        paths.push_back(write_temp_file("lox_batch_test_" + std::to_string(i) + ".lox", script));
+    }
+    paths.push_back(testing::TempDir() + "lox_batch_test_missing.lox");
+    Lox::BatchOptions options;
+    options.jobs = 4;
+    std::vector<Lox::ScriptResult> results;
+    Lox::run_batch(paths, options, [&](const Lox::ScriptResult &result) { results.push_back(result); });
+
+    ASSERT_EQ(results.size(), paths.size());
+    for (size_t i = 0; i < 12; i++) {
+        EXPECT_EQ(results[i].path, paths[i]);
+        if (i == 3) {
+            // scripts don't see each other's globals
+            EXPECT_EQ(results[i].status, Lox::Isolate::Status::RUNTIME_ERROR);
+            EXPECT_EQ(results[i].out, "");
+            EXPECT_EQ(results[i].err, "Undefined variable 'x'.\n[line 1]\n");
+        } else if (i == 5) {
+            EXPECT_EQ(results[i].status, Lox::Isolate::Status::COMPILE_ERROR);
+            EXPECT_NE(results[i].err.find("[line 1]"), std::string::npos);
+        } else {
+            EXPECT_EQ(results[i].status, Lox::Isolate::Status::OK);
+            EXPECT_EQ(results[i].out, std::to_string(i) + "\n");
+            EXPECT_EQ(results[i].err, "");
+        }
+        EXPECT_GE(results[i].milliseconds, 0);
+        std::remove(paths[i].c_str());
+    }
+    EXPECT_EQ(results.back().status, Lox::Isolate::Status::NO_INPUT);
+}
+
+TEST(BatchTests, ManifestListsPaths) {
+    auto path = write_temp_file("lox_batch_test.manifest", "# scripts\na.lox\n\n  b.lox  \r\n#c.lox\nd e.lox");
+    auto paths = Lox::read_manifest(path);
+    ASSERT_TRUE(paths);
+    EXPECT_EQ(*paths, (std::vector<std::string>{"a.lox", "b.lox", "d e.lox"}));
+    std::remove(path.c_str());
+    EXPECT_FALSE(Lox::read_manifest(path));
+}
+
+TEST(BatchTests, JobCountIsCapped) {
+    Lox::BatchOptions options;
+    EXPECT_GE(Lox::job_count(options), 1);
+    options.jobs = 3;
+    EXPECT_EQ(Lox::job_count(options), 3);
+    options.jobs = 1000000;
+    EXPECT_EQ(Lox::job_count(options), Lox::MAX_JOBS);
+}
@@ -0,0 +1,68 @@
+#include<gtest/gtest.h>
+#include "TestHelpers.h"
+
+TEST(ClassTests, InheritanceAndBinding) {
+    expect_output(R"(
+class Animal {
+  init(name) { this.name = name; this.legs = 4; }
+  speak() { return this.name + " makes a sound"; }
+  describe() { return this.name + " has " + this.legs + " legs"; }
+}
+class Dog < Animal {
+  init(name) { super.init(name); this.tricks = 0; }
+  speak() { return this.name + " barks"; }
+  learn() { this.tricks = this.tricks + 1; return this; }
+  parent() { return super.speak(); }
+}
+var d = Dog("Rex");
+print d.speak();
+print d.parent();
+print d.describe();
+print d.learn().learn().tricks;
+var speak = d.speak;
+print speak();
+print Dog;
+print d;
+print d.init("Max").name;
+class F { init() { this.f = fun() { return "field"; }; } f() { return "method"; } }
+print F().f();
+fun make(x, y) { return Animal(x + y); }
+print make("a", "b").describe();
+)", "Rex barks\nRex makes a sound\nRex has 4 legs\n2\nRex barks\nDog\nDog instance\nMax\nfield\nab has 4 legs\n");
+}
+
+TEST(ClassTests, PolymorphicAndMegamorphicSites) {
+    // one site sees instances whose fields were added in different orders, so with different shapes, then more
+    // classes than a cache holds
+    expect_output(R"(
+class P { init(first) { if (first) { this.x = 1; this.y = 2; } else { this.y = 2; this.x = 1; } } }
+var sum = 0;
+for (var i = 0; i < 10; i = i + 1) { var p = P(i < 5); sum = sum + p.x * 10 + p.y; }
+print sum;
+class A { v() { return 1; } }
+class B < A { v() { return 2; } }
+class C < A {}
+class D < B {}
+class E < A { v() { return 5; } }
+class G < E {}
+var objects = nil;
+fun pick(i) {
+  if (i == 0) return A(); if (i == 1) return B(); if (i == 2) return C();
+  if (i == 3) return D(); if (i == 4) return E(); return G();
+}
+var total = 0;
+for (var round = 0; round < 3; round = round + 1)
+  for (var i = 0; i < 6; i = i + 1) total = total + pick(i).v();
+print total;
+)", "120\n48\n");
+}
+
+TEST(ClassTests, RuntimeErrors) {
+    const auto error = Lox::Isolate::Status::RUNTIME_ERROR;
+    expect_output("class A {} A().missing;", "Undefined property 'missing'.\n[line 1]\n", error);
+    expect_output("var x = 1; x.y = 2;", "Only instances have fields.\n[line 1]\n", error);
+    expect_output("\"s\".length();", "Only instances have properties.\n[line 1]\n", error);
+    expect_output("var N = 1; class A < N {}", "Superclass must be a class.\n[line 1]\n", error);
+    expect_output("class A {} A(1);", "Expected 0 arguments but got 1.\n[line 1]\n", error);
+    expect_output("class A { init(a) {} } A();", "Expected 1 arguments but got 0.\n[line 1]\n", error);
+}
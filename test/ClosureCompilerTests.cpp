@@ -0,0 +1,39 @@
+#include<gtest/gtest.h>
+#include "TestHelpers.h"
+
+TEST(ClosureCompilerTests, MatchesTreeWalker) {
+    const auto script = R"(
+fun counter() {
+  var count = 0;
+  fun increment() { count = count + 1; return count; }
+  return increment;
+}
+var next = counter();
+next(); next();
+print next();
+fun fib(n) { if (n <= 1) return n; return fib(n - 2) + fib(n - 1); }
+print fib(15);
+var total = 0;
+for (var i = 0; i < 10; i = i + 1) { if (i == 7) break; total = total + i; }
+print total;
+print "a" + 1 + "b";
+print nil or "right", false and 1, !nil, -(2 * 3) / 4, 1 < 2 ? "yes" : "no";
+var square = fun (x) { return x * x; };
+print square(4);
+print counter;
+print square;
+var unset;
+print unset;
+)";
+    std::string expected = run_with(Lox::Engine::TREE_WALKER, script);
+    EXPECT_EQ(run_with(Lox::Engine::CLOSURES, script), expected);
+    EXPECT_EQ(expected, "3\n610\n21\na1b\nyes\n16\n<fn counter>\n<fn anonymous>\n"
+                        "Can't access undefined variable\n[line 22]\n");
+}
+
+TEST(ClosureCompilerTests, RuntimeErrorsMatchTreeWalker) {
+    for (auto script: {"print 1 - \"a\";", "fun f(a) {} f(1, 2);", "print 1 / 0;", "print missing;",
+                       "var x = 1; x();", "{ var a = 1; { fun g() { return -\"s\"; } print a; g(); } }"}) {
+        EXPECT_EQ(run_with(Lox::Engine::CLOSURES, script), run_with(Lox::Engine::TREE_WALKER, script)) << script;
+    }
+}
@@ -0,0 +1,98 @@
+#include<gtest/gtest.h>
+#include <thread>
+#include "Concurrency.h"
+#include "TestHelpers.h"
+
+// the VM has no threads
+static void expect_threaded_output(const std::string &script, const std::string &expected,
+                                   Lox::Isolate::Status status = Lox::Isolate::Status::OK) {
+    expect_output(script, expected, status,
+                  {Lox::Engine::TREE_WALKER, Lox::Engine::CLOSURES, Lox::Engine::STACK});
+}
+
+TEST(ConcurrencyTests, ChannelsAreBoundedQueues) {
+    Lox::Channel channel(2);
+    std::thread consumer([&] {
+        double sum = 0;
+        while (auto message = channel.receive())
+            sum += std::get<double>(*message);
+        EXPECT_EQ(sum, 4950);
+    });
+    for (int i = 0; i < 100; i++)
+        EXPECT_TRUE(channel.send((double) i));
+    channel.close();
+    consumer.join();
+    EXPECT_FALSE(channel.send(1.0));
+    EXPECT_FALSE(channel.receive());
+}
+
+TEST(ConcurrencyTests, WorkersSumInParallel) {
+    expect_threaded_output(R"(
+fun worker(from, to, results) {
+  fun run() {
+    var sum = 0;
+    for (var i = from; i < to; i = i + 1) sum = sum + i;
+    send(results, sum);
+  }
+  return run;
+}
+var results = channel(2);
+for (var w = 0; w < 8; w = w + 1) spawn(worker(w * 100, (w + 1) * 100, results));
+var total = 0;
+for (var w = 0; w < 8; w = w + 1) total = total + receive(results);
+print total;
+)", "319600\n");
+}
+
+TEST(ConcurrencyTests, ThreadsGetCopies) {
+    // a thread sees the globals and captured variables as they were when it was spawned, objects reachable two
+    // ways stay one object, and only channels are shared
+    expect_threaded_output(R"(
+class Node { init(value) { this.value = value; this.next = nil; } sum() { return this.value + (this.next == nil ? 0 : this.next.sum()); } }
+var a = Node(1); a.next = Node(2); a.next.next = a.next;
+a.next.next = nil;
+var shared = Node(10);
+var pair = Node(shared); pair.next = shared;
+var done = channel(1);
+fun check() {
+  a.value = 100;
+  pair.value.value = 20;
+  send(done, a.sum() + pair.next.value);
+}
+spawn(check);
+print receive(done);
+print a.value;
+print shared.value;
+var replies = channel(1);
+var requests = channel(1);
+spawn(fun() { var reply = receive(requests); send(reply, "pong"); });
+send(requests, replies);
+print receive(replies);
+)", "122\n1\n10\npong\n");
+}
+
+TEST(ConcurrencyTests, ErrorsOfThreadsFailTheScript) {
+    expect_threaded_output("spawn(fun() { spawn(fun() { nil.x; }); }); print \"parent\";",
+                           "parent\nOnly instances have properties.\n[line 1]\n", Lox::Isolate::Status::RUNTIME_ERROR);
+    expect_threaded_output("var c = channel(1); close(c); print receive(c);\nsend(c, 1);",
+                           "nil\nSend on a closed channel.\n[line 2]\n", Lox::Isolate::Status::RUNTIME_ERROR);
+    expect_threaded_output("class A {} send(channel(1), A());",
+                           "Only nil, booleans, numbers, strings and channels can be sent.\n[line 1]\n",
+                           Lox::Isolate::Status::RUNTIME_ERROR);
+    expect_threaded_output("spawn(fun(x) {});", "Can only spawn functions without parameters.\n[line 1]\n",
+                           Lox::Isolate::Status::RUNTIME_ERROR);
+    expect_threaded_output("channel(0.5);", "Channel capacity must be a positive integer.\n[line 1]\n",
+                           Lox::Isolate::Status::RUNTIME_ERROR);
+}
+
+TEST(ConcurrencyTests, FinishedThreadsAreReapedWithTheirErrors) {
+    // the failing thread is usually done, and joined, by the time the later spawns look for finished threads
+    expect_threaded_output(R"(
+var started = channel(1);
+spawn(fun() { send(started, 1); nil.x; });
+receive(started);
+var done = channel(1);
+for (var i = 0; i < 200; i = i + 1) { spawn(fun() { send(done, i); }); receive(done); }
+print "parent";
+)", "parent\nOnly instances have properties.\n[line 3]\n", Lox::Isolate::Status::RUNTIME_ERROR);
+}
@@ -0,0 +1,54 @@
+#include<gtest/gtest.h>
+#include <vector>
+#include "Heap.h"
+#include "Value.h"
+#include "lox.h"
+
+using Lox::Value;
+
+namespace {
+    struct TestRoots : Lox::GcRoots {
+        std::vector<Value> values;
+
+        void mark_roots(Lox::Heap &heap) override {
+            for (auto &value: values)
+                heap.mark_value(value);
+        }
+    };
+}
+
+TEST(HeapTests, CollectFreesUnreachableObjects) {
+    TestRoots roots;
+    Lox::Heap heap(roots);
+    roots.values.emplace_back(heap.make_string("kept"));
+    heap.make_string("garbage");
+    roots.values.emplace_back(Lox::constant_string("constant"));
+    EXPECT_EQ(heap.stats().objects, 2);
+
+    heap.collect();
+    EXPECT_EQ(heap.stats().collections, 1);
+    EXPECT_EQ(heap.stats().objects, 1);
+    EXPECT_EQ(heap.stats().objects_freed, 1);
+    EXPECT_EQ(roots.values[0].as_string(), "kept");
+    EXPECT_EQ(roots.values[1].as_string(), "constant");
+}
+
+TEST(HeapTests, AllocationTriggersCollection) {
+    TestRoots roots;
+    Lox::Heap heap(roots, 4096);
+    for (int i = 0; i < 10000; i++)
+        heap.make_string("temporary string");
+    EXPECT_GT(heap.stats().collections, 0);
+    EXPECT_LT(heap.stats().bytes_allocated, 2 * 4096 + 1024);
+}
+
+TEST(HeapTests, InterpreterReclaimsEnvironmentsAndFunctions) {
+    testing::internal::CaptureStdout();
+    Lox::run("fun make(n) { var s = \"n\" + n; fun get() { return s; } return get; }"
+             "var last; for (var i = 0; i < 20000; i = i + 1) { last = make(i); }"
+             "print last();", false);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "n19999\n");
+    const Lox::HeapStats &stats = Lox::heap_stats();
+    EXPECT_GT(stats.collections, 0);
+    EXPECT_LT(stats.bytes_allocated, 4 * Lox::Heap::DEFAULT_THRESHOLD);
+}
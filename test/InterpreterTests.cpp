@@ -0,0 +1,117 @@
+#include<gtest/gtest.h>
+#include <sstream>
+#include "interpreter.h"
+#include "Isolate.h"
+#include "TestHelpers.h"
+
+TEST(InterpreterTests, ReturnUnwindsNestedBlocksAndLoops) {
+    const auto script = R"(
+fun find(limit) {
+  for (var i = 0; i < 100; i = i + 1) {
+    { if (i == limit) { return i * 2; } }
+  }
+  return -1;
+}
+print find(7);
+print find(200);
+fun fib(n) { if (n <= 1) return n; return fib(n - 2) + fib(n - 1); }
+print fib(15);
+)";
+    EXPECT_EQ(run_script(script), "14\n-1\n610\n");
+}
+
+TEST(InterpreterTests, BreakOnlyLeavesInnermostLoop) {
+    const auto script = R"(
+var count = 0;
+for (var i = 0; i < 3; i = i + 1) {
+  while (true) { { count = count + 1; break; } }
+  if (i == 1) break;
+}
+print count;
+)";
+    EXPECT_EQ(run_script(script), "2\n");
+}
+
+TEST(InterpreterTests, QuickenedNodesDeoptimize) {
+    std::ostringstream out, err;
+    Lox::Isolate isolate(out, err);
+    isolate.set_optimization_level(2);
+    const auto script = R"(
+fun add(a, b) { return a + b; }
+fun half(x) { return -x / 2; }
+for (var i = 0; i < 3; i = i + 1) print add(i, 1);
+print add("a", "b");
+print add(2, 3);
+print half(4);
+print half(-1);
+var g = 1;
+fun read() { return g; }
+print read();
+g = "two";
+print read();
+)";
+    EXPECT_EQ(isolate.run(Lox::Source(script)), Lox::Isolate::Status::OK);
+    EXPECT_EQ(out.str(), "1\n2\n3\nab\n5\n-2\n0.5\n1\ntwo\n");
+    // a global declared again without a value can't be read through the specialized node
+    out.str("");
+    EXPECT_EQ(isolate.run(Lox::Source("var g; print read();")), Lox::Isolate::Status::RUNTIME_ERROR);
+    EXPECT_EQ(out.str(), "");
+    EXPECT_NE(err.str().find("Can't access undefined variable"), std::string::npos);
+}
+
+TEST(InterpreterTests, TailCallsRunInConstantStack) {
+    const auto script = R"(
+fun count(n, total) { if (n == 0) return total; return count(n - 1, total + 2); }
+print count(1000000, 0);
+fun is_even(n) { if (n == 0) return true; return is_odd(n - 1); }
+fun is_odd(n) { if (n == 0) return false; return is_even(n - 1); }
+print is_even(100001);
+fun adder(k) { fun add(n, total) { if (n == 0) return total; return add(n - 1, total + k); } return add; }
+print adder(3)(100000, 0);
+fun down(n, total) { return n == 0 ? total : n < 0 ? "negative" : down(n - 1, total + 1); }
+print down(1000000, 0);
+)";
+    expect_output(script, "2e+06\nFalse\n300000\n1e+06\n");
+}
+
+TEST(InterpreterTests, TailCalledClosureSurvivesCollection) {
+    // the closure mk returns is only on the stack until the tail call drops it, and its body allocates enough
+    // to collect it. Built with LOX_DEBUG_STRESS_GC every allocation collects
+    const auto script = R"(
+fun id(x) { return x; }
+fun mk() {
+  return fun(n) {
+    var z = id(1);
+    var s = "";
+    for (var i = 0; i < 200; i = i + 1) s = "x" + i;
+    return s;
+  };
+}
+fun t() { return mk()(3); }
+for (var k = 0; k < 20; k = k + 1) t();
+print t();
+)";
+    expect_output(script, "x199\n", Lox::Isolate::Status::OK,
+                  {Lox::Engine::TREE_WALKER, Lox::Engine::CLOSURES, Lox::Engine::STACK});
+}
+
+TEST(InterpreterTests, StackEngineBoundsRecursionDepth) {
+    // its own isolate, so the engine, the depth and the environments of the deep recursion go away with it
+    std::ostringstream out, err;
+    Lox::Isolate isolate(out, err);
+    isolate.set_engine(Lox::Engine::STACK);
+    isolate.set_max_depth(300000);
+    EXPECT_EQ(isolate.run(Lox::Source(R"(
+fun sum(n) { if (n == 0) return 0; return n + sum(n - 1); }
+print sum(200000);
+)")), Lox::Isolate::Status::OK);
+    EXPECT_EQ(out.str(), "2.00001e+10\n");
+    out.str("");
+    isolate.set_max_depth(1000);
+    EXPECT_EQ(isolate.run(Lox::Source("print sum(2000);")), Lox::Isolate::Status::RUNTIME_ERROR);
+    EXPECT_EQ(out.str(), "");
+    EXPECT_NE(err.str().find("Stack overflow."), std::string::npos);
+    // the isolate is usable again after the overflow
+    EXPECT_EQ(isolate.run(Lox::Source("print sum(10);")), Lox::Isolate::Status::OK);
+    EXPECT_EQ(out.str(), "55\n");
+}
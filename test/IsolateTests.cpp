@@ -0,0 +1,93 @@
+#include<gtest/gtest.h>
+#include <sstream>
+#include <thread>
+#include "Isolate.h"
+
+TEST(IsolateTests, OutputAndErrorsStayInTheirIsolate) {
+    std::ostringstream out_a, err_a, out_b, err_b;
+    Lox::Isolate a(out_a, err_a), b(out_b, err_b);
+    EXPECT_EQ(a.run(Lox::Source("var x = \"a\"; print x;")), Lox::Isolate::Status::OK);
+    EXPECT_EQ(b.run(Lox::Source("print x;")), Lox::Isolate::Status::RUNTIME_ERROR);
+    EXPECT_EQ(b.run(Lox::Source("print (;")), Lox::Isolate::Status::COMPILE_ERROR);
+    // globals persist between runs of one isolate, and errors don't carry over
+    EXPECT_EQ(a.run(Lox::Source("print x + x;")), Lox::Isolate::Status::OK);
+    EXPECT_EQ(out_a.str(), "a\naa\n");
+    EXPECT_EQ(err_a.str(), "");
+    EXPECT_EQ(out_b.str(), "");
+    EXPECT_NE(err_b.str().find("[line 1]"), std::string::npos);
+    EXPECT_EQ(Lox::Isolate::current(), nullptr);
+}
+
+TEST(IsolateTests, IsolatesRunConcurrently) {
+    const std::string script = R"(
+class Counter { init() { this.n = 0; } add(by) { this.n = this.n + by; return this; } }
+fun fib(n) { if (n < 2) return n; return fib(n - 2) + fib(n - 1); }
+var c = Counter();
+for (var i = 0; i < 100; i = i + 1) c.add(i);
+var greeting = "worker " + id;
+print greeting;
+print c.n + fib(15);
+)";
+    const Lox::Engine engines[] = {Lox::Engine::TREE_WALKER, Lox::Engine::CLOSURES, Lox::Engine::STACK,
+                                   Lox::Engine::VM};
+    constexpr int THREADS = 8;
+    std::string outputs[THREADS];
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t] {
+            std::ostringstream out;
+            Lox::Isolate isolate(out, out);
+            isolate.set_engine(engines[t % 4]);
+            for (int run = 0; run < 5; run++)
+                isolate.run(Lox::Source("var id = " + std::to_string(t) + ";" + script));
+            outputs[t] = out.str();
+        });
+    }
+    for (auto &thread: threads)
+        thread.join();
+    for (int t = 0; t < THREADS; t++) {
+        std::string expected = "worker " + std::to_string(t) + "\n5560\n";
+        EXPECT_EQ(outputs[t], expected + expected + expected + expected + expected) << "thread " << t;
+    }
+}
+
+TEST(IsolateTests, CompiledProgramRunsInManyIsolates) {
+    // one program, quickened and with inline caches warmed differently by each isolate, run again and again on
+    // every engine at once
+    Lox::Isolate compiler;
+    compiler.set_engine(Lox::Engine::CLOSURES);
+    compiler.set_optimization_level(2);
+    std::shared_ptr<const Lox::Program> program = compiler.compile(Lox::Source(R"(
+class Counter { init() { this.n = 0; } add(by) { this.n = this.n + by; return this; } }
+class Named < Counter { init() { super.init(); this.name = "named"; } }
+fun fib(n) { if (n < 2) return n; return fib(n - 2) + fib(n - 1); }
+var c = Counter();
+if (runs == 1) c = Named();
+for (var i = 0; i < 100; i = i + 1) c.add(i);
+print c.n + fib(15);
+runs = runs + 1;
+)"));
+    ASSERT_NE(program, nullptr);
+    EXPECT_EQ(compiler.compile(Lox::Source("print (;")), nullptr);
+    const Lox::Engine engines[] = {Lox::Engine::TREE_WALKER, Lox::Engine::CLOSURES, Lox::Engine::STACK,
+                                   Lox::Engine::VM};
+    constexpr int THREADS = 8;
+    std::string outputs[THREADS];
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t] {
+            std::ostringstream out;
+            Lox::Isolate isolate(out, out);
+            isolate.set_engine(engines[t % 4]);
+            isolate.set_optimization_level(2);
+            isolate.run(Lox::Source("var runs = 0;"));
+            for (int run = 0; run < 3; run++)
+                EXPECT_EQ(isolate.run(program), Lox::Isolate::Status::OK);
+            outputs[t] = out.str();
+        });
+    }
+    for (auto &thread: threads)
+        thread.join();
+    for (int t = 0; t < THREADS; t++)
+        EXPECT_EQ(outputs[t], "5560\n5560\n5560\n") << "thread " << t;
+}
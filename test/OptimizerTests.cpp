@@ -0,0 +1,66 @@
+#include<gtest/gtest.h>
+#include "Optimizer.h"
+#include "parser.h"
+#include "scanner.h"
+
+static Lox::NodeList<Stmt *> optimized(Lox::Program &program, const char *source) {
+    program.source = Lox::Source(source);
+    Scanner scanner(program.source.view());
+    Parser parser(scanner, program);
+    parser.parseTokens();
+    Lox::Optimizer(program).optimize_program();
+    return program.statements;
+}
+
+static Expr *printed(Stmt *stmt) {
+    auto *print = dynamic_cast<Print *>(stmt);
+    return print ? print->expression : nullptr;
+}
+
+TEST(OptimizerTests, FoldsConstantsAndPropagatesLocals) {
+    Lox::Program program;
+    auto statements = optimized(program, R"(
+{ var a = 2 * (3 + 1); var b = a > 7 ? "n" + a : nil; print b; print -a; }
+if (1 == 1 and !false) print 1; else print 2;
+while (false) print 3;
+for (;;) break;
+)");
+    ASSERT_EQ(statements.size(), 3);
+    auto *block = dynamic_cast<Block *>(statements[0]);
+    ASSERT_NE(block, nullptr);
+    auto *b = dynamic_cast<Literal *>(printed(block->statements[2]));
+    ASSERT_NE(b, nullptr);
+    EXPECT_EQ(b->value.as_string(), "n8");
+    auto *minus_a = dynamic_cast<Literal *>(printed(block->statements[3]));
+    ASSERT_NE(minus_a, nullptr);
+    EXPECT_EQ(minus_a->value.as_number(), -8);
+    // the if became its then branch and the while(false) is gone
+    auto *one = dynamic_cast<Literal *>(printed(statements[1]));
+    ASSERT_NE(one, nullptr);
+    EXPECT_EQ(one->value.as_number(), 1);
+    auto *loop = dynamic_cast<While *>(dynamic_cast<Block *>(statements[2])->statements[0]);
+    ASSERT_NE(loop, nullptr);
+    EXPECT_EQ(loop->condition, nullptr);
+}
+
+TEST(OptimizerTests, KeepsRuntimeErrorsAndMutableVariables) {
+    Lox::Program program;
+    auto statements = optimized(program, R"(
+var g = 1;
+print 1 / 0;
+print -"a";
+print nil + 1;
+{ var a = 1; var b = 2; fun f() { a = 3; return b; } var b = 4; print a; print g; }
+)");
+    EXPECT_NE(dynamic_cast<Binary *>(printed(statements[1])), nullptr);
+    EXPECT_NE(dynamic_cast<Unary *>(printed(statements[2])), nullptr);
+    EXPECT_NE(dynamic_cast<Binary *>(printed(statements[3])), nullptr);
+    // assigned in a closure, redeclared, and a global
+    auto *block = dynamic_cast<Block *>(statements[4]);
+    ASSERT_NE(block, nullptr);
+    EXPECT_NE(dynamic_cast<Variable *>(printed(block->statements[4])), nullptr);
+    EXPECT_NE(dynamic_cast<Variable *>(printed(block->statements[5])), nullptr);
+    auto *f = dynamic_cast<Function *>(block->statements[2]);
+    ASSERT_NE(f, nullptr);
+    EXPECT_NE(dynamic_cast<Variable *>(dynamic_cast<Return *>(f->fn_expr->body[1])->value), nullptr);
+}
@@ -3,6 +3,7 @@
 //
 #include<gtest/gtest.h>
 #include "parser.h"
+#include "scanner.h"
 
 //TEST(ParserTests,binary_expressions_){
 //
@@ -15,4 +16,39 @@
 //};
 //TEST(ParserTests,literal_expressions){
 //
-//};
\ No newline at end of file
+//};
+TEST(ParserTests, ProgramOwnsNodesInItsArena) {
+    Scanner scanner{"var a = 1; for (var i = 0; i < 3;) { a = a + i; }"};
+    Lox::Program program;
+    Parser parser(scanner, program);
+    auto statements = parser.parseTokens();
+    ASSERT_EQ(statements.size(), 2);
+    auto *var = dynamic_cast<Var *>(statements[0]);
+    ASSERT_NE(var, nullptr);
+    EXPECT_EQ(var->name.lexeme, "a");
+    // a for loop without an increment desugars to a while whose body is just the loop body
+    auto *loop = dynamic_cast<Block *>(statements[1]);
+    ASSERT_NE(loop, nullptr);
+    auto *while_stmt = dynamic_cast<While *>(loop->statements[1]);
+    ASSERT_NE(while_stmt, nullptr);
+    EXPECT_EQ(dynamic_cast<Block *>(while_stmt->body)->statements.size(), 1);
+    EXPECT_GT(program.arena.size(), 0);
+    EXPECT_EQ(program.arena.block_count(), 1);
+}
+
+TEST(ParserTests, ArenaRunsDestructorsOnce) {
+    static int destroyed = 0;
+    struct Tracked {
+        ~Tracked() { destroyed++; }
+    };
+    {
+        Lox::Arena arena;
+        arena.make<Tracked>();
+        arena.make_list(std::vector<Tracked>(3));
+        auto *big = static_cast<char *>(arena.allocate(2 * Lox::Arena::BLOCK_SIZE, 16));
+        big[2 * Lox::Arena::BLOCK_SIZE - 1] = 0;
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(big) % 16, 0);
+        destroyed = 0;
+    }
+    EXPECT_EQ(destroyed, 4);
+}
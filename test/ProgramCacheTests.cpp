@@ -0,0 +1,100 @@
+#include<gtest/gtest.h>
+#include <string>
+#include "ProgramCache.h"
+#include "parser.h"
+#include "scanner.h"
+
+static const char *CACHED_SCRIPT = R"(
+var greeting = "hi" + nil;
+fun counter(start, step) {
+    var n = start;
+    fun next() { n = n + step; return n; }
+    return next;
+}
+var f = fun (x) { return x > 1 ? -x : !true or false and x; };
+{ var i = 0; while (i < 10) { if (i == 5) break; else i = i + 1; } }
+for (var j = 0; j < 2; j = j + 1) print (counter(j, 2.5))();
+)";
+
+static void parse(Lox::Program &program) {
+    Scanner scanner(program.source.view());
+    Parser parser(scanner, program);
+    parser.parseTokens();
+}
+
+TEST(ProgramCacheTests, RoundTripsEveryNode) {
+    Lox::Program parsed;
+    parsed.source = Lox::Source(CACHED_SCRIPT);
+    parse(parsed);
+    std::string data = Lox::ProgramCache::serialize(parsed);
+
+    Lox::Program loaded;
+    loaded.source = Lox::Source(CACHED_SCRIPT);
+    ASSERT_TRUE(Lox::ProgramCache::deserialize(data, loaded));
+    ASSERT_EQ(loaded.statements.size(), parsed.statements.size());
+    EXPECT_EQ(Lox::ProgramCache::serialize(loaded), data);
+    // tokens point into the new program's own source
+    auto *var = dynamic_cast<Var *>(loaded.statements[0]);
+    ASSERT_NE(var, nullptr);
+    EXPECT_EQ(var->name.lexeme.data(), loaded.source.view().data() + 5);
+}
+
+TEST(ProgramCacheTests, RejectsStaleOrDamagedFiles) {
+    Lox::Program parsed;
+    parsed.source = Lox::Source(CACHED_SCRIPT);
+    parse(parsed);
+    std::string data = Lox::ProgramCache::serialize(parsed);
+
+    Lox::Program edited;
+    edited.source = Lox::Source(std::string(CACHED_SCRIPT) + "print 1;");
+    EXPECT_FALSE(Lox::ProgramCache::deserialize(data, edited));
+
+    for (size_t size: {size_t(0), size_t(10), data.size() / 2, data.size() - 1}) {
+        Lox::Program truncated;
+        truncated.source = Lox::Source(CACHED_SCRIPT);
+        EXPECT_FALSE(Lox::ProgramCache::deserialize(data.substr(0, size), truncated)) << size;
+    }
+    std::string other_version = data;
+    other_version[4]++;
+    Lox::Program program;
+    program.source = Lox::Source(CACHED_SCRIPT);
+    EXPECT_FALSE(Lox::ProgramCache::deserialize(other_version, program));
+
+    // well formed files whose tree the parser could never have produced
+    const char *sum = "print 1 + 2;";
+    Lox::Program empty;
+    empty.source = Lox::Source(sum);
+    size_t header = Lox::ProgramCache::serialize(empty).size() - 1;
+    Lox::Program print_sum;
+    print_sum.source = Lox::Source(sum);
+    parse(print_sum);
+    std::string valid = Lox::ProgramCache::serialize(print_sum);
+    // one statement, Print, Binary, then the left operand's Literal tag and its number
+    const size_t left_operand = header + 3, operator_type = left_operand + 1 + 1 + sizeof(double);
+    ASSERT_EQ(valid[left_operand], 4);
+    ASSERT_EQ(valid[operator_type], PLUS);
+    std::string missing_operand = valid, wrong_operator = valid;
+    missing_operand[left_operand] = 0;
+    wrong_operator[operator_type] = IDENTIFIER;
+    for (auto &damaged: {missing_operand, wrong_operator}) {
+        Lox::Program reloaded;
+        reloaded.source = Lox::Source(sum);
+        EXPECT_FALSE(Lox::ProgramCache::deserialize(damaged, reloaded));
+    }
+}
+
+TEST(ProgramCacheTests, StoresFilesKeyedBySource) {
+    Lox::ProgramCache cache(testing::TempDir() + "lox_cache_test");
+    Lox::Program parsed;
+    parsed.source = Lox::Source(CACHED_SCRIPT);
+    parse(parsed);
+    cache.store(parsed);
+
+    Lox::Program loaded;
+    loaded.source = Lox::Source(CACHED_SCRIPT);
+    EXPECT_TRUE(cache.load(loaded));
+    Lox::Program other;
+    other.source = Lox::Source("print 2;");
+    EXPECT_FALSE(cache.load(other));
+    std::remove(cache.path_for(CACHED_SCRIPT).c_str());
+}
@@ -0,0 +1,29 @@
+#include<gtest/gtest.h>
+#include "TestHelpers.h"
+
+TEST(ResolverTests, ClosuresBindLexically) {
+    const auto script = R"(
+var a = "global";
+{
+  fun show() { print a; }
+  show();
+  var a = "block";
+  show();
+  print a;
+}
+)";
+    EXPECT_EQ(run_script(script), "global\nglobal\nblock\n");
+}
+
+TEST(ResolverTests, NestedScopesAndCounters) {
+    const auto script = R"(
+fun counter() { var n = 0; return fun () { n = n + 1; return n; }; }
+var c1 = counter();
+var c2 = counter();
+c1();
+print c1();
+print c2();
+{ var x = 1; { var y = 2; { print x + y; x = 10; } } print x; }
+)";
+    EXPECT_EQ(run_script(script), "2\n1\n3\n10\n");
+}
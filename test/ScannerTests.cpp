@@ -1,20 +1,18 @@
 #include<gtest/gtest.h>
 #include "scanner.h"
 #include "token.h"
+#include "Keywords.h"
+#include "ScanKernels.h"
 
 //
 // Created by Dipin Garg on 25-12-2022.
 //
-bool checkLiteralsEqual(token_type type, const literal_type &el, const literal_type &l) {
-    if (el.index() != l.index()) {
-        return false;
-    }
-
-    switch (type) {
+bool checkLiteralsEqual(const Token &el, const Token &l) {
+    switch (el.type) {
         case STRING:
-            return std::get<std::string>(el) == std::get<std::string>(l);
+            return el.string() == l.string();
         case NUMBER:
-            return std::get<double>(el) == std::get<double>(l);
+            return el.number() == l.number();
         default:
             return true;
     }
@@ -26,7 +24,7 @@ void checkTokensEqual(const std::vector<Token> &ets, const std::vector<Token> &t
         EXPECT_EQ(ets[i].type, ts[i].type) << "Token types differ at index " << i;
         EXPECT_EQ(ets[i].lexeme, ts[i].lexeme) << "Token lexemes differ at index " << i;
         EXPECT_EQ(ets[i].line, ts[i].line) << "Token lines differ at index " << i;
-        EXPECT_TRUE(checkLiteralsEqual(ets[i].type, ets[i].literal, ts[i].literal))
+        EXPECT_TRUE(checkLiteralsEqual(ets[i], ts[i]))
                             << "Literals differ at index " << i;
     }
 }
@@ -37,13 +35,14 @@ TEST(ScannerTests, Basic) {
     const auto tokens = scanner.scanTokens();
     /* clang-format off */
     std::vector<Token> expectedTokens = {
-            Token{PRINT, "print", get_empty_literal(), 1},
-            Token{STRING, "\"Hello, world\"", std::string{"Hello, world"}, 1},
-            Token{NUMBER, "42", 42.0, 1},
-            Token{T_EOF, "", get_empty_literal(), 1},
+            Token{PRINT, "print", 1},
+            Token{STRING, "\"Hello, world\"", 1},
+            Token{NUMBER, "42", 1},
+            Token{T_EOF, "", 1},
     };
     checkTokensEqual(expectedTokens, tokens);
-
+    EXPECT_EQ(tokens[1].string(), "Hello, world");
+    EXPECT_EQ(tokens[2].number(), 42.0);
 }
 
 TEST(ScannerTests, Comment) {
@@ -56,11 +55,11 @@ print "Hello, world" // another comment
     const auto tokens = scanner.scanTokens();
     /* clang-format off */
     std::vector<Token> expectedTokens = {
-            Token{PRINT, "print", get_empty_literal(), 2},
-            Token{STRING, "\"Hello, world\"", std::string{"Hello, world"}, 2},
+            Token{PRINT, "print", 2},
+            Token{STRING, "\"Hello, world\"", 2},
 
-            Token{NUMBER, "123", 123.0, 3},
-            Token{T_EOF, "", get_empty_literal(), 4},
+            Token{NUMBER, "123", 3},
+            Token{T_EOF, "", 4},
     };
     /* clang-format on */
 
@@ -74,15 +73,41 @@ TEST(ScannerTests, Expression) {
     const auto tokens = scanner.scanTokens();
     /* clang-format off */
     std::vector<Token> expectedTokens = {
-            Token{VAR, "var", get_empty_literal(), 1},
-            Token{IDENTIFIER, "x", get_empty_literal(), 1},
-            Token{EQUAL, "=", get_empty_literal(), 1},
-            Token{NUMBER, "2", 2., 1},
-            Token{PLUS, "+", get_empty_literal(), 1},
-            Token{NUMBER, "2", 2., 1},
-            Token{T_EOF, "", get_empty_literal(), 1},
+            Token{VAR, "var", 1},
+            Token{IDENTIFIER, "x", 1},
+            Token{EQUAL, "=", 1},
+            Token{NUMBER, "2", 1},
+            Token{PLUS, "+", 1},
+            Token{NUMBER, "2", 1},
+            Token{T_EOF, "", 1},
     };
     /* clang-format on */
 
     checkTokensEqual(expectedTokens, tokens);
 }
+
+TEST(ScannerTests, Keywords) {
+    for (auto &keyword: Lox::KEYWORDS)
+        EXPECT_EQ(Lox::identifier_type(keyword.text), keyword.type) << keyword.text;
+    for (auto identifier: {"a", "an", "andy", "classes", "fals", "Print", "returns", "whilst", "th1s", "_"})
+        EXPECT_EQ(Lox::identifier_type(identifier), IDENTIFIER) << identifier;
+}
+
+// whitespace, comments and strings long enough to cross the 16 and 32 byte blocks of the vector kernels
+TEST(ScannerTests, VectorKernelsMatchScalar) {
+    std::string script;
+    for (int n = 1; n < 70; n += 3) {
+        script += std::string(n, ' ') + "\t\r\n" + std::string(n % 5, '\n');
+        script += "\"" + std::string(n, 's') + "\n" + std::string(n / 2, 'x') + "\" x" + std::to_string(n);
+        script += " /*" + std::string(n, '*') + "\n" + std::string(n, '\n') + "*/ // " + std::string(n, '/') + "\n";
+    }
+    script += "/* unterminated *";
+
+    auto expected = Scanner(script, Lox::scan_kernels(Lox::SimdLevel::SCALAR)).scanTokens();
+    ASSERT_EQ(expected.size(), 23 * 2 + 1);
+    EXPECT_EQ(expected.back().line, std::count(script.begin(), script.end(), '\n') + 1);
+    for (auto level: {Lox::SimdLevel::SSE2, Lox::SimdLevel::AVX2}) {
+        SCOPED_TRACE(Lox::scan_kernels(level).name);
+        checkTokensEqual(expected, Scanner(script, Lox::scan_kernels(level)).scanTokens());
+    }
+}
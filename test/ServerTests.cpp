@@ -0,0 +1,98 @@
+#include<gtest/gtest.h>
+#include <cstdio>
+#include <thread>
+#include "Server.h"
+#include "TestHelpers.h"
+
+TEST(ServerTests, RunsRequestsFromClients) {
+    std::string socket_path = testing::TempDir() + "lox_server_test.sock";
+    std::string script_path =
+            write_temp_file("lox_server_test.lox", "class A { init(n) { this.n = n; } } print A(7).n;");
+    Lox::BatchOptions options;
+    options.jobs = 2;
+    options.engine = Lox::Engine::CLOSURES;
+    Lox::Server server(socket_path, options);
+    ASSERT_TRUE(server.listen());
+    std::thread serving([&] { server.serve(); });
+
+    Lox::Client client;
+    ASSERT_TRUE(client.connect(socket_path));
+    // a request doesn't see the globals of the one before, even when it's the same program run again
+    const std::string script = "print defined; var defined = 1;";
+    const std::string define = "var defined = \"yes\"; print defined;";
+    auto first = client.run(define);
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first->status, Lox::Isolate::Status::OK);
+    EXPECT_EQ(first->out, "yes\n");
+    for (int i = 0; i < 2; i++) {
+        auto undefined = client.run(script);
+        ASSERT_TRUE(undefined);
+        EXPECT_EQ(undefined->status, Lox::Isolate::Status::RUNTIME_ERROR);
+        EXPECT_EQ(undefined->out, "");
+        EXPECT_EQ(undefined->err, "Undefined variable 'defined'.\n[line 1]\n");
+    }
+    auto compile_error = client.run("print (;");
+    ASSERT_TRUE(compile_error);
+    EXPECT_EQ(compile_error->status, Lox::Isolate::Status::COMPILE_ERROR);
+    EXPECT_NE(compile_error->err.find("[line 1]"), std::string::npos);
+    auto file = client.run_file(script_path);
+    ASSERT_TRUE(file);
+    EXPECT_EQ(file->status, Lox::Isolate::Status::OK);
+    EXPECT_EQ(file->out, "7\n");
+    std::remove(script_path.c_str());
+    auto missing = client.run_file(script_path);
+    ASSERT_TRUE(missing);
+    EXPECT_EQ(missing->status, Lox::Isolate::Status::NO_INPUT);
+
+    // more clients at once than there are workers, those without one wait for it
+    std::vector<std::thread> clients;
+    std::string outputs[4];
+    for (int c = 0; c < 4; c++) {
+        clients.emplace_back([&, c] {
+            Lox::Client other;
+            if (!other.connect(socket_path))
+                return;
+            for (int run = 0; run < 10; run++) {
+                auto result = other.run("var n = " + std::to_string(c) + "; fun f() { return n * 2; } print f();");
+                if (result)
+                    outputs[c] += result->out;
+            }
+        });
+    }
+    for (auto &thread: clients)
+        thread.join();
+    for (int c = 0; c < 4; c++) {
+        std::string expected;
+        for (int run = 0; run < 10; run++)
+            expected += std::to_string(c * 2) + "\n";
+        EXPECT_EQ(outputs[c], expected);
+    }
+
+    // stopping lets go of the connection that is still open
+    server.stop();
+    serving.join();
+    EXPECT_FALSE(client.run("print 1;"));
+}
+
+TEST(ServerTests, IdleConnectionsDontHoldWorkers) {
+    std::string socket_path = testing::TempDir() + "lox_server_idle_test.sock";
+    Lox::BatchOptions options;
+    options.jobs = 1;
+    Lox::Server server(socket_path, options);
+    ASSERT_TRUE(server.listen());
+    std::thread serving([&] { server.serve(); });
+    // the only worker serves each of the open connections in turn, not the first one until it closes
+    Lox::Client first, second;
+    ASSERT_TRUE(first.connect(socket_path));
+    ASSERT_TRUE(second.connect(socket_path));
+    for (int run = 0; run < 3; run++) {
+        for (auto *client: {&first, &second}) {
+            auto result = client->run("print \"run\" + " + std::to_string(run) + ";");
+            ASSERT_TRUE(result);
+            EXPECT_EQ(result->out, "run" + std::to_string(run) + "\n");
+        }
+    }
+    server.stop();
+    serving.join();
+    EXPECT_FALSE(first.run("print 1;"));
+}
@@ -0,0 +1,29 @@
+#include<gtest/gtest.h>
+#include <cstdio>
+#include "Source.h"
+#include "TestHelpers.h"
+
+TEST(SourceTests, RegularFilesAreMapped) {
+    auto path = write_temp_file("lox_source_test.lox", "print 1 + 2;\n");
+    Lox::Source source = Lox::Source::from_file(path);
+    EXPECT_TRUE(source.is_mapped());
+    EXPECT_EQ(source.view(), "print 1 + 2;\n");
+
+    // the mapping moves with the source
+    Lox::Source moved = std::move(source);
+    EXPECT_FALSE(source.is_mapped());
+    EXPECT_EQ(moved.view(), "print 1 + 2;\n");
+    std::remove(path.c_str());
+}
+
+TEST(SourceTests, EmptyFilesAndStringsAreNotMapped) {
+    auto path = write_temp_file("lox_source_test.lox", "");
+    Lox::Source empty = Lox::Source::from_file(path);
+    EXPECT_FALSE(empty.is_mapped());
+    EXPECT_TRUE(empty.view().empty());
+    std::remove(path.c_str());
+
+    Lox::Source line(std::string("var a;"));
+    EXPECT_FALSE(line.is_mapped());
+    EXPECT_EQ(line.view(), "var a;");
+}
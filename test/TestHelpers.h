@@ -0,0 +1,55 @@
+#ifndef LOX_TEST_HELPERS_H
+#define LOX_TEST_HELPERS_H
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include "Isolate.h"
+
+// Helpers shared by the tests. Scripts always run in an isolate of their own, so tests neither see each other's
+// globals nor leave the process wide isolate on another engine or optimization level.
+
+constexpr std::initializer_list<Lox::Engine> ALL_ENGINES = {
+        Lox::Engine::TREE_WALKER, Lox::Engine::CLOSURES, Lox::Engine::STACK, Lox::Engine::VM};
+
+// runs `source` on `engine`, returning what it printed followed by the errors it reported
+inline std::string run_with(Lox::Engine engine, const std::string &source, int optimization_level = 1) {
+    std::ostringstream out, err;
+    Lox::Isolate isolate(out, err);
+    isolate.set_engine(engine);
+    isolate.set_optimization_level(optimization_level);
+    isolate.run(Lox::Source(source));
+    return out.str() + err.str();
+}
+
+inline std::string run_script(const std::string &source) {
+    return run_with(Lox::Engine::TREE_WALKER, source);
+}
+
+inline std::string run_on_vm(const std::string &source) {
+    return run_with(Lox::Engine::VM, source);
+}
+
+// runs `script` on each of `engines`, expecting the same output, errors included, and status from each
+inline void expect_output(const std::string &script, const std::string &expected,
+                          Lox::Isolate::Status status = Lox::Isolate::Status::OK,
+                          std::initializer_list<Lox::Engine> engines = ALL_ENGINES) {
+    for (auto engine: engines) {
+        std::ostringstream out;
+        Lox::Isolate isolate(out, out);
+        isolate.set_engine(engine);
+        EXPECT_EQ(isolate.run(Lox::Source(script)), status) << "engine " << static_cast<int>(engine);
+        EXPECT_EQ(out.str(), expected) << "engine " << static_cast<int>(engine);
+    }
+}
+
+// writes `contents` to `name` in the test temp directory, returning its path
+inline std::string write_temp_file(const std::string &name, const std::string &contents) {
+    std::string path = testing::TempDir() + name;
+    std::ofstream(path, std::ios::binary) << contents;
+    return path;
+}
+
+#endif //LOX_TEST_HELPERS_H
@@ -0,0 +1,30 @@
+#include<gtest/gtest.h>
+#include "TestHelpers.h"
+
+TEST(VMTests, ArithmeticAndStrings) {
+    EXPECT_EQ(run_on_vm(R"(print 1 + 2 * 3 - 4 / 2; print "a" + "b"; print "n" + 1; print 1, 2;)"),
+              "5\nab\nn1\n2\n");
+}
+
+TEST(VMTests, RecursionAndLoops) {
+    const auto script = R"(
+fun fib(n) { if (n <= 1) return n; return fib(n - 2) + fib(n - 1); }
+var total = 0;
+for (var i = 0; i < 10; i = i + 1) { if (i == 8) break; total = total + fib(i); }
+print total;
+)";
+    EXPECT_EQ(run_on_vm(script), "33\n");
+}
+
+TEST(VMTests, ClosuresCaptureVariables) {
+    const auto script = R"(
+fun counter() { var n = 0; return fun () { n = n + 1; return n; }; }
+var c = counter();
+c();
+print c();
+var first;
+for (var i = 0; i < 3; i = i + 1) { var j = i; fun get() { return j; } if (i == 1) first = get; }
+print first();
+)";
+    EXPECT_EQ(run_on_vm(script), "2\n1\n");
+}
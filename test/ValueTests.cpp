@@ -0,0 +1,32 @@
+#include<gtest/gtest.h>
+#include "Value.h"
+#include "utils.h"
+
+using Lox::Value;
+using Lox::ValueType;
+
+TEST(ValueTests, InlinePayloads) {
+    EXPECT_EQ(Value().type(), ValueType::NIL);
+    EXPECT_EQ(Value(true).type(), ValueType::BOOL);
+    EXPECT_EQ(Value(4.5).type(), ValueType::NUMBER);
+    EXPECT_TRUE(Value(false).is_bool());
+    EXPECT_FALSE(Value(false).as_bool());
+    EXPECT_DOUBLE_EQ(Value(4.5).as_number(), 4.5);
+    EXPECT_TRUE(Value::uninitialized().is_uninitialized());
+}
+
+TEST(ValueTests, ConstantStringsAreInterned) {
+    Value a(Lox::constant_string("hello"));
+    Value b = a;
+    EXPECT_EQ(&a.as_string(), &b.as_string());
+    EXPECT_EQ(a.as_heap_object(), Value(Lox::constant_string("hello")).as_heap_object());
+    EXPECT_TRUE(a.as_heap_object()->permanent);
+    EXPECT_EQ(Value(1.0).as_heap_object(), nullptr);
+}
+
+TEST(ValueTests, StringRepr) {
+    EXPECT_EQ(Lox::get_string_repr(Value()), "nil");
+    EXPECT_EQ(Lox::get_string_repr(Value(true)), "True");
+    EXPECT_EQ(Lox::get_string_repr(Value(2.5)), "2.5");
+    EXPECT_EQ(Lox::get_string_repr(Value(Lox::constant_string("lox"))), "lox");
+}